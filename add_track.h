@@ -12,7 +12,8 @@ typedef struct {
 } TrackRecord;
 
 /* Inserta una línea al CSV y (en el siguiente paso) actualiza el índice hash.
-   Devuelve true si todo sale bien. out_offset = byte offset donde quedó la línea. */
+   Devuelve true si todo sale bien. out_offset = byte offset donde quedó la línea.
+   Si el índice rechaza el alta (duplicado, IDX4MPH, error) el CSV queda como estaba. */
 bool add_track_and_index(
     const char *csv_path,
     const char *idx_path,
@@ -0,0 +1,67 @@
+/*
+  bench_codec.c
+  Mide la compresión de postings (postings_codec.c): bytes por posting y
+  velocidad de decodificación frente a copiar los u32 crudos (lo mínimo
+  que cuesta leer la lista sin comprimir, ya en memoria).
+    - listas densas (token frecuente: saltos de pocas filas)
+    - listas dispersas (token raro: saltos de miles de filas)
+
+  Compilar:  make bench_codec
+  Usar:      ./bench_codec [n_postings] [repeticiones]
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "postings_codec.h"
+
+static double now_ms(void){
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t xorshift(void){ rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17; return rng; }
+
+int main(int argc, char **argv){
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 4000000;
+    int reps = argc > 2 ? atoi(argv[2]) : 5;
+    if (n == 0 || reps <= 0){ fprintf(stderr, "Uso: %s [n_postings] [repeticiones]\n", argv[0]); return 1; }
+
+    uint32_t *v   = malloc(n * sizeof(uint32_t));
+    uint32_t *out = malloc(n * sizeof(uint32_t));
+    uint8_t  *enc = malloc(pcodec_bound(n));
+    if (!v || !out || !enc){ fprintf(stderr, "Memoria insuficiente\n"); return 1; }
+
+    printf("n = %zu postings, repeticiones = %d (mejor tiempo)\n", n, reps);
+    const char *names[2] = { "densa (saltos ~8 filas)", "dispersa (saltos ~500)" };
+    const uint32_t span[2] = { 16, 1000 };
+    for (int kind=0; kind<2; kind++){
+        if ((uint64_t)n * span[kind] > UINT32_MAX){ fprintf(stderr, "n demasiado grande\n"); return 1; }
+        uint32_t cur = (uint32_t)(xorshift() % 1000);
+        for (size_t i=0; i<n; i++){ v[i] = cur; cur += 1 + (uint32_t)(xorshift() % span[kind]); }
+        size_t len = pcodec_encode(v, n, enc);
+        if (len == 0){ fprintf(stderr, "No se pudo codificar\n"); return 1; }
+
+        double best_d = 1e30, best_c = 1e30;
+        for (int r=0; r<reps; r++){
+            double t0 = now_ms();
+            if (pcodec_decode(enc, len, n, out) != 0){ fprintf(stderr, "Error al decodificar\n"); return 1; }
+            t0 = now_ms() - t0; if (t0 < best_d) best_d = t0;
+            if (memcmp(out, v, n * sizeof(uint32_t)) != 0){ fprintf(stderr, "ERROR: %s: resultados distintos\n", names[kind]); return 1; }
+            t0 = now_ms();
+            memcpy(out, v, n * sizeof(uint32_t));
+            t0 = now_ms() - t0; if (t0 < best_c) best_c = t0;
+        }
+        printf("%-24s %.2f B/posting (x%.1f) | decodificar %7.1f ms (%.0f M/s) | copiar crudo %7.1f ms\n",
+               names[kind], (double)len / (double)n, 4.0 * (double)n / (double)len,
+               best_d, (double)n / best_d / 1e3, best_c);
+    }
+    free(v); free(out); free(enc);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+  bench_cols.c
+  Filtro por región y rango de fechas + suma de streams sobre todo el
+  dataset: leyendo el CSV (parseo de cada línea) frente al snapshot
+  columnar (colstore.h), que recorre date/region/streams mapeados.
+  Los dos deben dar las mismas filas y la misma suma.
+
+  Compilar:  make bench_cols
+  Usar:      ./bench_cols <dataset.csv> <dir_cols> <región> <desde AAAA-MM-DD> <hasta AAAA-MM-DD>
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "colstore.h"
+#include "track_rows.h"
+
+#define REPS 5
+
+static double now_ms(void){
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Campos de una línea (comillas como en el resto del proyecto), sin copiar:
+   devuelve los inicios y largos de hasta max campos */
+static size_t split_csv(char *line, char **f, size_t max){
+    size_t n = 0; char *w = line; int inq = 0;
+    f[n++] = w;
+    for (char *p = line; *p && *p != '\n' && *p != '\r'; p++){
+        if (*p == '"'){
+            if (inq && p[1] == '"'){ *w++ = '"'; p++; }
+            else inq = !inq;
+        } else if (*p == ',' && !inq){
+            *w++ = '\0';
+            if (n < max) f[n++] = w;
+        } else *w++ = *p;
+    }
+    *w = '\0';
+    return n;
+}
+
+int main(int argc, char **argv){
+    if (argc < 6){
+        fprintf(stderr, "Uso: %s <dataset.csv> <dir_cols> <región> <desde AAAA-MM-DD> <hasta AAAA-MM-DD>\n", argv[0]);
+        return 1;
+    }
+    int32_t from = (int32_t)trackrows_parse_date(argv[4]), to = (int32_t)trackrows_parse_date(argv[5]);
+    if (!from || !to){ fprintf(stderr, "Fecha inválida (AAAA-MM-DD)\n"); return 1; }
+
+    ColStore c;
+    if (cols_open(&c, argv[2]) != 0){ perror("snapshot"); return 1; }
+    int64_t rg = cols_dict_find(&c.regions, argv[3]);
+    if (rg < 0) fprintf(stderr, "Región '%s' no está en el snapshot\n", argv[3]);
+
+    /* 1) CSV: hasta donde llega el snapshot */
+    FILE *fp = fopen(argv[1], "r");
+    if (!fp){ perror("CSV"); return 1; }
+    setvbuf(fp, NULL, _IOFBF, 4*1024*1024);
+    char *line = NULL; size_t cap = 0;
+    char *f[256];
+    double t0 = now_ms();
+    ssize_t len = getline(&line, &cap, fp);
+    int col_date = 3, col_region = 6, col_streams = 9;
+    if (len > 0){
+        size_t nf = split_csv(line, f, 256);
+        for (size_t i=0; i<nf; i++){
+            if (!strcasecmp(f[i], "date"))    col_date = (int)i;
+            if (!strcasecmp(f[i], "region"))  col_region = (int)i;
+            if (!strcasecmp(f[i], "streams")) col_streams = (int)i;
+        }
+    }
+    uint64_t n_csv = 0, sum_csv = 0, rows = 0;
+    while (rows < c.nrows && (len = getline(&line, &cap, fp)) > 0){
+        size_t nf = split_csv(line, f, 256);
+        rows++;
+        if ((size_t)col_date >= nf || (size_t)col_region >= nf || (size_t)col_streams >= nf) continue;
+        int32_t d = (int32_t)trackrows_parse_date(f[col_date]);
+        if (d < from || d > to || strcasecmp(f[col_region], argv[3]) != 0) continue;
+        n_csv++; sum_csv += strtoull(f[col_streams], NULL, 10);
+    }
+    double t_csv = now_ms() - t0;
+    free(line); fclose(fp);
+
+    /* 2) Snapshot: mejor de REPS pasadas */
+    uint64_t n_col = 0, sum_col = 0;
+    double t_col = 1e30;
+    for (int r=0; r<REPS; r++){
+        t0 = now_ms();
+        uint64_t n = 0, s = 0;
+        for (uint64_t i=0; i<c.nrows; i++){
+            int ok = c.region[i] == (uint16_t)rg && c.date[i] >= from && c.date[i] <= to;
+            n += (uint64_t)ok;
+            s += ok ? c.streams[i] : 0;
+        }
+        t0 = now_ms() - t0;
+        if (t0 < t_col) t_col = t0;
+        n_col = n; sum_col = s;
+    }
+    if (rg < 0){ n_col = 0; sum_col = 0; }
+
+    double mb = (double)c.nrows * 10 / (1024.0 * 1024.0);     // date + region + streams
+    printf("filas: %" PRIu64 "\n", c.nrows);
+    printf("CSV      : %10.2f ms  %" PRIu64 " filas, %" PRIu64 " streams\n", t_csv, n_csv, sum_csv);
+    printf("columnas : %10.2f ms  %" PRIu64 " filas, %" PRIu64 " streams  (%.0f MB/s)\n",
+           t_col, n_col, sum_col, t_col > 0 ? mb / (t_col / 1e3) : 0.0);
+    if (n_csv != n_col || sum_csv != sum_col) printf("DIFERENCIA entre CSV y snapshot\n");
+    cols_close(&c);
+    return 0;
+}
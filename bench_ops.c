@@ -0,0 +1,109 @@
+/*
+  bench_ops.c
+  Mide los kernels de AND / OR de postings_ops.c con listas reales de un
+  índice de nombres (names.seg): todas las parejas de las palabras dadas,
+  con cada kernel, frente al escalar.
+    - AND: escalar, galloping, SSE4.1, AVX2 y el elegido automáticamente
+    - OR (fusión base + delta): escalar, galloping, SSE4.1 y automático
+
+  Compilar:  make bench_ops
+  Usar:      ./bench_ops <dir_nameidx> <pal1> <pal2> [pal3 ...]
+  (palabras ya normalizadas: minúsculas, sin tildes)
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "nameidx_dir.h"
+#include "postings_ops.h"
+
+#define REPS 5
+
+static double now_ms(void){
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static uint64_t fnv1a64(const char *s){
+    const uint64_t OFF=1469598103934665603ULL, PR=1099511628211ULL;
+    uint64_t h=OFF;
+    for(const unsigned char *p=(const unsigned char*)s; *p; ++p){ h^=(uint64_t)*p; h*=PR; }
+    if (h==0) { h=1; }
+    return h;
+}
+
+typedef size_t (*OpFn)(int, const uint32_t*, size_t, const uint32_t*, size_t, uint32_t*);
+
+/* Mejor tiempo (ms) de todas las parejas con un kernel; -1 = automático */
+static double run(OpFn fn, int kernel, uint32_t **v, size_t *n, int nw, uint32_t *out, uint64_t *total){
+    double best = 1e30;
+    for (int r=0; r<REPS; r++){
+        uint64_t tot = 0;
+        double t0 = now_ms();
+        for (int i=0; i<nw; i++)
+            for (int j=i+1; j<nw; j++)
+                tot += kernel >= 0 ? fn(kernel, v[i], n[i], v[j], n[j], out)
+                     : fn == pops_intersect_with ? pops_intersect(v[i], n[i], v[j], n[j], out)
+                                                 : pops_union(v[i], n[i], v[j], n[j], out);
+        t0 = now_ms() - t0;
+        if (t0 < best) best = t0;
+        *total = tot;
+    }
+    return best;
+}
+
+int main(int argc, char **argv){
+    if (argc < 4){ fprintf(stderr, "Uso: %s <dir_nameidx> <pal1> <pal2> [pal3 ...]\n", argv[0]); return 1; }
+    int nw = argc - 2;
+    NameIdxReader r;
+    nameidx_reader_init(&r, argv[1]);
+    uint32_t **v = calloc((size_t)nw, sizeof(*v));
+    size_t *n = calloc((size_t)nw, sizeof(*n)), maxn = 0;
+    if (!v || !n){ fprintf(stderr, "Memoria insuficiente\n"); return 1; }
+    for (int i=0; i<nw; i++){
+        NamePostings p;
+        nameidx_postings(&r, fnv1a64(argv[i+2]), &p);
+        v[i] = nameidx_postings_and(&p, 1, &n[i]);    // la lista sola, como arreglo
+        nameidx_postings_free(&p);
+        if (!v[i]){ fprintf(stderr, "'%s' no está en el índice\n", argv[i+2]); return 1; }
+        if (n[i] > maxn) maxn = n[i];
+        printf("%-16s %zu filas\n", argv[i+2], n[i]);
+    }
+    uint32_t *out = malloc((2 * maxn + POPS_SLACK) * sizeof(uint32_t));
+    if (!out){ fprintf(stderr, "Memoria insuficiente\n"); return 1; }
+
+    static const char *kname[] = { "escalar", "galloping", "SSE4.1", "AVX2" };
+    int simd = pops_simd_kernel();
+    printf("%d parejas, mejor de %d; SIMD disponible: %s\n", nw * (nw - 1) / 2, REPS, kname[simd]);
+
+    uint64_t ref = 0, tot = 0;
+    double base = run(pops_intersect_with, POPS_SCALAR, v, n, nw, out, &ref);
+    printf("AND %-10s %8.2f ms        (resultado %llu)\n", kname[0], base, (unsigned long long)ref);
+    for (int k=POPS_GALLOP; k<=POPS_AVX2; k++){
+        if (k >= POPS_SSE41 && k > simd) continue;
+        double t = run(pops_intersect_with, k, v, n, nw, out, &tot);
+        printf("AND %-10s %8.2f ms  x%.2f%s\n", kname[k], t, base / t, tot == ref ? "" : "  ERROR: resultado distinto");
+    }
+    double t = run(pops_intersect_with, -1, v, n, nw, out, &tot);
+    printf("AND %-10s %8.2f ms  x%.2f%s\n", "automático", t, base / t, tot == ref ? "" : "  ERROR: resultado distinto");
+
+    base = run(pops_union_with, POPS_SCALAR, v, n, nw, out, &ref);
+    printf("OR  %-10s %8.2f ms        (resultado %llu)\n", kname[0], base, (unsigned long long)ref);
+    for (int k=POPS_GALLOP; k<=POPS_SSE41; k++){
+        if (k >= POPS_SSE41 && k > simd) continue;
+        t = run(pops_union_with, k, v, n, nw, out, &tot);
+        printf("OR  %-10s %8.2f ms  x%.2f%s\n", kname[k], t, base / t, tot == ref ? "" : "  ERROR: resultado distinto");
+    }
+    t = run(pops_union_with, -1, v, n, nw, out, &tot);
+    printf("OR  %-10s %8.2f ms  x%.2f%s\n", "automático", t, base / t, tot == ref ? "" : "  ERROR: resultado distinto");
+
+    for (int i=0; i<nw; i++) free(v[i]);
+    free(v); free(n); free(out);
+    nameidx_reader_close(&r);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+  bench_sort.c
+  Compara radix_sort (radix_sort.c) con qsort + comparador sobre los datos
+  que ordena la construcción de índices:
+    - pares (hash FNV, offset) de un bucket de nameidx (byte bajo del hash fijo)
+    - offsets sueltos (u64) de un CSV de pocos GB
+
+  Compilar:  make bench_sort
+  Usar:      ./bench_sort [n_elementos] [repeticiones]
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "radix_sort.h"
+
+static int cmp_u64(const void *a, const void *b){
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+static int cmp_pair(const void *a, const void *b){
+    const uint64_t *x = (const uint64_t*)a, *y = (const uint64_t*)b;
+    if (x[0] != y[0]) return x[0] < y[0] ? -1 : 1;
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+static double now_ms(void){
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t xorshift(void){ rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17; return rng; }
+
+int main(int argc, char **argv){
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 4000000;
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+    if (n == 0 || reps <= 0){ fprintf(stderr, "Uso: %s [n_elementos] [repeticiones]\n", argv[0]); return 1; }
+
+    /* Bucket típico: ~20k tokens distintos con frecuencias sesgadas, offsets
+       de un CSV de ~3 GB (bytes altos en cero) */
+    size_t ntok = 20000;
+    uint64_t *tok  = malloc(ntok * sizeof(uint64_t));
+    uint64_t *src  = malloc(n * 2 * sizeof(uint64_t));
+    uint64_t *work = malloc(n * 2 * sizeof(uint64_t));
+    uint64_t *ref  = malloc(n * 2 * sizeof(uint64_t));
+    uint64_t *scr  = malloc(n * 2 * sizeof(uint64_t));
+    if (!tok || !src || !work || !ref || !scr){ fprintf(stderr, "Memoria insuficiente\n"); return 1; }
+    for (size_t i=0; i<ntok; i++) tok[i] = (xorshift() & ~0xFFULL) | 0x2A;
+    for (size_t i=0; i<n; i++){
+        uint64_t r = xorshift();
+        size_t t = (size_t)((r % ntok) * (r % ntok) / ntok);      // sesgo hacia tokens frecuentes
+        src[2*i]   = tok[t];
+        src[2*i+1] = xorshift() % (3ULL << 30);
+    }
+
+    printf("n = %zu, repeticiones = %d (mejor tiempo)\n", n, reps);
+    const char *names[2] = { "pares (hash, offset)", "offsets uint64" };
+    for (int kind=0; kind<2; kind++){
+        size_t esz = kind == 0 ? 2 : 1;
+        double best_q = 1e30, best_r = 1e30, best_rs = 1e30;
+        for (int r=0; r<reps; r++){
+            double t0;
+            if (kind == 0){
+                memcpy(ref, src, n * 16);
+                t0 = now_ms(); qsort(ref, n, 16, cmp_pair); t0 = now_ms() - t0; if (t0 < best_q) best_q = t0;
+                memcpy(work, src, n * 16);
+                t0 = now_ms(); radix_sort_pairs(work, n, NULL); t0 = now_ms() - t0; if (t0 < best_r) best_r = t0;
+                memcpy(work, src, n * 16);
+                t0 = now_ms(); radix_sort_pairs(work, n, scr); t0 = now_ms() - t0; if (t0 < best_rs) best_rs = t0;
+            } else {
+                for (size_t i=0; i<n; i++) ref[i] = src[2*i+1];
+                memcpy(work, ref, n * 8);
+                t0 = now_ms(); qsort(ref, n, 8, cmp_u64); t0 = now_ms() - t0; if (t0 < best_q) best_q = t0;
+                for (size_t i=0; i<n; i++) work[i] = src[2*i+1];
+                t0 = now_ms(); radix_sort_u64(work, n, NULL); t0 = now_ms() - t0; if (t0 < best_r) best_r = t0;
+                for (size_t i=0; i<n; i++) work[i] = src[2*i+1];
+                t0 = now_ms(); radix_sort_u64(work, n, scr); t0 = now_ms() - t0; if (t0 < best_rs) best_rs = t0;
+            }
+            if (memcmp(ref, work, n * esz * 8) != 0){ fprintf(stderr, "ERROR: %s: resultados distintos\n", names[kind]); return 1; }
+        }
+        printf("%-22s qsort %9.1f ms | radix %9.1f ms | radix+scratch %9.1f ms | x%.1f\n",
+               names[kind], best_q, best_r, best_rs, best_q / best_rs);
+    }
+    free(tok); free(src); free(work); free(ref); free(scr);
+    return 0;
+}
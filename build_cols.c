@@ -0,0 +1,121 @@
+// build_cols.c
+// Snapshot columnar del CSV (ver colstore.h): una lectura del CSV y un
+// archivo por columna en <dir_cols>/, con región, artista y nombre como
+// diccionarios, fecha, rank y streams como enteros y el track_id
+// empaquetado en 16 bytes. Las filas se numeran como en nameidx (0 =
+// primera fila de datos).
+//
+// Las filas "cortas" que agrega ADD (track_id,name,artist,album,duration_ms)
+// entran con su id, nombre y artista y sin fecha, región, rank ni streams.
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "colstore.h"
+
+#define MAXF 256
+
+/* ---------- CSV (respeta comillas) ---------- */
+static size_t parse_csv_line(const char *line, char **out, size_t max_fields){
+    size_t n=0, L=strlen(line), bi=0; int inq=0;
+    char *buf=(char*)malloc(L+1); if(!buf) return 0;
+    for(size_t i=0;i<L;i++){
+        char c=line[i];
+        if(c=='"'){
+            if(inq && i+1<L && line[i+1]=='"'){ buf[bi++]='"'; i++; }
+            else { inq=!inq; }
+        } else if(c==',' && !inq){
+            buf[bi]='\0'; if(n<max_fields) out[n++]=strdup(buf); bi=0;
+        } else if(c=='\r' || c=='\n'){
+            /* ignore */
+        } else {
+            buf[bi++]=c;
+        }
+    }
+    buf[bi]='\0'; if(n<max_fields) out[n++]=strdup(buf);
+    free(buf); return n;
+}
+static void free_fields(char **f, size_t n){ for(size_t i=0;i<n;i++) free(f[i]); }
+static int find_col(char **hdr, size_t n, const char *name){
+    for(size_t i=0;i<n;i++) if(hdr[i] && strcasecmp(hdr[i],name)==0) return (int)i;
+    return -1;
+}
+static int ensure_dir(const char *path){
+    struct stat st;
+    if (stat(path,&st)==0){ if(S_ISDIR(st.st_mode)) return 0; errno=ENOTDIR; return -1; }
+    return mkdir(path, 0775);
+}
+/* Campo c de la fila o NULL si la fila no lo tiene */
+static const char *fld(char **f, size_t nx, int c){ return (c>=0 && (size_t)c<nx) ? f[c] : NULL; }
+
+int main(int argc, char **argv){
+    if (argc < 3){ fprintf(stderr,"Uso: %s <dataset.csv> <dir_cols>\n", argv[0]); return 1; }
+    const char *csv=argv[1], *dir=argv[2];
+    if (ensure_dir(dir)!=0 && errno!=EEXIST){ perror("mkdir dir_cols"); return 1; }
+
+    FILE *fp=fopen(csv,"r");
+    if(!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); return 1; }
+    setvbuf(fp,NULL,_IOFBF,4*1024*1024);
+
+    char *line=NULL; size_t bufcap=0; ssize_t len=getline(&line,&bufcap,fp);
+    if(len<=0){ fprintf(stderr,"CSV vacío\n"); fclose(fp); free(line); return 1; }
+    char *hdr[MAXF]={0}; size_t nf=parse_csv_line(line,hdr,MAXF);
+    int col_id      = find_col(hdr,nf,"track_id");
+    int col_name    = find_col(hdr,nf,"track_name");
+    int col_artist  = find_col(hdr,nf,"artist");
+    int col_date    = find_col(hdr,nf,"date");
+    int col_region  = find_col(hdr,nf,"region");
+    int col_rank    = find_col(hdr,nf,"rank");
+    int col_streams = find_col(hdr,nf,"streams");
+    free_fields(hdr,nf);
+    if (col_id < 0){
+        fprintf(stderr,"No se encontró la columna 'track_id'.\n");
+        fclose(fp); free(line); return 1;
+    }
+    // Como en build_indexes: el CSV mezclado nombra "title" a track_name
+    if (col_name   < 0) col_name = 1;
+    if (col_artist < 0) col_artist = 4;
+    if (col_date   < 0) col_date = 3;
+    if (col_region < 0) col_region = 6;
+    fprintf(stderr,"Columnas: track_id=%d, track_name=%d, artist=%d, date=%d, region=%d, rank=%d, streams=%d\n",
+            col_id, col_name, col_artist, col_date, col_region, col_rank, col_streams);
+
+    ColsBuilder b;
+    if (cols_begin(&b, dir)!=0){
+        fprintf(stderr,"No puedo crear el snapshot en %s: %s\n", dir, strerror(errno));
+        fclose(fp); free(line); return 1;
+    }
+
+    uint64_t rows=0;
+    for(;;){
+        len=getline(&line,&bufcap,fp);
+        if(len<=0) break;
+        char *f[MAXF]={0}; size_t nx=parse_csv_line(line,f,MAXF);
+        if (nx==5 && nf!=5)     /* fila corta de ADD */
+            cols_add(&b, f[0], f[1], f[2], NULL, NULL, NULL, NULL);
+        else
+            cols_add(&b, fld(f,nx,col_id), fld(f,nx,col_name), fld(f,nx,col_artist), fld(f,nx,col_date),
+                     fld(f,nx,col_region), fld(f,nx,col_rank), fld(f,nx,col_streams));
+        free_fields(f,nx);
+
+        rows++;
+        if ((rows%1000000ULL)==0) fprintf(stderr,"Filas procesadas: %llu\n",(unsigned long long)rows);
+    }
+    off_t csv_size=ftello(fp);
+    free(line); fclose(fp);
+    if (cols_finish(&b, (uint64_t)csv_size)!=0) return 1;
+
+    fprintf(stderr,"Snapshot listo en %s/: %llu filas\n", dir, (unsigned long long)rows);
+    return 0;
+}
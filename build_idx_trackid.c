@@ -1,5 +1,31 @@
 // build_idx_trackid.c
 // Construye un índice hash en disco por 'track_id' -> offset de línea (CSV).
+//
+// Modos:
+//   ./build_idx <dataset.csv> <tracks.idx>          dos pasadas con getline (1 hilo)
+//   ./build_idx -j N <dataset.csv> <tracks.idx>     CSV mapeado una vez, N hilos
+//
+// Formato (-f): v2 (por defecto, IDX2TRK con la clave en el slot; cada
+// track_id ocupa un solo slot con su primera fila), v1 (IDX1TRK, una
+// entrada por fila) o swiss (IDX3SWT, grupos de 16 con tags de 7 bits;
+// -l fija el factor de carga, 0.875 por defecto). Ver track_idx.h.
+// mph (IDX4MPH) es un hash perfecto mínimo de solo lectura: 8 B por track_id
+// distinto más ~4 bits de la cascada; ADD lo rechaza (EROFS), es para
+// réplicas que solo consultan.
+// -r escribe además <tracks.idx>.rows con todas las filas de cada track_id
+// (historial en los charts, ordenado por fecha y región; ver track_rows.h)
+// con una lectura extra del CSV. Sin -r se borra un .rows anterior.
+//
+// swiss y mph se construyen primero como v2 en <tracks.idx>.v2tmp y luego
+// se reescriben dimensionados por el número de track_id distintos.
+//
+// Modo paralelo (-j): el CSV se mapea con mmap y se parte en N trozos. Una
+// primera lectura ligera (sin parsear) cuenta comillas y saltos de línea de
+// cada trozo; con eso se conoce el estado de comillas al inicio de cada trozo
+// (los cortes nunca caen dentro de un campo entre comillas) y el número total
+// de filas para dimensionar la tabla. Después cada hilo extrae 'track_id' de
+// sus filas e inserta en la tabla mapeada con compare-and-swap sobre 'hash'
+// (trackidx_put_concurrent).
 
 
 #define _POSIX_C_SOURCE 200809L
@@ -18,24 +44,13 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 
-#define MAXF 256
-#define MAGIC "IDX1TRK"
-#define VERSION 1
-
-typedef struct {
-    char     magic[8];
-    uint64_t capacity;   // número de slots (potencia de 2)
-    uint32_t key_col;    // índice de columna usada como clave
-    uint32_t version;    // versión de formato
-    uint64_t reserved[3];
-} __attribute__((packed)) IdxHeader;
-
-typedef struct {
-    uint64_t hash;       // 0 = slot vacío
-    uint64_t offset;     // offset del inicio de la línea en el CSV
-} __attribute__((packed)) Slot;
+#include "track_idx.h"
+#include "track_rows.h"
 
+#define MAXF 256
+#define MAX_THREADS 256
 /* -------------------- util CSV -------------------- */
 static size_t parse_csv_line(const char *line, char **out, size_t max_fields) {
     size_t n = 0, L = strlen(line);
@@ -74,14 +89,6 @@ static int find_col(char **hdr, size_t n, const char *name){
 }
 
 /* -------------------- hash y helpers -------------------- */
-static uint64_t fnv1a64(const char *s){
-    const uint64_t FNV_OFFSET = 1469598103934665603ULL;
-    const uint64_t FNV_PRIME  = 1099511628211ULL;
-    uint64_t h = FNV_OFFSET;
-    for (const unsigned char *p=(const unsigned char*)s; *p; ++p){ h^=(uint64_t)*p; h*=FNV_PRIME; }
-    if (h==0) h=1; // reservar 0 para "vacío"
-    return h;
-}
 static uint64_t next_pow2(uint64_t v){
     if (v <= 1) return 1;
     v--; v|=v>>1; v|=v>>2; v|=v>>4; v|=v>>8; v|=v>>16; v|=v>>32; v++;
@@ -103,28 +110,237 @@ static uint64_t count_rows(FILE *fp){
     return n;
 }
 
-/* -------------------- tabla hash (linear probing) -------------------- */
-static void insert_slot(Slot *slots, uint64_t table_cap, uint64_t h, uint64_t off){
-    uint64_t i = h & (table_cap - 1);
-    for (;;) {
-        if (slots[i].hash == 0){
-            slots[i].hash   = h;
-            slots[i].offset = off;
-            return;
+/* -------------------- modo paralelo (mmap + hilos) -------------------- */
+/* Recorre un registro CSV que empieza en p (fuera de comillas) y copia la
+   columna 'col' a out (mismas reglas que parse_csv_line: "" -> ", se ignoran
+   \r). Devuelve el inicio del registro siguiente (tras el '\n' fuera de comillas). */
+static const char *scan_record(const char *p, const char *end, int col,
+                               char *out, size_t outsz, size_t *outlen){
+    int inq = 0, fi = 0; size_t bi = 0;
+    *outlen = 0;
+    while (p < end){
+        char c = *p++;
+        if (c == '"'){
+            if (inq && p < end && *p == '"'){ if (fi==col && bi+1<outsz) out[bi++]='"'; p++; }
+            else inq = !inq;
+        } else if (c == ',' && !inq){
+            if (fi == col) *outlen = bi;
+            fi++;
+        } else if (c == '\n' && !inq){
+            break;
+        } else if (c == '\r' || c == '\n'){
+            /* ignore */
+        } else if (fi == col && bi+1 < outsz){
+            out[bi++] = c;
+        }
+    }
+    if (fi == col) *outlen = bi;
+    out[*outlen] = '\0';
+    return p;
+}
+
+typedef struct {
+    const char *base;     // inicio del mapeo (offsets = p - base)
+    size_t beg, end;      // trozo [beg,end) del archivo
+    size_t data_end;      // fin del archivo (un registro puede salirse del trozo)
+    int    col;           // columna track_id
+    int    inq;           // estado de comillas al inicio del trozo (fase 2)
+    /* fase 1 */
+    uint64_t quotes;      // nº de '"' del trozo
+    uint64_t nl[2];       // '\n' vistos con inq==0 / inq==1 (suponiendo inicio fuera)
+    /* fase 2 */
+    TrackIdx *ti;
+    uint64_t rows;        // filas con track_id
+    uint64_t inserted;    // slots ocupados (claves nuevas)
+} Chunk;
+
+static void *chunk_count(void *arg){
+    Chunk *c = (Chunk*)arg;
+    const char *p = c->base + c->beg, *e = c->base + c->end;
+    uint64_t q = 0, nl[2] = {0,0}; int inq = 0;
+    for (; p < e; ++p){
+        if (*p == '"'){ q++; inq ^= 1; }
+        else if (*p == '\n') nl[inq]++;
+    }
+    c->quotes = q; c->nl[0] = nl[0]; c->nl[1] = nl[1];
+    return NULL;
+}
+
+static void *chunk_insert(void *arg){
+    Chunk *c = (Chunk*)arg;
+    const char *p = c->base + c->beg, *lim = c->base + c->end, *e = c->base + c->data_end;
+    char key[MAXF];
+
+    /* Avanzar hasta el primer registro que empieza dentro del trozo */
+    if (c->beg > 0 && !(c->inq == 0 && p[-1] == '\n')){
+        int inq = c->inq;
+        while (p < lim){
+            char ch = *p++;
+            if (ch == '"') inq ^= 1;
+            else if (ch == '\n' && !inq) break;
         }
-        i = (i + 1) & (table_cap - 1);
     }
+    while (p < lim){
+        uint64_t off = (uint64_t)(p - c->base);
+        size_t klen;
+        p = scan_record(p, e, c->col, key, sizeof(key), &klen);
+        if (klen > 0){
+            uint8_t k[16]; uint64_t kind = trk_pack_key(key, k);
+            c->inserted += (uint64_t)trackidx_put_concurrent(c->ti, trk_hash(key), kind, k, off);
+            c->rows++;
+        }
+    }
+    return NULL;
+}
+
+static int build_parallel(const char *csv_path, const char *idx_path, int col, int format, int nthreads){
+    int cfd = open(csv_path, O_RDONLY);
+    if (cfd < 0){ fprintf(stderr, "No abre CSV: %s\n", strerror(errno)); return 1; }
+    off_t csz = lseek(cfd, 0, SEEK_END);
+    if (csz <= 0){ fprintf(stderr, "CSV vacío.\n"); close(cfd); return 1; }
+    const char *data = mmap(NULL, (size_t)csz, PROT_READ, MAP_SHARED, cfd, 0);
+    if (data == MAP_FAILED){ fprintf(stderr, "mmap CSV: %s\n", strerror(errno)); close(cfd); return 1; }
+    posix_madvise((void*)data, (size_t)csz, POSIX_MADV_SEQUENTIAL);
+
+    // saltar encabezado (primera línea física, como getline)
+    const char *nl = memchr(data, '\n', (size_t)csz);
+    size_t body = nl ? (size_t)(nl - data) + 1 : (size_t)csz;
+    size_t blen = (size_t)csz - body;
+
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+    if ((size_t)nthreads > blen / 4096 + 1) nthreads = (int)(blen / 4096 + 1);
+
+    Chunk ch[MAX_THREADS]; pthread_t th[MAX_THREADS]; int started[MAX_THREADS];
+    memset(ch, 0, sizeof(ch));
+    for (int k=0; k<nthreads; k++){
+        ch[k].base = data; ch[k].data_end = (size_t)csz; ch[k].col = col;
+        ch[k].beg = body + blen * (size_t)k / (size_t)nthreads;
+        ch[k].end = body + blen * (size_t)(k+1) / (size_t)nthreads;
+    }
+
+    // Fase 1: comillas y saltos de línea por trozo
+    // (un trozo sin hilo se procesa en este)
+    for (int k=0; k<nthreads; k++) started[k] = pthread_create(&th[k], NULL, chunk_count, &ch[k]) == 0;
+    for (int k=0; k<nthreads; k++){ if (started[k]) pthread_join(th[k], NULL); else chunk_count(&ch[k]); }
+
+    uint64_t nrows = 0; int inq = 0;
+    for (int k=0; k<nthreads; k++){
+        ch[k].inq = inq;
+        nrows += ch[k].nl[inq];
+        inq ^= (int)(ch[k].quotes & 1);
+    }
+    if (blen > 0 && data[csz-1] != '\n') nrows++;   // última fila sin '\n'
+    fprintf(stderr, "Filas de datos: %llu (hilos: %d)\n", (unsigned long long)nrows, nthreads);
+
+    uint64_t table_cap = next_pow2(nrows * 2 + 1);
+    fprintf(stderr, "Capacidad tabla: %llu slots\n", (unsigned long long)table_cap);
+
+    TrackIdx ti;
+    if (trackidx_create(&ti, idx_path, format, table_cap, (uint32_t)col) != 0){
+        fprintf(stderr, "No se puede crear índice: %s\n", strerror(errno));
+        munmap((void*)data,(size_t)csz); close(cfd); return 1;
+    }
+
+    // Fase 2: extraer track_id e insertar
+    for (int k=0; k<nthreads; k++){
+        ch[k].ti = &ti;
+        started[k] = pthread_create(&th[k], NULL, chunk_insert, &ch[k]) == 0;
+    }
+    uint64_t rows = 0, inserted = 0;
+    for (int k=0; k<nthreads; k++){
+        if (started[k]) pthread_join(th[k], NULL); else chunk_insert(&ch[k]);
+        rows += ch[k].rows; inserted += ch[k].inserted;
+    }
+
+    // Repetidos de un mismo hash en el orden del CSV (primera aparición primero)
+    int rc = trackidx_sort_chains(&ti);
+    if (rc != 0) fprintf(stderr, "Ordenando el índice: %s\n", strerror(errno));
+    if (trackidx_finish(&ti) != 0 && rc == 0){
+        fprintf(stderr, "Escritura %s: %s\n", idx_path, strerror(errno));
+        rc = -1;
+    }
+    munmap((void*)data, (size_t)csz);
+    close(cfd);
+    if (rc != 0) return 1;
+
+    fprintf(stderr, "Listo. Insertadas %llu filas (%llu slots).\n",
+            (unsigned long long)rows, (unsigned long long)inserted);
+    return 0;
 }
 
 /* -------------------- main -------------------- */
+static int build_table(const char *csv_path, const char *idx_path, int format, int nthreads);
+static int build_index(const char *csv_path, const char *idx_path, int format, int nthreads, double lf);
+
 int main(int argc, char **argv){
-    if (argc < 3){
-        fprintf(stderr, "Uso: %s <dataset.csv> <tracks.idx>\n", argv[0]);
+    int nthreads = 0;   // 0 = modo secuencial clásico
+    int format = TRK_FMT_V2;
+    double lf = SW_DEFAULT_LF;
+    int with_rows = 0;
+    int ai = 1;
+    while (ai+1 < argc && argv[ai][0] == '-'){
+        if (strcmp(argv[ai], "-r") == 0){ with_rows = 1; ai++; continue; }
+        if (strcmp(argv[ai], "-j") == 0){
+            nthreads = atoi(argv[ai+1]);
+            if (nthreads <= 0){
+                long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+                nthreads = ncpu > 0 ? (int)ncpu : 1;
+            }
+        } else if (strcmp(argv[ai], "-f") == 0){
+            if      (strcmp(argv[ai+1], "v1") == 0) format = TRK_FMT_V1;
+            else if (strcmp(argv[ai+1], "v2") == 0) format = TRK_FMT_V2;
+            else if (strcmp(argv[ai+1], "swiss") == 0) format = TRK_FMT_SWISS;
+            else if (strcmp(argv[ai+1], "mph") == 0) format = TRK_FMT_MPH;
+            else { fprintf(stderr, "Formato desconocido: %s (v1|v2|swiss|mph)\n", argv[ai+1]); return 1; }
+        } else if (strcmp(argv[ai], "-l") == 0){
+            lf = atof(argv[ai+1]);
+            if (!(lf > 0.0 && lf < 1.0)){ fprintf(stderr, "Factor de carga inválido: %s (0 < lf < 1)\n", argv[ai+1]); return 1; }
+        } else break;
+        ai += 2;
+    }
+    if (argc - ai < 2){
+        fprintf(stderr, "Uso: %s [-j N] [-f v1|v2|swiss|mph] [-l factor_carga] [-r] <dataset.csv> <tracks.idx>\n", argv[0]);
         return 1;
     }
-    const char *csv_path = argv[1];
-    const char *idx_path = argv[2];
+    const char *csv_path = argv[ai];
+    const char *idx_path = argv[ai+1];
+
+    int rc = build_index(csv_path, idx_path, format, nthreads, lf);
+    char rows_path[600]; trackrows_path(rows_path, sizeof(rows_path), idx_path);
+    if (rc != 0 || !with_rows){ unlink(rows_path); return rc; }
+    if (trackrows_build(csv_path, idx_path) != 0){
+        fprintf(stderr, "No se puede crear %s: %s\n", rows_path, strerror(errno));
+        return 1;
+    }
+    fprintf(stderr, "Historial por track listo: %s\n", rows_path);
+    return 0;
+}
 
+/* tracks.idx en el formato pedido */
+static int build_index(const char *csv_path, const char *idx_path, int format, int nthreads, double lf){
+    if (format == TRK_FMT_SWISS || format == TRK_FMT_MPH){
+        char tmp_path[600];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.v2tmp", idx_path);
+        int rc = build_table(csv_path, tmp_path, TRK_FMT_V2, nthreads);
+        if (rc != 0){ unlink(tmp_path); return rc; }
+        const char *name = (format == TRK_FMT_MPH) ? "mph" : "swiss";
+        rc = (format == TRK_FMT_MPH) ? trackidx_write_mph(tmp_path, idx_path)
+                                     : trackidx_write_swiss(tmp_path, csv_path, idx_path, lf);
+        if (rc != 0){
+            fprintf(stderr, "No se puede crear índice %s: %s\n", name, strerror(errno));
+            unlink(tmp_path); return 1;
+        }
+        unlink(tmp_path);
+        if (format == TRK_FMT_MPH) fprintf(stderr, "Índice mph listo (solo lectura).\n");
+        else fprintf(stderr, "Índice swiss listo (factor de carga %.3f).\n", lf);
+        return 0;
+    }
+    return build_table(csv_path, idx_path, format, nthreads);
+}
+
+/* Construcción v1/v2 (secuencial o paralela) */
+static int build_table(const char *csv_path, const char *idx_path, int format, int nthreads){
     FILE *fp = fopen(csv_path, "r");
     if (!fp){ fprintf(stderr, "No abre CSV: %s\n", strerror(errno)); return 1; }
 
@@ -142,6 +358,11 @@ int main(int argc, char **argv){
     fprintf(stderr, "Columna track_id = %d\n", col);
     free_fields(hdr, nf);
 
+    if (nthreads > 0){
+        fclose(fp); free(line);
+        return build_parallel(csv_path, idx_path, col, format, nthreads);
+    }
+
     // Rewind y contar filas
     if (fseeko(fp, 0, SEEK_SET) != 0){ perror("fseeko"); fclose(fp); free(line); return 1; }
     uint64_t nrows = count_rows(fp);
@@ -152,40 +373,18 @@ int main(int argc, char **argv){
     fprintf(stderr, "Capacidad tabla: %llu slots\n", (unsigned long long)table_cap);
 
     // Crear y mapear archivo de índice
-    int fd = open(idx_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
-    if (fd < 0){ fprintf(stderr, "No se puede crear índice: %s\n", strerror(errno)); fclose(fp); free(line); return 1; }
-
-    size_t header_size = sizeof(IdxHeader);
-    size_t slots_size  = sizeof(Slot) * table_cap;
-    off_t total = (off_t)(header_size + slots_size);
-
-    if (ftruncate(fd, total) != 0){
-        fprintf(stderr, "ftruncate: %s\n", strerror(errno));
-        close(fd); fclose(fp); free(line); return 1;
-    }
-
-    void *map = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (map == MAP_FAILED){
-        fprintf(stderr, "mmap: %s\n", strerror(errno));
-        close(fd); fclose(fp); free(line); return 1;
+    TrackIdx ti;
+    if (trackidx_create(&ti, idx_path, format, table_cap, (uint32_t)col) != 0){
+        fprintf(stderr, "No se puede crear índice: %s\n", strerror(errno)); fclose(fp); free(line); return 1;
     }
-    memset(map, 0, total);
-
-    IdxHeader *hdrp = (IdxHeader*)map;
-    memcpy(hdrp->magic, MAGIC, strlen(MAGIC));
-    hdrp->capacity = table_cap;
-    hdrp->key_col  = (uint32_t)col;
-    hdrp->version  = VERSION;
-
-    Slot *slots = (Slot*)((char*)map + header_size);
 
     // Segunda pasada: poblar índice
-    if (fseeko(fp, 0, SEEK_SET) != 0){ perror("fseeko"); munmap(map,total); close(fd); fclose(fp); free(line); return 1; }
+    if (fseeko(fp, 0, SEEK_SET) != 0){ perror("fseeko"); trackidx_close(&ti); fclose(fp); free(line); return 1; }
     // saltar encabezado
     len = getline(&line, &bufcap, fp);
     (void)len;
 
-    uint64_t inserted = 0;
+    uint64_t inserted = 0, slots_used = 0;
     for (;;) {
         off_t off = ftello(fp);                    // inicio de la línea
         len = getline(&line, &bufcap, fp);
@@ -194,8 +393,8 @@ int main(int argc, char **argv){
         char *f[MAXF] = {0};
         size_t nx = parse_csv_line(line, f, MAXF);
         if (nx > (size_t)col && f[col] && f[col][0]){
-            uint64_t h = fnv1a64(f[col]);
-            insert_slot(slots, table_cap, h, (uint64_t)off);
+            uint8_t k[16]; uint64_t kind = trk_pack_key(f[col], k);
+            slots_used += (uint64_t)trackidx_put(&ti, trk_hash(f[col]), kind, k, (uint64_t)off);
             inserted++;
         }
         free_fields(f, nx);
@@ -204,12 +403,13 @@ int main(int argc, char **argv){
             fprintf(stderr, "Insertadas: %llu\n", (unsigned long long)inserted);
     }
 
-    msync(map, total, MS_SYNC);
-    munmap(map, total);
-    close(fd);
+    int rc = trackidx_finish(&ti);
+    if (rc != 0) fprintf(stderr, "Escritura %s: %s\n", idx_path, strerror(errno));
     fclose(fp);
     free(line);
+    if (rc != 0) return 1;
 
-    fprintf(stderr, "Listo. Insertadas %llu claves.\n", (unsigned long long)inserted);
+    fprintf(stderr, "Listo. Insertadas %llu filas (%llu slots).\n",
+            (unsigned long long)inserted, (unsigned long long)slots_used);
     return 0;
 }
@@ -0,0 +1,283 @@
+// build_indexes.c
+// Indexador unificado: una sola lectura del CSV produce
+//   - tracks.idx   (hash por track_id, IDX2TRK; -f v1|swiss|mph como en build_idx)
+//   - nameidx/     (índice invertido por track_name + artist -> filas, igual que build_name_index;
+//                  --mem-budget y -j también)
+//   - con -r, tracks.idx.rows (todas las filas de cada track_id, ver track_rows.h)
+//   - nameidx/docs.seg (lo que muestra una búsqueda, por fila; ver docstore.h)
+// Cada fila se parsea una vez y cada token se hashea una vez.
+// Las entradas (hash, offset, clave empaquetada) se vuelcan a <tracks.idx>.tmp
+// durante la lectura; al terminar ya se conoce el número de filas, se
+// dimensiona la tabla y se insertan en el mismo orden que lo haría build_idx.
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "nameidx_build.h"
+#include "docstore.h"
+#include "zonemap.h"
+#include "track_idx.h"
+#include "track_rows.h"
+
+#define MAXF 256
+/* -------------------- util CSV -------------------- */
+static size_t parse_csv_line(const char *line, char **out, size_t max_fields) {
+    size_t n = 0, L = strlen(line);
+    char *buf = (char*)malloc(L + 1);
+    if (!buf) return 0;
+    size_t bi = 0; int inq = 0;
+
+    for (size_t i=0; i<L; ++i) {
+        char c = line[i];
+        if (c == '"') {
+            if (inq && i+1 < L && line[i+1] == '"') { buf[bi++] = '"'; ++i; }
+            else inq = !inq;
+        } else if (c == ',' && !inq) {
+            buf[bi] = '\0';
+            if (n < max_fields) out[n++] = strdup(buf);
+            bi = 0;
+        } else if (c == '\r' || c == '\n') {
+            // ignore
+        } else {
+            buf[bi++] = c;
+        }
+    }
+    buf[bi] = '\0';
+    if (n < max_fields) out[n++] = strdup(buf);
+    free(buf);
+    return n;
+}
+static void free_fields(char **f, size_t n){ for (size_t i=0;i<n;i++) free(f[i]); }
+
+static int find_col(char **hdr, size_t n, const char *name){
+    for (size_t i=0;i<n;i++){
+        if (!hdr[i]) continue;
+        if (strcasecmp(hdr[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/* -------------------- hash y helpers -------------------- */
+static uint64_t next_pow2(uint64_t v){
+    if (v <= 1) return 1;
+    v--; v|=v>>1; v|=v>>2; v|=v>>4; v|=v>>8; v|=v>>16; v|=v>>32; v++;
+    return v;
+}
+static int ensure_dir(const char *path){
+    struct stat st;
+    if (stat(path,&st)==0){ if(S_ISDIR(st.st_mode)) return 0; errno=ENOTDIR; return -1; }
+    return mkdir(path, 0775);
+}
+
+/* Vuelca las entradas de tmp_path (registros Slot2) a una tabla nueva */
+static int write_track_table(const char *tmp_path, const char *idx_path, int format, int col, uint64_t nrows){
+    uint64_t table_cap = next_pow2(nrows * 2 + 1);
+    fprintf(stderr, "Capacidad tabla: %llu slots\n", (unsigned long long)table_cap);
+
+    FILE *ft = fopen(tmp_path, "rb");
+    if (!ft){ fprintf(stderr, "No abre %s: %s\n", tmp_path, strerror(errno)); return -1; }
+    setvbuf(ft, NULL, _IOFBF, 4*1024*1024);
+
+    TrackIdx ti;
+    if (trackidx_create(&ti, idx_path, format, table_cap, (uint32_t)col) != 0){
+        fprintf(stderr, "No se puede crear índice: %s\n", strerror(errno)); fclose(ft); return -1;
+    }
+
+    uint64_t inserted = 0, slots_used = 0;
+    Slot2 e;
+    while (fread(&e, sizeof(e), 1, ft) == 1){
+        slots_used += (uint64_t)trackidx_put(&ti, e.hash, e.offset & TRK_KEY_FLAGS, e.key, e.offset & TRK_OFF_MASK);
+        inserted++;
+    }
+    fclose(ft);
+
+    if (trackidx_finish(&ti) != 0){
+        fprintf(stderr, "Escritura %s: %s\n", idx_path, strerror(errno));
+        return -1;
+    }
+    fprintf(stderr, "tracks.idx listo. Insertadas %llu filas (%llu slots).\n",
+            (unsigned long long)inserted, (unsigned long long)slots_used);
+    return 0;
+}
+
+/* swiss/mph: tabla v2 intermedia en <idx>.v2tmp y reescritura por claves distintas */
+static int write_rebuilt_table(const char *tmp_path, const char *csv_path, const char *idx_path, int format, int col, uint64_t nrows){
+    char v2_path[600];
+    snprintf(v2_path, sizeof(v2_path), "%s.v2tmp", idx_path);
+    if (write_track_table(tmp_path, v2_path, TRK_FMT_V2, col, nrows) != 0) return -1;
+    int rc = (format == TRK_FMT_MPH) ? trackidx_write_mph(v2_path, idx_path)
+                                     : trackidx_write_swiss(v2_path, csv_path, idx_path, SW_DEFAULT_LF);
+    if (rc != 0) fprintf(stderr, "No se puede crear índice %s: %s\n",
+                         format == TRK_FMT_MPH ? "mph" : "swiss", strerror(errno));
+    unlink(v2_path);
+    return rc;
+}
+
+/* -------------------- main -------------------- */
+int main(int argc, char **argv){
+    int format = TRK_FMT_V2, with_rows = 0, ai = 1;
+    size_t budget = 0;
+    int nthreads = 1;
+    while (ai < argc && argv[ai][0] == '-'){
+        if (strcmp(argv[ai], "-j") == 0 && ai+1 < argc){
+            nthreads = atoi(argv[ai+1]);
+            if (nthreads <= 0){ long ncpu = sysconf(_SC_NPROCESSORS_ONLN); nthreads = ncpu > 0 ? (int)ncpu : 1; }
+            ai += 2; continue;
+        }
+        if (strcmp(argv[ai], "-r") == 0){ with_rows = 1; ai++; continue; }
+        if (strcmp(argv[ai], "--mem-budget") == 0 && ai+1 < argc){
+            budget = nameidx_parse_size(argv[ai+1]);
+            if (!budget){ fprintf(stderr, "Tamaño inválido: %s (ej. 512M)\n", argv[ai+1]); return 1; }
+            ai += 2; continue;
+        }
+        if (strcmp(argv[ai], "-f") != 0 || ai+1 >= argc) break;
+        if      (strcmp(argv[ai+1], "v1") == 0) format = TRK_FMT_V1;
+        else if (strcmp(argv[ai+1], "v2") == 0) format = TRK_FMT_V2;
+        else if (strcmp(argv[ai+1], "swiss") == 0) format = TRK_FMT_SWISS;
+        else if (strcmp(argv[ai+1], "mph") == 0) format = TRK_FMT_MPH;
+        else { fprintf(stderr, "Formato desconocido: %s (v1|v2|swiss|mph)\n", argv[ai+1]); return 1; }
+        ai += 2;
+    }
+    if (argc - ai < 3){
+        fprintf(stderr, "Uso: %s [-f v1|v2|swiss|mph] [-r] [-j N] [--mem-budget N[K|M|G]] <dataset.csv> <tracks.idx> <dir_nameidx>\n", argv[0]);
+        return 1;
+    }
+    const char *csv_path = argv[ai], *idx_path = argv[ai+1], *dir = argv[ai+2];
+    if (ensure_dir(dir)!=0 && errno!=EEXIST){ perror("mkdir dir_nameidx"); return 1; }
+
+    FILE *fp = fopen(csv_path, "r");
+    if (!fp){ fprintf(stderr, "No abre CSV: %s\n", strerror(errno)); return 1; }
+    setvbuf(fp, NULL, _IOFBF, 4*1024*1024);
+
+    // Encabezado: columnas de las dos claves
+    char *line = NULL; size_t bufcap = 0; ssize_t len = getline(&line, &bufcap, fp);
+    if (len <= 0){ fprintf(stderr, "CSV vacío.\n"); fclose(fp); free(line); return 1; }
+
+    char *hdr[MAXF] = {0};
+    size_t nf = parse_csv_line(line, hdr, MAXF);
+    int col_id     = find_col(hdr, nf, "track_id");
+    int col_name   = find_col(hdr, nf, "track_name");
+    int col_artist = find_col(hdr, nf, "artist");
+    int col_date   = find_col(hdr, nf, "date");
+    int col_region = find_col(hdr, nf, "region");
+    free_fields(hdr, nf);
+    if (col_id < 0){
+        fprintf(stderr, "No se encontró la columna 'track_id'.\n");
+        fclose(fp); free(line); return 1;
+    }
+    if (col_name   < 0) col_name = 1;
+    if (col_artist < 0) col_artist = 4;
+    if (col_date   < 0) col_date = 3;
+    if (col_region < 0) col_region = 6;
+    fprintf(stderr, "Columnas: track_id=%d, track_name=%d, artist=%d\n", col_id, col_name, col_artist);
+
+    char tmp_path[600];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", idx_path);
+    FILE *ft = fopen(tmp_path, "wb");
+    if (!ft){ fprintf(stderr, "No puedo crear %s: %s\n", tmp_path, strerror(errno)); fclose(fp); free(line); return 1; }
+    setvbuf(ft, NULL, _IOFBF, 4*1024*1024);
+
+    NameSpill sp;
+    if (nameidx_spill_open(&sp, dir, budget) != 0){ fclose(ft); fclose(fp); free(line); return 1; }
+
+    // Historial por track (-r); sin -r se borra uno viejo para que no quede desfasado
+    char rows_path[600]; trackrows_path(rows_path, sizeof(rows_path), idx_path);
+    RowsBuilder rb;
+    if (!with_rows) unlink(rows_path);
+    else if (trackrows_begin(&rb, rows_path) != 0){
+        fprintf(stderr, "No puedo crear %s: %s\n", rows_path, strerror(errno));
+        nameidx_spill_close(&sp); fclose(ft); fclose(fp); free(line); return 1;
+    }
+
+    // Columnas de la salida compacta por fila (sin docs.seg se leen del CSV)
+    DocsBuilder db;
+    int with_docs = docs_begin(&db, dir, (DocCols){ col_id, col_name, col_artist, col_date, col_region }) == 0;
+    if (!with_docs) fprintf(stderr, "Aviso: sin %s/" DOCS_NAME " (%s)\n", dir, strerror(errno));
+    // Fechas y regiones por tramo de filas (filtros de SEARCH)
+    ZonesBuilder zb;
+    int with_zones = zones_begin(&zb, dir) == 0;
+    if (!with_zones) fprintf(stderr, "Aviso: sin %s/" ZONES_NAME " (%s)\n", dir, strerror(errno));
+
+    // Única lectura del CSV
+    uint64_t rows = 0;
+    for (;;){
+        off_t off = ftello(fp);
+        len = getline(&line, &bufcap, fp);
+        if (len <= 0) break;
+        uint32_t row = nameidx_spill_row(&sp, (uint64_t)off);
+
+        char *f[MAXF] = {0};
+        size_t nx = parse_csv_line(line, f, MAXF);
+        if (with_docs) docs_add(&db, f, nx);
+        if (with_zones){
+            int full = !(nx == 5 && nf != 5);   // la fila corta de ADD no tiene fecha ni región
+            zones_add(&zb, full && col_date   >= 0 && (size_t)col_date   < nx ? f[col_date]   : NULL,
+                           full && col_region >= 0 && (size_t)col_region < nx ? f[col_region] : NULL);
+        }
+
+        if (nx > (size_t)col_id && f[col_id] && f[col_id][0]){
+            Slot2 e;
+            uint64_t kind = trk_pack_key(f[col_id], e.key);
+            e.hash   = trk_hash(f[col_id]);
+            e.offset = (uint64_t)off | kind;
+            fwrite(&e, sizeof(e), 1, ft);
+            if (with_rows){
+                const char *date   = col_date   < (int)nx ? f[col_date]   : NULL;
+                const char *region = col_region < (int)nx ? f[col_region] : NULL;
+                trackrows_add(&rb, f[col_id], (uint64_t)off, date, region);
+            }
+        }
+        if ((int)nx > col_name || (int)nx > col_artist){
+            const char *name   = (col_name   < (int)nx && f[col_name])   ? f[col_name]   : "";
+            const char *artist = (col_artist < (int)nx && f[col_artist]) ? f[col_artist] : "";
+            uint64_t *hs = NULL; size_t nh = nameidx_row_hashes(name, artist, &hs);
+            for (size_t t=0; t<nh; t++) nameidx_spill_add(&sp, hs[t], row);
+            free(hs);
+        }
+        free_fields(f, nx);
+
+        rows++;
+        if ((rows % 1000000ULL) == 0) fprintf(stderr, "Filas procesadas: %llu\n", (unsigned long long)rows);
+    }
+    free(line); fclose(fp);
+    if (with_docs) docs_finish(&db);
+    if (with_zones) zones_finish(&zb);
+    if (nameidx_spill_close(&sp) != 0){ fclose(ft); if (with_rows) trackrows_abort(&rb); return 1; }
+    if (fclose(ft) != 0){ fprintf(stderr, "Escritura %s: %s\n", tmp_path, strerror(errno)); return 1; }
+    fprintf(stderr, "Filas de datos: %llu\n", (unsigned long long)rows);
+
+    // tracks.idx desde el volcado (lectura secuencial, 32 B por fila)
+    int trc = (format == TRK_FMT_SWISS || format == TRK_FMT_MPH)
+            ? write_rebuilt_table(tmp_path, csv_path, idx_path, format, col_id, rows)
+            : write_track_table(tmp_path, idx_path, format, col_id, rows);
+    if (trc != 0){ if (with_rows) trackrows_abort(&rb); return 1; }
+    unlink(tmp_path);
+
+    if (with_rows){
+        if (trackrows_finish(&rb, idx_path, csv_path) != 0){
+            fprintf(stderr, "No se puede crear %s: %s\n", rows_path, strerror(errno));
+            return 1;
+        }
+        fprintf(stderr, "Historial por track listo: %s\n", rows_path);
+    }
+
+    // nameidx/: ordenar y agrupar cada bucket
+    if (nameidx_compact_buckets(&sp, nthreads) != 0) return 1;
+
+    fprintf(stderr, "Índices listos: %s y %s/\n", idx_path, dir);
+    return 0;
+}
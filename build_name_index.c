@@ -1,6 +1,18 @@
 // build_name_index.c
-// Índice invertido por tokens de track_name + artist  -> offsets (CSV)
-// Salida: 256 buckets nameidx/b00.idx ... nameidx/bff.idx
+// Índice invertido por tokens de track_name + artist  -> filas del CSV
+// Salida: nameidx/names.seg (256 buckets b00..bff juntos en un segmento)
+//         y nameidx/rows.off (offset de cada fila)
+//         y nameidx/docs.seg (lo que muestra una búsqueda, por fila; ver docstore.h)
+// (normalización, spill y compactación viven en nameidx_build.c)
+//
+// --mem-budget N[K|M|G]: tope de memoria para ordenar. Los pares se juntan
+// en un buffer de N bytes que se vuelca ordenado (un run) cada vez que se
+// llena; al final cada bucket se arma mezclando sus runs k-way, con la
+// misma salida que sin el tope. Sin la opción cada bucket se ordena entero
+// en memoria.
+//
+// -j N: compacta N buckets a la vez (0 = todos los núcleos), los más
+// grandes primero para que ninguno quede solo al final.
 
 #define _POSIX_C_SOURCE 200809L
 #ifndef _FILE_OFFSET_BITS
@@ -13,25 +25,20 @@
 #include <string.h>
 #include <strings.h>
 #include <errno.h>
-#include <ctype.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-#define MAXF 256
-#define NBKT 256        // 256 buckets -> b00..bff
+#include "nameidx_build.h"
+#include "docstore.h"
+#include "zonemap.h"
 
-typedef struct { uint64_t h, off; } Pair;
+#define MAXF 256
 
 /* ---------- Prototipos ---------- */
 static size_t   parse_csv_line(const char *line, char **out, size_t max_fields);
 static void     free_fields(char **f, size_t n);
 static int      find_col(char **hdr, size_t n, const char *name);
-static char    *normalize_utf8_basic(const char *s);
-static size_t   tokenize_unique(const char *norm, char ***out_tokens);
-static uint64_t fnv1a64(const char *s);
 static int      ensure_dir(const char *path);
-static int      cmp_strptr(const void *a, const void *b);
-static int      cmp_pair(const void *a, const void *b);
 
 /* ---------- CSV (respeta comillas) ---------- */
 static size_t parse_csv_line(const char *line, char **out, size_t max_fields){
@@ -59,76 +66,6 @@ static int find_col(char **hdr, size_t n, const char *name){
     return -1;
 }
 
-/* ---------- Normalización básica ---------- */
-static void norm_push(char **buf, size_t *len, size_t *cap, char ch){
-    if(*len+1>=*cap){ *cap=(*cap?*cap*2:64); *buf=realloc(*buf,*cap); }
-    (*buf)[(*len)++]=ch;
-}
-static char *normalize_utf8_basic(const char *s){
-    char *out=NULL; size_t L=0,C=0;
-    for(const unsigned char *p=(const unsigned char*)s; *p; ){
-        if (*p < 0x80){                      // ASCII
-            char c=(char)tolower(*p++);
-            norm_push(&out,&L,&C,c);
-        } else if (p[0]==0xC3 && p[1]){      // áéíóúüñ (y mayúsculas)
-            unsigned char c2=p[1]; char m=0;
-            switch(c2){
-                case 0xA1: case 0x81: m='a'; break; // á Á
-                case 0xA9: case 0x89: m='e'; break; // é É
-                case 0xAD: case 0x8D: m='i'; break; // í Í
-                case 0xB3: case 0x93: m='o'; break; // ó Ó
-                case 0xBA: case 0x9A: m='u'; break; // ú Ú
-                case 0xBC: case 0x9C: m='u'; break; // ü Ü
-                case 0xB1: case 0x91: m='n'; break; // ñ Ñ
-                default: m=0; break;
-            }
-            if (m){ norm_push(&out,&L,&C,m); p+=2; }
-            else   { p+=2; }                 // omite otros acentos
-        } else {
-            p++;                              // omite demás multibyte
-        }
-    }
-    norm_push(&out,&L,&C,'\0');
-    return out?out:strdup("");
-}
-
-/* ---------- Tokenización y unique por línea ---------- */
-static int cmp_strptr(const void *a, const void *b){
-    const char *const *pa=a, *const *pb=b;
-    return strcmp(*pa, *pb);
-}
-static size_t tokenize_unique(const char *norm, char ***out_tokens){
-    size_t cap=16,n=0; char **tok=malloc(cap*sizeof(char*));
-    size_t i=0,L=strlen(norm);
-    while(i<L){
-        while(i<L && !isalnum((unsigned char)norm[i])) i++;
-        if(i>=L) break;
-        size_t j=i; while(j<L && isalnum((unsigned char)norm[j])) j++;
-        if(n==cap){ cap*=2; tok=realloc(tok,cap*sizeof(char*)); }
-        tok[n++]=strndup(norm+i,j-i);
-        i=j;
-    }
-    qsort(tok,n,sizeof(char*),cmp_strptr);      // ordenar
-    size_t m=0;                                 // unique
-    for(size_t k=0;k<n;k++){
-        if (m==0 || strcmp(tok[k], tok[m-1])!=0) tok[m++]=tok[k];
-        else free(tok[k]);
-    }
-    *out_tokens=tok; return m;
-}
-
-/* ---------- Hash ---------- */
-static uint64_t fnv1a64(const char *s){
-    const uint64_t OFF=1469598103934665603ULL, PR=1099511628211ULL;
-    uint64_t h=OFF;
-    for(const unsigned char *p=(const unsigned char*)s; *p; ++p){
-        h ^= (uint64_t)*p;
-        h *= PR;
-    }
-    if(h==0){ h=1; }
-    return h;
-}
-
 /* ---------- FS helpers ---------- */
 static int ensure_dir(const char *path){
     struct stat st;
@@ -136,30 +73,26 @@ static int ensure_dir(const char *path){
     return mkdir(path, 0775);
 }
 
-/* ---------- Comparador de Pair para qsort ---------- */
-static int cmp_pair(const void *a, const void *b){
-    const Pair *x = (const Pair*)a, *y = (const Pair*)b;
-    if (x->h < y->h) return -1;
-    if (x->h > y->h) return  1;
-    if (x->off < y->off) return -1;
-    if (x->off > y->off) return  1;
-    return 0;
-}
-
 /* ---------- main ---------- */
 int main(int argc, char **argv){
-    if (argc<3){ fprintf(stderr,"Uso: %s <dataset.csv> <dir_idx>\n", argv[0]); return 1; }
-    const char *csv=argv[1], *dir=argv[2];
+    size_t budget=0; int nthreads=1, ai=1;
+    while (ai+1<argc && argv[ai][0]=='-'){
+        if (strcmp(argv[ai],"--mem-budget")==0){
+            budget=nameidx_parse_size(argv[ai+1]);
+            if (!budget){ fprintf(stderr,"Tamaño inválido: %s (ej. 512M)\n", argv[ai+1]); return 1; }
+        } else if (strcmp(argv[ai],"-j")==0){
+            nthreads=atoi(argv[ai+1]);
+            if (nthreads<=0){ long ncpu=sysconf(_SC_NPROCESSORS_ONLN); nthreads = ncpu>0 ? (int)ncpu : 1; }
+        } else break;
+        ai+=2;
+    }
+    if (argc-ai<2){ fprintf(stderr,"Uso: %s [-j N] [--mem-budget N[K|M|G]] <dataset.csv> <dir_idx>\n", argv[0]); return 1; }
+    const char *csv=argv[ai], *dir=argv[ai+1];
     if (ensure_dir(dir)!=0 && errno!=EEXIST){ perror("mkdir dir_idx"); return 1; }
 
     // Abrir 256 archivos temporales
-    FILE *bkt[NBKT]={0};
-    char path[512];
-    for(int b=0;b<NBKT;b++){
-        snprintf(path,sizeof(path),"%s/b%02x.tmp",dir,b);
-        bkt[b]=fopen(path,"wb");
-        if(!bkt[b]){ fprintf(stderr,"No puedo crear %s: %s\n", path, strerror(errno)); return 1; }
-    }
+    NameSpill sp;
+    if (nameidx_spill_open(&sp, dir, budget)!=0) return 1;
 
     FILE *fp=fopen(csv,"r");
     if(!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); return 1; }
@@ -172,38 +105,47 @@ int main(int argc, char **argv){
     char *hdr[MAXF]={0}; size_t nf=parse_csv_line(line,hdr,MAXF);
     int col_name   = find_col(hdr,nf,"track_name");
     int col_artist = find_col(hdr,nf,"artist");
+    DocCols dc = DOCS_DEFAULT_COLS;
+    int c;
+    if ((c=find_col(hdr,nf,"track_id"))>=0) dc.track_id = c;
+    if ((c=find_col(hdr,nf,"date"))    >=0) dc.date     = c;
+    if ((c=find_col(hdr,nf,"region"))  >=0) dc.region   = c;
     if (col_name   < 0) col_name = 1; // por tu CSV
     if (col_artist < 0) col_artist = 4;
+    dc.track_name = col_name; dc.artist = col_artist;
     fprintf(stderr,"Usando columnas: track_name=%d, artist=%d\n", col_name, col_artist);
     free_fields(hdr,nf);
 
+    // Columnas de la salida compacta por fila (sin docs.seg se leen del CSV)
+    DocsBuilder db;
+    int with_docs = docs_begin(&db, dir, dc)==0;
+    if (!with_docs) fprintf(stderr,"Aviso: sin %s/" DOCS_NAME " (%s)\n", dir, strerror(errno));
+    // Fechas y regiones por tramo de filas (filtros de SEARCH)
+    ZonesBuilder zb;
+    int with_zones = zones_begin(&zb, dir)==0;
+    if (!with_zones) fprintf(stderr,"Aviso: sin %s/" ZONES_NAME " (%s)\n", dir, strerror(errno));
+
     // Recorrer filas
     uint64_t rows=0;
     for(;;){
         off_t off=ftello(fp);
         len=getline(&line,&bufcap,fp);
         if(len<=0) break;
+        uint32_t row=nameidx_spill_row(&sp, (uint64_t)off);
 
         char *f[MAXF]={0}; size_t nx=parse_csv_line(line,f,MAXF);
+        if (with_docs) docs_add(&db, f, nx);
+        if (with_zones){
+            int full = !(nx==5 && nf!=5);       // la fila corta de ADD no tiene fecha ni región
+            zones_add(&zb, full && dc.date>=0 && (size_t)dc.date<nx ? f[dc.date] : NULL,
+                      full && dc.region>=0 && (size_t)dc.region<nx ? f[dc.region] : NULL);
+        }
         if ((int)nx>col_name || (int)nx>col_artist){
-            char *norm_name   = (col_name   < (int)nx && f[col_name])   ? normalize_utf8_basic(f[col_name])   : strdup("");
-            char *norm_artist = (col_artist < (int)nx && f[col_artist]) ? normalize_utf8_basic(f[col_artist]) : strdup("");
-
-            size_t combo_len = strlen(norm_name) + 1 + strlen(norm_artist) + 1;
-            char *combo = (char*)malloc(combo_len);
-            snprintf(combo, combo_len, "%s %s", norm_name, norm_artist);
-
-            char **tokens=NULL; size_t ntok=tokenize_unique(combo,&tokens);
-            for(size_t t=0;t<ntok;t++){
-                uint64_t h=fnv1a64(tokens[t]);
-                int b=(int)(h & (NBKT-1));
-                fwrite(&h,   sizeof(uint64_t), 1, bkt[b]);
-                fwrite(&off, sizeof(uint64_t), 1, bkt[b]);
-            }
-
-            for(size_t t=0;t<ntok;t++) free(tokens[t]);
-            free(tokens);
-            free(combo); free(norm_name); free(norm_artist);
+            const char *name   = (col_name   < (int)nx && f[col_name])   ? f[col_name]   : "";
+            const char *artist = (col_artist < (int)nx && f[col_artist]) ? f[col_artist] : "";
+            uint64_t *hs=NULL; size_t nh=nameidx_row_hashes(name, artist, &hs);
+            for(size_t t=0;t<nh;t++) nameidx_spill_add(&sp, hs[t], row);
+            free(hs);
         }
         free_fields(f,nx);
 
@@ -211,59 +153,12 @@ int main(int argc, char **argv){
         if ((rows%1000000ULL)==0) fprintf(stderr,"Filas procesadas: %llu\n",(unsigned long long)rows);
     }
     free(line); fclose(fp);
-    for(int b=0;b<NBKT;b++) fclose(bkt[b]);
+    if (with_docs) docs_finish(&db);
+    if (with_zones) zones_finish(&zb);
+    if (nameidx_spill_close(&sp)!=0) return 1;
 
     // Compactar cada bucket: ordenar y agrupar offsets
-    for(int b=0;b<NBKT;b++){
-        char tin[512], tout[512];
-        snprintf(tin, sizeof(tin),  "%s/b%02x.tmp", dir, b);
-        snprintf(tout,sizeof(tout), "%s/b%02x.idx", dir, b);
-
-        FILE *fi=fopen(tin,"rb");
-        if(!fi){ continue; } // bucket vacío
-        if (fseeko(fi,0,SEEK_END)!=0){ fclose(fi); continue; }
-        off_t sz=ftello(fi); fseeko(fi,0,SEEK_SET);
-        size_t n=(size_t)(sz/sizeof(Pair));
-        if (n==0){ fclose(fi); unlink(tin); continue; }
-
-        Pair *arr=malloc(n*sizeof(Pair));
-        if(!arr){ fprintf(stderr,"Memoria insuficiente en bucket %02x\n", b); fclose(fi); return 1; }
-        for(size_t i=0;i<n;i++){
-            if (fread(&arr[i].h,8,1,fi)!=1 || fread(&arr[i].off,8,1,fi)!=1){
-                fprintf(stderr,"Lectura incompleta en %s\n", tin);
-                free(arr); fclose(fi); return 1;
-            }
-        }
-        fclose(fi);
-
-        qsort(arr,n,sizeof(Pair),cmp_pair);
-
-        FILE *fo=fopen(tout,"wb");
-        if(!fo){ fprintf(stderr,"No puedo crear %s: %s\n", tout, strerror(errno)); free(arr); return 1; }
-
-        size_t i=0;
-        while(i<n){
-            uint64_t h=arr[i].h;
-            // compactar offsets duplicados
-            size_t j=i; uint32_t df=0;
-            size_t w=i; uint64_t last=~(uint64_t)0;
-            while(j<n && arr[j].h==h){
-                if (arr[j].off!=last){ arr[w++]=arr[j]; last=arr[j].off; df++; }
-                j++;
-            }
-            // escribir bloque: [hash][df][pad][df * offsets]
-            fwrite(&h, 8, 1, fo);
-            fwrite(&df,4, 1, fo);
-            uint32_t pad=0; fwrite(&pad,4,1,fo);
-            for(size_t k=i;k<i+df;k++) fwrite(&arr[k].off,8,1,fo);
-
-            i=j;
-        }
-        fclose(fo);
-        free(arr);
-        unlink(tin); // borrar tmp
-        fprintf(stderr,"Bucket %02x listo -> %s\n", b, tout);
-    }
+    if (nameidx_compact_buckets(&sp, nthreads)!=0) return 1;
 
     fprintf(stderr,"Índice de nombres/artistas listo en %s/\n", dir);
     return 0;
@@ -0,0 +1,210 @@
+// cols_top.c
+// Top de tracks por streams sobre el snapshot columnar (ver cols_top.h)
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "cols_top.h"
+
+#define BLOCK       4096        // filas por bloque del filtro
+#define MAX_THREADS 64
+
+/* Tabla hash de un hilo: track_id -> suma (probing lineal) */
+typedef struct {
+    uint64_t k0, k1;            // track_id empaquetado
+    uint64_t streams;
+    uint64_t row;               // primera fila
+    uint32_t nrows;             // 0 = libre
+    uint32_t kind;
+} Agg;
+
+typedef struct {
+    Agg    *e;
+    size_t  cap, n;
+} AggTable;
+
+static inline uint64_t agg_hash(uint64_t k0, uint64_t k1, uint32_t kind){
+    uint64_t h = (k0 ^ (k1 * 0x9E3779B97F4A7C15ULL) ^ kind) * 0xFF51AFD7ED558CCDULL;
+    return h ^ (h >> 32);
+}
+
+static int agg_init(AggTable *t, size_t cap){
+    t->cap = cap; t->n = 0;
+    t->e = (Agg*)calloc(cap, sizeof(Agg));
+    return t->e ? 0 : -1;
+}
+
+static int agg_grow(AggTable *t);
+
+/* Suma (streams, nrows) al track; la primera fila queda la menor */
+static inline int agg_add(AggTable *t, uint64_t k0, uint64_t k1, uint32_t kind,
+                          uint64_t streams, uint32_t nrows, uint64_t row){
+    if ((t->n + 1) * 2 > t->cap && agg_grow(t) != 0) return -1;
+    size_t i = (size_t)agg_hash(k0, k1, kind) & (t->cap - 1);
+    for (;;){
+        Agg *a = &t->e[i];
+        if (!a->nrows){
+            a->k0 = k0; a->k1 = k1; a->kind = kind;
+            a->streams = streams; a->nrows = nrows; a->row = row;
+            t->n++;
+            return 0;
+        }
+        if (a->k0 == k0 && a->k1 == k1 && a->kind == kind){
+            a->streams += streams; a->nrows += nrows;
+            if (row < a->row) a->row = row;
+            return 0;
+        }
+        i = (i + 1) & (t->cap - 1);
+    }
+}
+
+static int agg_grow(AggTable *t){
+    AggTable nt;
+    if (agg_init(&nt, t->cap * 2) != 0) return -1;
+    for (size_t i=0; i<t->cap; i++){
+        const Agg *a = &t->e[i];
+        if (a->nrows) agg_add(&nt, a->k0, a->k1, a->kind, a->streams, a->nrows, a->row);
+    }
+    free(t->e);
+    *t = nt;
+    return 0;
+}
+
+/* ---------- Recorrido de un tramo ---------- */
+typedef struct {
+    const ColStore *c;
+    uint64_t  lo, hi;
+    int64_t   region;
+    int32_t   from, to;
+    AggTable  t;
+    int       failed;
+} Part;
+
+static void *scan_part(void *arg){
+    Part *p = (Part*)arg;
+    const ColStore *c = p->c;
+    const uint32_t span = (uint32_t)(p->to - p->from);
+    const uint16_t rg = (uint16_t)p->region;
+    uint32_t sel[BLOCK];
+    if (agg_init(&p->t, 4096) != 0){ p->failed = 1; return NULL; }
+
+    for (uint64_t b = p->lo; b < p->hi; b += BLOCK){
+        size_t len = p->hi - b < BLOCK ? (size_t)(p->hi - b) : BLOCK;
+        const int32_t  *date = c->date + b;
+        const uint16_t *reg  = c->region + b;
+        const uint32_t *st   = c->streams + b;
+
+        /* 1) filas que pasan el filtro, sin saltos */
+        size_t m = 0;
+        if (p->region < 0){
+            for (size_t i=0; i<len; i++){
+                sel[m] = (uint32_t)i;
+                m += ((uint32_t)date[i] - (uint32_t)p->from <= span) & (st[i] != 0);
+            }
+        } else {
+            for (size_t i=0; i<len; i++){
+                sel[m] = (uint32_t)i;
+                m += ((uint32_t)date[i] - (uint32_t)p->from <= span) & (reg[i] == rg) & (st[i] != 0);
+            }
+        }
+        /* 2) agregación de las seleccionadas */
+        for (size_t j=0; j<m; j++){
+            uint64_t row = b + sel[j];
+            uint8_t kind = c->track_kind[row];
+            if (kind == COLS_KIND_NONE) continue;       // fila sin track_id
+            uint64_t k0, k1;
+            memcpy(&k0, c->track_id[row], 8); memcpy(&k1, c->track_id[row] + 8, 8);
+            if (agg_add(&p->t, k0, k1, kind, st[sel[j]], 1, row) != 0){ p->failed = 1; return NULL; }
+        }
+    }
+    return NULL;
+}
+
+/* ---------- Top-k: heap de mínimos por (streams, -fila) ---------- */
+static inline int worse(const Agg *a, const Agg *b){
+    return a->streams < b->streams || (a->streams == b->streams && a->row > b->row);
+}
+
+static void sift_down(const Agg **h, size_t n, size_t i){
+    for (;;){
+        size_t l = 2*i + 1, m = i;
+        if (l < n && worse(h[l], h[m])) m = l;
+        if (l + 1 < n && worse(h[l+1], h[m])) m = l + 1;
+        if (m == i) return;
+        const Agg *x = h[i]; h[i] = h[m]; h[m] = x;
+        i = m;
+    }
+}
+
+long cols_top(const ColStore *c, int64_t region, int32_t from, int32_t to,
+              size_t n, int nthreads, ColsTopEntry *out){
+    if (n == 0 || from > to || c->nrows == 0) return 0;
+    if (nthreads <= 0){ long ncpu = sysconf(_SC_NPROCESSORS_ONLN); nthreads = ncpu > 0 ? (int)ncpu : 1; }
+    if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+    uint64_t maxt = (c->nrows + COLS_TOP_MIN_ROWS - 1) / COLS_TOP_MIN_ROWS;
+    if ((uint64_t)nthreads > maxt) nthreads = (int)maxt;
+
+    /* 1) agregación parcial por tramos */
+    Part p[MAX_THREADS];
+    pthread_t th[MAX_THREADS];
+    int started[MAX_THREADS] = {0};
+    uint64_t step = (c->nrows + (uint64_t)nthreads - 1) / (uint64_t)nthreads;
+    for (int k=0; k<nthreads; k++){
+        memset(&p[k], 0, sizeof(p[k]));
+        p[k].c = c; p[k].region = region; p[k].from = from; p[k].to = to;
+        p[k].lo = (uint64_t)k * step;
+        p[k].hi = p[k].lo + step < c->nrows ? p[k].lo + step : c->nrows;
+        if (k > 0 && pthread_create(&th[k], NULL, scan_part, &p[k]) == 0) started[k] = 1;
+    }
+    scan_part(&p[0]);                               // el primer tramo en este hilo
+    for (int k=1; k<nthreads; k++){
+        if (started[k]) pthread_join(th[k], NULL);
+        else scan_part(&p[k]);                      // sin hilo: en este mismo
+    }
+
+    /* 2) juntar las tablas en la del primer tramo */
+    long rc = 0;
+    for (int k=0; k<nthreads; k++) if (p[k].failed) rc = -1;
+    for (int k=1; k<nthreads && rc == 0; k++)
+        for (size_t i=0; i<p[k].t.cap; i++){
+            const Agg *a = &p[k].t.e[i];
+            if (a->nrows && agg_add(&p[0].t, a->k0, a->k1, a->kind, a->streams, a->nrows, a->row) != 0){ rc = -1; break; }
+        }
+
+    /* 3) heap con los n mejores y orden final de mayor a menor */
+    const Agg **h = rc == 0 ? (const Agg**)malloc(n * sizeof(*h)) : NULL;
+    if (rc == 0 && !h) rc = -1;
+    if (rc == 0){
+        size_t hn = 0;
+        const AggTable *t = &p[0].t;
+        for (size_t i=0; i<t->cap; i++){
+            const Agg *a = &t->e[i];
+            if (!a->nrows) continue;
+            if (hn < n){
+                h[hn++] = a;
+                if (hn == n) for (size_t j=n/2; j-- > 0; ) sift_down(h, hn, j);
+            } else if (worse(h[0], a)){
+                h[0] = a;
+                sift_down(h, hn, 0);
+            }
+        }
+        if (hn < n) for (size_t j=hn/2; j-- > 0; ) sift_down(h, hn, j);
+        for (size_t k=hn; k-- > 0; ){               // sacar el peor cada vez: queda al final
+            out[k] = (ColsTopEntry){ h[0]->streams, h[0]->row, h[0]->nrows };
+            h[0] = h[k];
+            sift_down(h, k, 0);
+        }
+        rc = (long)hn;
+    }
+    free(h);
+    for (int k=0; k<nthreads; k++) free(p[k].t.e);
+    if (rc < 0) errno = ENOMEM;
+    return rc;
+}
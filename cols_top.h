@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "colstore.h"
+
+/* ============================================================
+   Top de tracks por streams sobre el snapshot columnar:
+   "los n tracks con más streams en la región R entre las fechas A y B".
+
+   Las filas se reparten en tramos contiguos, uno por hilo. Cada hilo
+   recorre su tramo de a bloques: primero arma el vector de filas que
+   pasan el filtro (fecha y región, sin saltos: el compilador lo
+   vectoriza) y después suma sus streams en una tabla hash propia por
+   track_id (16 B empaquetados, o el id de track_id.dict para los que no
+   se empaquetan). Al final las tablas parciales se juntan en una y un
+   heap de n elementos deja el top. Las filas con 0 streams (charts sin
+   streams) o sin track_id no se agregan.
+   ============================================================ */
+
+#define COLS_TOP_MAX      1000      // n máximo
+#define COLS_TOP_MIN_ROWS (1u << 18) // filas mínimas por hilo
+
+typedef struct {
+    uint64_t streams;       // suma en el rango
+    uint64_t row;           // primera fila del track en el rango (id, nombre, artista)
+    uint32_t nrows;         // filas que sumaron (apariciones en charts)
+} ColsTopEntry;
+
+/* region = id en c->regions o -1 (todas); from/to = AAAAMMDD inclusive.
+   nthreads <= 0: todos los núcleos. Deja hasta n entradas en out, de más
+   a menos streams (empate: la primera fila), y devuelve cuántas; -1 sin
+   memoria. */
+long cols_top(const ColStore *c, int64_t region, int32_t from, int32_t to,
+              size_t n, int nthreads, ColsTopEntry *out);
@@ -0,0 +1,321 @@
+// colstore.c
+// Snapshot columnar del CSV (formato en colstore.h)
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "colstore.h"
+#include "track_idx.h"
+#include "track_rows.h"
+
+enum { C_TRACK_ID, C_TRACK_KIND, C_DATE, C_RANK, C_STREAMS, C_REGION, C_ARTIST, C_NAME, NCOLS };
+enum { D_REGION, D_ARTIST, D_NAME, D_TRACK, NDICTS };
+
+static const char *COL_FILE[NCOLS] = {
+    "track_id.col", "track_kind.col", "date.col", "rank.col",
+    "streams.col", "region.col", "artist.col", "name.col"
+};
+static const uint32_t COL_WIDTH[NCOLS] = { 16, 1, 4, 4, 4, 2, 4, 4 };
+static const char *DICT_FILE[NDICTS] = { "region.dict", "artist.dict", "name.dict", "track_id.dict" };
+
+/* ============================================================
+   Construcción
+   ============================================================ */
+struct ColsDictBuilder {
+    uint32_t *off;  size_t n, ocap;       // off[0..n]
+    char     *text; size_t ntext, tcap;
+    uint32_t *slot; uint64_t *slot_h; size_t nslot;   // hash -> id+1
+};
+
+static uint64_t fnv(const char *s, size_t n){
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i=0; i<n; i++){ h ^= (unsigned char)s[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+static int dict_rehash(ColsDictBuilder *d){
+    size_t nn = d->nslot ? d->nslot * 2 : 1024;
+    uint32_t *ns = (uint32_t*)calloc(nn, sizeof(uint32_t));
+    uint64_t *nh = (uint64_t*)malloc(nn * sizeof(uint64_t));
+    if (!ns || !nh){ free(ns); free(nh); return -1; }
+    for (size_t i=0; i<d->nslot; i++){
+        if (!d->slot[i]) continue;
+        size_t j = (size_t)d->slot_h[i] & (nn - 1);
+        while (ns[j]) j = (j + 1) & (nn - 1);
+        ns[j] = d->slot[i]; nh[j] = d->slot_h[i];
+    }
+    free(d->slot); free(d->slot_h);
+    d->slot = ns; d->slot_h = nh; d->nslot = nn;
+    return 0;
+}
+
+static ColsDictBuilder *dict_new(void){
+    ColsDictBuilder *d = (ColsDictBuilder*)calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->ocap = 1024;
+    d->off = (uint32_t*)malloc(d->ocap * sizeof(uint32_t));
+    if (!d->off || dict_rehash(d) != 0){ free(d->off); free(d); return NULL; }
+    d->off[0] = 0;
+    return d;
+}
+
+static void dict_free(ColsDictBuilder *d){
+    if (!d) return;
+    free(d->off); free(d->text); free(d->slot); free(d->slot_h); free(d);
+}
+
+/* Id de s, nuevo si no estaba; -1 sin memoria o si el texto no cabe en 32 bits */
+static int64_t dict_id(ColsDictBuilder *d, const char *s){
+    size_t len = strlen(s);
+    uint64_t h = fnv(s, len);
+    if ((d->n + 1) * 2 > d->nslot && dict_rehash(d) != 0) return -1;
+    size_t j = (size_t)h & (d->nslot - 1);
+    for (; d->slot[j]; j = (j + 1) & (d->nslot - 1)){
+        uint32_t id = d->slot[j] - 1;
+        if (d->slot_h[j] == h && d->off[id+1] - d->off[id] == len &&
+            memcmp(d->text + d->off[id], s, len) == 0) return id;
+    }
+    if (d->ntext + len > UINT32_MAX){ errno = EFBIG; return -1; }
+    if (d->n + 2 > d->ocap){
+        uint32_t *no = (uint32_t*)realloc(d->off, d->ocap * 2 * sizeof(uint32_t));
+        if (!no) return -1;
+        d->off = no; d->ocap *= 2;
+    }
+    if (d->ntext + len > d->tcap){
+        size_t nc = d->tcap ? d->tcap : 4096;
+        while (nc < d->ntext + len) nc *= 2;
+        char *nt = (char*)realloc(d->text, nc);
+        if (!nt) return -1;
+        d->text = nt; d->tcap = nc;
+    }
+    memcpy(d->text + d->ntext, s, len);
+    d->ntext += len;
+    d->off[++d->n] = (uint32_t)d->ntext;
+    d->slot[j] = (uint32_t)d->n; d->slot_h[j] = h;
+    return (int64_t)d->n - 1;
+}
+
+static void path_of(char *out, size_t sz, const char *dir, const char *file, const char *sfx){
+    snprintf(out, sz, "%s/%s%s", dir, file, sfx);
+}
+
+int cols_begin(ColsBuilder *b, const char *dir){
+    memset(b, 0, sizeof(*b));
+    snprintf(b->dir, sizeof(b->dir), "%s", dir);
+    for (int i=0; i<NDICTS; i++)
+        if (!(b->d[i] = dict_new())){ cols_abort(b); return -1; }
+    ColsHeader hd; memset(&hd, 0, sizeof(hd));       // provisional
+    for (int i=0; i<NCOLS; i++){
+        char p[600]; path_of(p, sizeof(p), dir, COL_FILE[i], ".tmp");
+        if (!(b->f[i] = fopen(p, "wb"))){ cols_abort(b); return -1; }
+        setvbuf(b->f[i], NULL, _IOFBF, 1 << 20);
+        if (fwrite(&hd, sizeof(hd), 1, b->f[i]) != 1){ cols_abort(b); return -1; }
+    }
+    return 0;
+}
+
+/* Entero sin signo de un campo (vacío o inválido = 0; satura en max) */
+static uint32_t parse_uint(const char *s, uint32_t max){
+    if (!s) return 0;
+    uint64_t v = 0;
+    for (; *s >= '0' && *s <= '9'; s++)
+        if ((v = v * 10 + (uint64_t)(*s - '0')) > max) return max;
+    return (uint32_t)v;
+}
+
+void cols_add(ColsBuilder *b, const char *track_id, const char *name, const char *artist,
+              const char *date, const char *region, const char *rank, const char *streams){
+    if (b->err) return;
+    uint8_t key[16] = {0}, kind = COLS_KIND_NONE;
+    if (track_id && *track_id){
+        uint64_t k = trk_pack_key(track_id, key);
+        kind = k == TRK_KEY_B62 ? COLS_KIND_B62 : k == TRK_KEY_RAW ? COLS_KIND_RAW : COLS_KIND_DICT;
+        if (kind == COLS_KIND_DICT){                 // no cabe en 16 B: al diccionario
+            int64_t id = dict_id(b->d[D_TRACK], track_id);
+            if (id < 0){ b->err = errno ? errno : ENOMEM; return; }
+            uint32_t id32 = (uint32_t)id;
+            memset(key, 0, sizeof(key));
+            memcpy(key, &id32, 4);
+        }
+    }
+    int32_t  d  = (int32_t)trackrows_parse_date(date);
+    int32_t  rk = (int32_t)parse_uint(rank, INT32_MAX);
+    uint32_t st = parse_uint(streams, UINT32_MAX);
+    int64_t  rg = dict_id(b->d[D_REGION], region ? region : "");
+    int64_t  ar = dict_id(b->d[D_ARTIST], artist ? artist : "");
+    int64_t  nm = dict_id(b->d[D_NAME],   name   ? name   : "");
+    if (rg < 0 || ar < 0 || nm < 0){ b->err = errno ? errno : ENOMEM; return; }
+    if (rg >= COLS_MAX_REGIONS){ b->err = ERANGE; return; }
+    uint16_t rg16 = (uint16_t)rg;
+    uint32_t ar32 = (uint32_t)ar, nm32 = (uint32_t)nm;
+    const void *v[NCOLS] = { key, &kind, &d, &rk, &st, &rg16, &ar32, &nm32 };
+    for (int i=0; i<NCOLS; i++)
+        if (fwrite(v[i], COL_WIDTH[i], 1, b->f[i]) != 1){ b->err = errno; return; }
+    b->nrows++;
+}
+
+static int dict_write(const ColsDictBuilder *d, const char *path, uint64_t csv_size){
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    ColsHeader hd; memset(&hd, 0, sizeof(hd));
+    memcpy(hd.magic, "COLDICT", 7);
+    hd.version = COLS_VERSION;
+    hd.nrows = d->n; hd.csv_size = csv_size; hd.text_size = d->ntext;
+    int ok = fwrite(&hd, sizeof(hd), 1, f) == 1 &&
+             fwrite(d->off, sizeof(uint32_t), d->n + 1, f) == d->n + 1 &&
+             fwrite(d->text, 1, d->ntext, f) == d->ntext;
+    ok = (fclose(f) == 0) && ok;
+    return ok ? 0 : -1;
+}
+
+int cols_finish(ColsBuilder *b, uint64_t csv_size){
+    char p[600], q[600];
+    if (b->err){
+        fprintf(stderr, "Snapshot: %s\n", b->err == ERANGE ? "más de 65535 regiones distintas" : strerror(b->err));
+        cols_abort(b);
+        return -1;
+    }
+    for (int i=0; i<NCOLS; i++){
+        ColsHeader hd; memset(&hd, 0, sizeof(hd));
+        memcpy(hd.magic, "COLSNAP", 7);
+        hd.version = COLS_VERSION; hd.width = COL_WIDTH[i];
+        hd.nrows = b->nrows; hd.csv_size = csv_size;
+        int ok = fseeko(b->f[i], 0, SEEK_SET) == 0 && fwrite(&hd, sizeof(hd), 1, b->f[i]) == 1;
+        ok = (fclose(b->f[i]) == 0) && ok;
+        b->f[i] = NULL;
+        if (!ok) goto werr;
+    }
+    for (int i=0; i<NDICTS; i++){
+        path_of(p, sizeof(p), b->dir, DICT_FILE[i], ".tmp");
+        if (dict_write(b->d[i], p, csv_size) != 0) goto werr;
+    }
+    /* todo escrito: renombrar */
+    for (int i=0; i<NCOLS + NDICTS; i++){
+        const char *file = i < NCOLS ? COL_FILE[i] : DICT_FILE[i - NCOLS];
+        path_of(p, sizeof(p), b->dir, file, ".tmp");
+        path_of(q, sizeof(q), b->dir, file, "");
+        if (rename(p, q) != 0) goto werr;
+    }
+    for (int i=0; i<NDICTS; i++){ dict_free(b->d[i]); b->d[i] = NULL; }
+    return 0;
+werr:
+    fprintf(stderr, "Escritura snapshot en %s: %s\n", b->dir, strerror(errno));
+    cols_abort(b);
+    return -1;
+}
+
+void cols_abort(ColsBuilder *b){
+    char p[600];
+    for (int i=0; i<NCOLS; i++){
+        if (b->f[i]) fclose(b->f[i]);
+        b->f[i] = NULL;
+        path_of(p, sizeof(p), b->dir, COL_FILE[i], ".tmp"); unlink(p);
+    }
+    for (int i=0; i<NDICTS; i++){
+        dict_free(b->d[i]); b->d[i] = NULL;
+        path_of(p, sizeof(p), b->dir, DICT_FILE[i], ".tmp"); unlink(p);
+    }
+}
+
+/* ============================================================
+   Lectura
+   ============================================================ */
+static void *map_one(const char *dir, const char *file, size_t *size){
+    char p[600]; path_of(p, sizeof(p), dir, file, "");
+    int fd = open(p, O_RDONLY);
+    if (fd < 0) return NULL;
+    off_t sz = lseek(fd, 0, SEEK_END);
+    void *m = sz >= (off_t)sizeof(ColsHeader) ? mmap(NULL, (size_t)sz, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (m == MAP_FAILED){ errno = EINVAL; return NULL; }
+    *size = (size_t)sz;
+    return m;
+}
+
+int cols_open(ColStore *c, const char *dir){
+    memset(c, 0, sizeof(*c));
+    const void *data[NCOLS];
+    for (int i=0; i<NCOLS + NDICTS; i++){
+        const char *file = i < NCOLS ? COL_FILE[i] : DICT_FILE[i - NCOLS];
+        if (!(c->map[i] = map_one(dir, file, &c->size[i]))) goto fail;
+        const ColsHeader *hd = (const ColsHeader*)c->map[i];
+        int ok = hd->version == COLS_VERSION;
+        if (i < NCOLS){
+            ok = ok && strncmp(hd->magic, "COLSNAP", 7) == 0 && hd->width == COL_WIDTH[i] &&
+                 c->size[i] == sizeof(ColsHeader) + hd->nrows * COL_WIDTH[i];
+            if (i == 0){ c->nrows = hd->nrows; c->csv_size = hd->csv_size; }
+            ok = ok && hd->nrows == c->nrows;
+            data[i] = (const unsigned char*)c->map[i] + sizeof(ColsHeader);
+        } else {
+            ColsDict *d = i == NCOLS + D_REGION ? &c->regions : i == NCOLS + D_ARTIST ? &c->artists
+                        : i == NCOLS + D_NAME ? &c->names : &c->track_ids;
+            ok = ok && strncmp(hd->magic, "COLDICT", 7) == 0 &&
+                 c->size[i] == sizeof(ColsHeader) + (hd->nrows + 1) * 4 + hd->text_size;
+            d->n    = hd->nrows;
+            d->off  = (const uint32_t*)((const unsigned char*)c->map[i] + sizeof(ColsHeader));
+            d->text = (const char*)(d->off + d->n + 1);
+            ok = ok && d->off[d->n] == hd->text_size;
+        }
+        if (!ok || hd->csv_size != c->csv_size){ errno = EINVAL; goto fail; }
+    }
+    c->track_id   = (const uint8_t (*)[16])data[C_TRACK_ID];
+    c->track_kind = (const uint8_t*)data[C_TRACK_KIND];
+    c->date       = (const int32_t*)data[C_DATE];
+    c->rank       = (const int32_t*)data[C_RANK];
+    c->streams    = (const uint32_t*)data[C_STREAMS];
+    c->region     = (const uint16_t*)data[C_REGION];
+    c->artist     = (const uint32_t*)data[C_ARTIST];
+    c->name       = (const uint32_t*)data[C_NAME];
+    return 0;
+fail:;
+    int e = errno;
+    cols_close(c);
+    errno = e;
+    return -1;
+}
+
+void cols_close(ColStore *c){
+    for (int i=0; i<NCOLS + NDICTS; i++)
+        if (c->map[i]) munmap(c->map[i], c->size[i]);
+    memset(c, 0, sizeof(*c));
+}
+
+const char *cols_str(const ColsDict *d, uint32_t id, int *len){
+    if (id >= d->n || d->off[id] > d->off[id+1] || d->off[id+1] > d->off[d->n]){ *len = 0; return ""; }
+    *len = (int)(d->off[id+1] - d->off[id]);
+    return d->text + d->off[id];
+}
+
+int64_t cols_dict_find(const ColsDict *d, const char *s){
+    size_t L = strlen(s);
+    for (uint64_t i=0; i<d->n; i++){
+        int len; const char *t = cols_str(d, (uint32_t)i, &len);
+        if ((size_t)len == L && strncasecmp(t, s, L) == 0) return (int64_t)i;
+    }
+    return -1;
+}
+
+const char *cols_track_id(const ColStore *c, uint64_t row, char buf[24], int *len){
+    uint8_t k = c->track_kind[row];
+    if (k == COLS_KIND_DICT){
+        uint32_t id; memcpy(&id, c->track_id[row], 4);
+        return cols_str(&c->track_ids, id, len);
+    }
+    uint64_t kind = k == COLS_KIND_B62 ? TRK_KEY_B62 : k == COLS_KIND_RAW ? TRK_KEY_RAW : TRK_KEY_NONE;
+    if (!trk_unpack_key(kind, c->track_id[row], buf)) strcpy(buf, "-");
+    *len = (int)strlen(buf);
+    return buf;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+/* ============================================================
+   Snapshot columnar del CSV: <dir>/ (cols/ por defecto)
+   Una columna por archivo, un valor por fila de datos (el mismo número
+   de fila que los postings de nameidx), sin texto que parsear:
+
+     track_id.col   uint8[16]   track_id empaquetado (trk_pack_key) o, si no
+                                se puede empaquetar, id u32 en track_id.dict
+     track_kind.col uint8       tipo de la clave (COLS_KIND_*)
+     date.col       int32       AAAAMMDD (0 = sin fecha)
+     rank.col       int32       (0 = vacío)
+     streams.col    uint32      (0 = vacío)
+     region.col     uint16      id en region.dict
+     artist.col     uint32      id en artist.dict
+     name.col       uint32      id en name.dict
+
+   Cada .col es cabecera (64 B) | valores[nrows]; cada .dict es
+   cabecera (64 B) | off u32[n + 1] | textos (el valor i va de off[i] a
+   off[i+1]). Todo se mapea: un filtro por fecha y región recorre 6 B
+   por fila en arreglos contiguos, sin tocar el CSV.
+
+   Lo escribe build_cols desde el CSV completo. Las filas agregadas
+   después (ADD) no están hasta volver a construirlo: nrows y csv_size
+   dicen hasta dónde llega.
+   ============================================================ */
+
+#define COLS_VERSION      2      // 2: track_id.dict para los ids que no se empaquetan
+#define COLS_MAX_REGIONS  0xFFFF
+
+/* NONE: fila sin track_id; DICT: los 4 primeros bytes de track_id.col
+   son el id del texto en track_id.dict (ids largos o fuera de base62) */
+enum { COLS_KIND_B62 = 0, COLS_KIND_RAW = 1, COLS_KIND_NONE = 2, COLS_KIND_DICT = 3 };
+
+typedef struct {
+    char     magic[8];      // "COLSNAP" (.col) o "COLDICT" (.dict)
+    uint32_t version;
+    uint32_t width;         // bytes por valor (.col); 0 en .dict
+    uint64_t nrows;         // .col: filas; .dict: valores distintos
+    uint64_t csv_size;      // bytes del CSV cubiertos por el snapshot
+    uint64_t text_size;     // solo .dict
+    uint64_t reserved[3];
+} __attribute__((packed)) ColsHeader;
+
+/* Diccionario mapeado */
+typedef struct {
+    uint64_t        n;
+    const uint32_t *off;
+    const char     *text;
+} ColsDict;
+
+typedef struct {
+    uint64_t        nrows, csv_size;
+    const uint8_t (*track_id)[16];
+    const uint8_t  *track_kind;
+    const int32_t  *date, *rank;
+    const uint32_t *streams;
+    const uint16_t *region;
+    const uint32_t *artist, *name;
+    ColsDict        regions, artists, names, track_ids;
+    void           *map[12];     // archivos mapeados (8 columnas + 4 diccionarios)
+    size_t          size[12];
+} ColStore;
+
+/* Mapea todas las columnas de dir; 0 o -1 con errno (ENOENT si falta
+   alguna, EINVAL si no coinciden entre sí o no tienen el formato) */
+int  cols_open(ColStore *c, const char *dir);
+void cols_close(ColStore *c);
+/* Texto del valor id (sin terminar en 0: imprimir con "%.*s") */
+const char *cols_str(const ColsDict *d, uint32_t id, int *len);
+/* Id de s en el diccionario (sin distinguir mayúsculas) o -1 */
+int64_t cols_dict_find(const ColsDict *d, const char *s);
+/* track_id de la fila: en buf (desempaquetado) o en track_id.dict, sin
+   terminar en 0 ("%.*s" con *len); "-" si la fila no tiene */
+const char *cols_track_id(const ColStore *c, uint64_t row, char buf[24], int *len);
+
+/* ---- Construcción (build_cols) ----
+   Cada columna se escribe en <archivo>.tmp durante la lectura del CSV;
+   los diccionarios quedan en memoria (valores distintos) y se escriben
+   al final. cols_finish renombra todo junto. */
+typedef struct ColsDictBuilder ColsDictBuilder;
+
+typedef struct {
+    char             dir[512];
+    FILE            *f[8];
+    ColsDictBuilder *d[4];       // region, artist, name, track_id
+    uint64_t         nrows;
+    int              err;
+} ColsBuilder;
+
+int  cols_begin(ColsBuilder *b, const char *dir);
+/* Fila siguiente; cualquier campo puede ser NULL (columna ausente) */
+void cols_add(ColsBuilder *b, const char *track_id, const char *name, const char *artist,
+              const char *date, const char *region, const char *rank, const char *streams);
+/* csv_size = bytes del CSV leídos. 0 o -1 (mensaje en stderr). */
+int  cols_finish(ColsBuilder *b, uint64_t csv_size);
+void cols_abort(ColsBuilder *b);
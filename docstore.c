@@ -0,0 +1,259 @@
+// docstore.c
+// nameidx/docs.seg: columnas de la salida compacta por número de fila
+// (formato en docstore.h)
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "docstore.h"
+
+/* ---------- Construcción ---------- */
+static uint64_t fnv_bytes(uint64_t h, const char *s, size_t n){
+    for (size_t i=0; i<n; i++){ h ^= (unsigned char)s[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+static int grow(void **p, size_t *cap, size_t need, size_t elem){
+    if (need <= *cap) return 0;
+    size_t nc = *cap ? *cap : 1024;
+    while (nc < need) nc *= 2;
+    void *np = realloc(*p, nc * elem);
+    if (!np) return -1;
+    *p = np; *cap = nc;
+    return 0;
+}
+
+static int text_add(DocsBuilder *b, const char *s, size_t n, uint32_t *off){
+    if (b->ntext + n > UINT32_MAX){ errno = EFBIG; return -1; }
+    if (grow((void**)&b->text, &b->xcap, b->ntext + n, 1) != 0) return -1;
+    memcpy(b->text + b->ntext, s, n);
+    *off = (uint32_t)b->ntext;
+    b->ntext += n;
+    return 0;
+}
+
+/* Tracks y valores comparten la tabla; el bit alto del id+1 marca los valores */
+#define SLOT_VAL 0x80000000u
+
+static int slots_rehash(DocsBuilder *b){
+    size_t nn = b->nslot ? b->nslot * 2 : 4096;
+    uint32_t *ns = (uint32_t*)calloc(nn, sizeof(uint32_t));
+    uint64_t *nh = (uint64_t*)malloc(nn * sizeof(uint64_t));
+    if (!ns || !nh){ free(ns); free(nh); return -1; }
+    for (size_t i=0; i<b->nslot; i++){
+        if (!b->slot[i]) continue;
+        size_t j = (size_t)b->slot_h[i] & (nn - 1);
+        while (ns[j]) j = (j + 1) & (nn - 1);
+        ns[j] = b->slot[i]; nh[j] = b->slot_h[i];
+    }
+    free(b->slot); free(b->slot_h);
+    b->slot = ns; b->slot_h = nh; b->nslot = nn;
+    return 0;
+}
+
+/* Id del valor s (fecha o región), nuevo si no estaba; -1 si no cabe */
+static int val_id(DocsBuilder *b, const char *s){
+    size_t n = strlen(s);
+    uint64_t h = fnv_bytes(1469598103934665603ULL ^ 0x76, s, n);
+    size_t j = (size_t)h & (b->nslot - 1);
+    for (; b->slot[j]; j = (j + 1) & (b->nslot - 1)){
+        uint32_t id = b->slot[j];
+        if (!(id & SLOT_VAL) || b->slot_h[j] != h) continue;
+        const DocVal *v = &b->vals[(id & ~SLOT_VAL) - 1];
+        if (v->len == n && memcmp(b->text + v->off, s, n) == 0) return (int)((id & ~SLOT_VAL) - 1);
+    }
+    if (b->nvals == DOCS_MAX_VALS){ errno = ERANGE; return -1; }
+    if (grow((void**)&b->vals, &b->vcap, b->nvals + 1, sizeof(DocVal)) != 0) return -1;
+    DocVal v = { 0, (uint32_t)n };
+    if (text_add(b, s, n, &v.off) != 0) return -1;
+    b->vals[b->nvals++] = v;
+    b->slot[j] = (uint32_t)b->nvals | SLOT_VAL; b->slot_h[j] = h;
+    return (int)(b->nvals - 1);
+}
+
+/* Id de la terna (id, nombre, artista), nueva si no estaba */
+static int64_t track_id(DocsBuilder *b, const char *id, const char *name, const char *art){
+    size_t li = strlen(id), ln = strlen(name), la = strlen(art);
+    if (li > DOCS_MAX_LEN) li = DOCS_MAX_LEN;
+    if (ln > DOCS_MAX_LEN) ln = DOCS_MAX_LEN;
+    if (la > DOCS_MAX_LEN) la = DOCS_MAX_LEN;
+    uint64_t h = 1469598103934665603ULL;
+    h = fnv_bytes(h, id, li);   h = fnv_bytes(h ^ 0x1F, name, ln);   h = fnv_bytes(h ^ 0x1F, art, la);
+    size_t j = (size_t)h & (b->nslot - 1);
+    for (; b->slot[j]; j = (j + 1) & (b->nslot - 1)){
+        uint32_t t = b->slot[j];
+        if ((t & SLOT_VAL) || b->slot_h[j] != h) continue;
+        const DocTrack *e = &b->tracks[t - 1];
+        const char *x = b->text + e->off;
+        if (e->id_len == li && e->name_len == ln && e->artist_len == la &&
+            memcmp(x, id, li) == 0 && memcmp(x + li, name, ln) == 0 && memcmp(x + li + ln, art, la) == 0)
+            return (int64_t)t - 1;
+    }
+    if (b->ntracks >= SLOT_VAL - 1){ errno = ERANGE; return -1; }
+    if (grow((void**)&b->tracks, &b->tcap, b->ntracks + 1, sizeof(DocTrack)) != 0) return -1;
+    DocTrack e = { 0, (uint16_t)li, (uint16_t)ln, (uint16_t)la, 0 };
+    uint32_t o1, o2, o3;
+    if (text_add(b, id, li, &o1) != 0 || text_add(b, name, ln, &o2) != 0 || text_add(b, art, la, &o3) != 0) return -1;
+    e.off = o1;
+    b->tracks[b->ntracks++] = e;
+    b->slot[j] = (uint32_t)b->ntracks; b->slot_h[j] = h;
+    return (int64_t)b->ntracks - 1;
+}
+
+int docs_begin(DocsBuilder *b, const char *dir, DocCols cols){
+    memset(b, 0, sizeof(*b));
+    b->cols = cols;
+    snprintf(b->path, sizeof(b->path), "%s/" DOCS_NAME, dir);
+    snprintf(b->tmp, sizeof(b->tmp), "%s.tmp", b->path);
+    unlink(b->path);                       // no dejar uno viejo junto a un rows.off nuevo
+    if (slots_rehash(b) != 0) return -1;
+    b->f = fopen(b->tmp, "wb");
+    if (!b->f){ docs_abort(b); return -1; }
+    setvbuf(b->f, NULL, _IOFBF, 4*1024*1024);
+    DocsHeader hd; memset(&hd, 0, sizeof(hd));
+    if (fwrite(&hd, sizeof(hd), 1, b->f) != 1){ docs_abort(b); return -1; }
+    return 0;
+}
+
+/* Campo c de la fila como en la salida compacta: "-" si no está */
+static const char *field(char **f, size_t nf, int c){
+    return (c >= 0 && (size_t)c < nf && f[c]) ? f[c] : "-";
+}
+
+void docs_add(DocsBuilder *b, char **f, size_t nf){
+    if (b->err) return;
+    const char *id   = field(f, nf, b->cols.track_id);
+    const char *name = field(f, nf, b->cols.track_name);
+    const char *art  = field(f, nf, b->cols.artist);
+    /* Fila "corta" de ADD (5 campos): id, nombre y artista en 0..2 */
+    if (nf == 5){
+        if (!strcmp(id, "-"))   id   = f[0];
+        if (!strcmp(name, "-")) name = f[1];
+        if (!strcmp(art, "-"))  art  = f[2];
+    }
+    if ((b->ntracks + b->nvals + 3) * 2 > b->nslot && slots_rehash(b) != 0){ b->err = errno; return; }
+    int64_t t = track_id(b, id, name, art);
+    int dt = t < 0 ? -1 : val_id(b, field(f, nf, b->cols.date));
+    int rg = dt < 0 ? -1 : val_id(b, field(f, nf, b->cols.region));
+    if (rg < 0){ b->err = errno ? errno : ENOMEM; return; }
+    DocRow r = { (uint32_t)t, (uint16_t)dt, (uint16_t)rg };
+    if (fwrite(&r, sizeof(r), 1, b->f) != 1){ b->err = errno; return; }
+    b->nrows++;
+}
+
+static void builder_free(DocsBuilder *b){
+    free(b->tracks); free(b->vals); free(b->text); free(b->slot); free(b->slot_h);
+    b->tracks = NULL; b->vals = NULL; b->text = NULL; b->slot = NULL; b->slot_h = NULL;
+}
+
+int docs_finish(DocsBuilder *b){
+    if (b->err){
+        fprintf(stderr, "Aviso: sin %s (%s)\n", b->path,
+                b->err == ERANGE ? "más de 65535 fechas/regiones distintas" : strerror(b->err));
+        docs_abort(b);
+        return -1;
+    }
+    DocsHeader hd; memset(&hd, 0, sizeof(hd));
+    memcpy(hd.magic, "NIDXDOC", 7);
+    hd.version    = DOCS_VERSION;
+    hd.nrows      = b->nrows;
+    hd.ntracks    = b->ntracks;
+    hd.nvals      = b->nvals;
+    hd.tracks_off = sizeof(hd) + b->nrows * sizeof(DocRow);
+    hd.vals_off   = hd.tracks_off + b->ntracks * sizeof(DocTrack);
+    hd.text_off   = hd.vals_off + b->nvals * sizeof(DocVal);
+    int ok = fwrite(b->tracks, sizeof(DocTrack), b->ntracks, b->f) == b->ntracks &&
+             fwrite(b->vals, sizeof(DocVal), b->nvals, b->f) == b->nvals &&
+             fwrite(b->text, 1, b->ntext, b->f) == b->ntext &&
+             fseeko(b->f, 0, SEEK_SET) == 0 && fwrite(&hd, sizeof(hd), 1, b->f) == 1;
+    ok = (fclose(b->f) == 0) && ok;
+    b->f = NULL;
+    if (!ok || rename(b->tmp, b->path) != 0){
+        fprintf(stderr, "Escritura %s: %s\n", b->tmp, strerror(errno));
+        docs_abort(b);
+        return -1;
+    }
+    builder_free(b);
+    return 0;
+}
+
+void docs_abort(DocsBuilder *b){
+    if (b->f) fclose(b->f);
+    b->f = NULL;
+    unlink(b->tmp);
+    builder_free(b);
+}
+
+/* ---------- Lectura ---------- */
+int docs_open(DocStore *d, const char *dir){
+    memset(d, 0, sizeof(*d));
+    char path[600];
+    snprintf(path, sizeof(path), "%s/" DOCS_NAME, dir);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    off_t sz = lseek(fd, 0, SEEK_END);
+    void *map = sz >= (off_t)sizeof(DocsHeader) ? mmap(NULL, (size_t)sz, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED){ errno = EINVAL; return -1; }
+
+    const DocsHeader *hd = (const DocsHeader*)map;
+    uint64_t size = (uint64_t)sz;
+    int ok = strncmp(hd->magic, "NIDXDOC", 7) == 0 && hd->version == DOCS_VERSION &&
+             hd->nrows <= UINT32_MAX && hd->ntracks <= UINT32_MAX && hd->nvals <= DOCS_MAX_VALS &&
+             hd->tracks_off == sizeof(DocsHeader) + hd->nrows * sizeof(DocRow) &&
+             hd->vals_off == hd->tracks_off + hd->ntracks * sizeof(DocTrack) &&
+             hd->text_off == hd->vals_off + hd->nvals * sizeof(DocVal) && hd->text_off <= size;
+    if (!ok){
+        fprintf(stderr, "Aviso: %s no es un docs.seg válido\n", path);
+        munmap(map, (size_t)sz);
+        errno = EINVAL;
+        return -1;
+    }
+    posix_madvise(map, (size_t)sz, POSIX_MADV_RANDOM);
+    const unsigned char *m = (const unsigned char*)map;
+    d->map     = (unsigned char*)map;
+    d->size    = (size_t)sz;
+    d->nrows   = hd->nrows;
+    d->ntracks = hd->ntracks;
+    d->nvals   = hd->nvals;
+    d->rows    = (const DocRow*)(m + sizeof(DocsHeader));
+    d->tracks  = (const DocTrack*)(m + hd->tracks_off);
+    d->vals    = (const DocVal*)(m + hd->vals_off);
+    d->text    = (const char*)(m + hd->text_off);
+    return 0;
+}
+
+void docs_close(DocStore *d){
+    if (d->map) munmap(d->map, d->size);
+    memset(d, 0, sizeof(*d));
+}
+
+int docs_get(const DocStore *d, uint32_t row, DocView *v){
+    if (row >= d->nrows) return 0;
+    const DocRow r = d->rows[row];
+    if (r.track >= d->ntracks || r.date >= d->nvals || r.region >= d->nvals) return 0;
+    uint64_t ntext = (uint64_t)(d->map + d->size - (const unsigned char*)d->text);
+    const DocTrack *t = &d->tracks[r.track];
+    const DocVal *dt = &d->vals[r.date], *rg = &d->vals[r.region];
+    if ((uint64_t)t->off + t->id_len + t->name_len + t->artist_len > ntext ||
+        (uint64_t)dt->off + dt->len > ntext || (uint64_t)rg->off + rg->len > ntext) return 0;
+    const char *x = d->text + t->off;
+    v->id     = (DocText){ x, t->id_len };
+    v->name   = (DocText){ x + t->id_len, t->name_len };
+    v->artist = (DocText){ x + t->id_len + t->name_len, t->artist_len };
+    v->date   = (DocText){ d->text + dt->off, (int)dt->len };
+    v->region = (DocText){ d->text + rg->off, (int)rg->len };
+    return 1;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+/* ============================================================
+   Documentos por fila: nameidx/docs.seg
+   Las cinco columnas que muestra una búsqueda (track_id, nombre,
+   artista, fecha y región) de cada fila, por número de fila (el mismo
+   de los postings y de rows.off). Mostrar un resultado es leer una
+   entrada del mapeo: sin fseeko + getline + parse del CSV y sin malloc.
+
+     Cabecera (64 B) | DocRow[nrows] | DocTrack[ntracks] | DocVal[nvals] | textos
+
+   Un track aparece en cientos de charts con el mismo id, nombre y
+   artista: cada terna distinta se guarda una vez (DocTrack) y la fila
+   apunta a ella. Fechas y regiones comparten un diccionario de valores
+   (DocVal, hasta 65535). Los textos se guardan ya como se imprimen (con
+   "-" si falta la columna, igual que la salida compacta desde el CSV).
+
+   Lo escribe el build de nameidx junto con rows.off. Las filas
+   agregadas después (ADD) no están: se leen del CSV hasta el siguiente
+   build.
+   ============================================================ */
+
+#define DOCS_NAME    "docs.seg"
+#define DOCS_VERSION 1
+#define DOCS_MAX_VALS 0xFFFF
+#define DOCS_MAX_LEN  0xFFFF    // largo máximo de id, nombre y artista (se recortan)
+
+typedef struct {
+    char     magic[8];      // "NIDXDOC"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t nrows;
+    uint64_t ntracks;
+    uint64_t nvals;
+    uint64_t tracks_off;    // posiciones en el archivo
+    uint64_t vals_off;
+    uint64_t text_off;
+} __attribute__((packed)) DocsHeader;
+
+typedef struct {
+    uint32_t track;         // índice en DocTrack
+    uint16_t date;          // índices en DocVal
+    uint16_t region;
+} DocRow;
+
+typedef struct {
+    uint32_t off;           // id, nombre y artista seguidos, desde text_off
+    uint16_t id_len, name_len, artist_len;
+    uint16_t pad;
+} DocTrack;
+
+typedef struct {
+    uint32_t off, len;
+} DocVal;
+
+/* Columnas del CSV (como la salida compacta: -1 = no está en el header) */
+typedef struct { int track_id, track_name, artist, date, region; } DocCols;
+
+/* Columnas por defecto si el header no las nombra */
+#define DOCS_DEFAULT_COLS ((DocCols){ 10, 1, 4, 3, 6 })
+
+/* ---- Construcción ----
+   Las filas van directo al archivo (8 B cada una); en memoria quedan
+   solo los tracks y valores distintos con sus textos. */
+typedef struct {
+    char      path[600], tmp[610];
+    FILE     *f;
+    DocCols   cols;
+    uint64_t  nrows;
+    DocTrack *tracks;  size_t ntracks, tcap;
+    DocVal   *vals;    size_t nvals, vcap;
+    char     *text;    size_t ntext, xcap;
+    uint32_t *slot;    size_t nslot;        // tabla hash (tracks y valores) -> id+1
+    uint64_t *slot_h;
+    int       err;
+} DocsBuilder;
+
+/* Borra el docs.seg anterior de dir y empieza docs.seg.tmp. 0 o -1. */
+int  docs_begin(DocsBuilder *b, const char *dir, DocCols cols);
+/* Fila siguiente (en el orden de nameidx_spill_row): sus campos del CSV */
+void docs_add(DocsBuilder *b, char **f, size_t nf);
+/* Escribe el archivo. 0 o -1 (mensaje en stderr, sin docs.seg). */
+int  docs_finish(DocsBuilder *b);
+void docs_abort(DocsBuilder *b);
+
+/* ---- Lectura ---- */
+typedef struct {
+    unsigned char  *map;
+    size_t          size;
+    uint64_t        nrows, ntracks, nvals;
+    const DocRow   *rows;
+    const DocTrack *tracks;
+    const DocVal   *vals;
+    const char     *text;
+} DocStore;
+
+/* Un campo: texto sin terminar en 0 (imprimir con "%.*s") */
+typedef struct { const char *s; int len; } DocText;
+typedef struct { DocText id, name, artist, date, region; } DocView;
+
+/* Mapea dir/docs.seg; -1 si no está o no es válido (d queda vacío y
+   docs_get da 0 para todas las filas) */
+int  docs_open(DocStore *d, const char *dir);
+void docs_close(DocStore *d);
+/* Campos de la fila row apuntando al mapeo; 0 si la fila no está */
+int  docs_get(const DocStore *d, uint32_t row, DocView *v);
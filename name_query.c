@@ -0,0 +1,451 @@
+/* name_query.c
+   Consultas AND / OR / NOT sobre nameidx: lectura del texto, plan por df
+   y evaluación desde el final con los cursores de nameidx_dir.c.
+   Ver name_query.h.
+*/
+
+#include "name_query.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+enum { Q_TERM, Q_AND, Q_OR, Q_NOT };
+
+typedef struct QNode {
+    int            kind;
+    uint64_t       est;            // filas estimadas (df)
+    struct QNode **kid;            // AND / OR; NOT tiene uno
+    size_t         nkid, npos;     // AND: kid[0..npos) positivos, después los NOT
+    const NamePostings *p;         // TERM: de la tabla de la consulta o mat
+    NamePostings   mat;            // TERM armado por el plan (AND ya cruzado)
+    NameRevCursor  c;
+    uint32_t       last;           // última respuesta (vale para toda x >= last)
+    int            state;          // 0 sin respuesta, 1 last, 2 no queda ninguna
+} QNode;
+
+struct NameQuery {
+    QNode       *root;             // NULL: consulta sin términos
+    int          ready;            // ANDs ya decididos (primera llamada a _last)
+    uint64_t     h[NAMEQ_MAX_TERMS];
+    NamePostings post[NAMEQ_MAX_TERMS];    // una vez por término distinto
+    size_t       nterms;
+    const NameQueryFilter *filter;
+};
+
+/* El recorrido hacia atrás cuesta unas 20 veces más por fila candidata
+   que el AND hacia adelante de nameidx_postings_and (bits de Roaring,
+   SIMD); solo conviene si corta pronto */
+#define DAAT_COST 20
+
+/* ---------- Lectura del texto ---------- */
+enum { T_END, T_WORD, T_AND, T_OR, T_NOT, T_LP, T_RP };
+
+typedef struct {
+    const char            *s;
+    int                    tok;
+    char                  *word;       // T_WORD
+    const NameQuerySource *src;
+    NameQuery             *q;
+    size_t                 nterms;     // apariciones
+    char                  *err;
+    size_t                 errlen;
+    int                    failed;
+} QParser;
+
+static void fail(QParser *ps, const char *msg){
+    if (!ps->failed) snprintf(ps->err, ps->errlen, "%s", msg);
+    ps->failed = 1;
+}
+
+/* Siguiente token; '-' pegado al inicio de una palabra es NOT */
+static void next_tok(QParser *ps){
+    free(ps->word); ps->word = NULL;
+    while (isspace((unsigned char)*ps->s)) ps->s++;
+    const char *p = ps->s;
+    if (!*p){ ps->tok = T_END; return; }
+    if (*p == '('){ ps->s++; ps->tok = T_LP; return; }
+    if (*p == ')'){ ps->s++; ps->tok = T_RP; return; }
+    if (*p == '-' && p[1] && !isspace((unsigned char)p[1])){ ps->s++; ps->tok = T_NOT; return; }
+    const char *e = p;
+    while (*e && !isspace((unsigned char)*e) && *e != '(' && *e != ')') e++;
+    ps->s = e;
+    size_t len = (size_t)(e - p);
+    if      (len == 3 && !strncmp(p, "AND", 3)) ps->tok = T_AND;
+    else if (len == 2 && !strncmp(p, "OR", 2))  ps->tok = T_OR;
+    else if (len == 3 && !strncmp(p, "NOT", 3)) ps->tok = T_NOT;
+    else {
+        ps->word = malloc(len + 1);
+        if (!ps->word){ fail(ps, "memoria insuficiente"); ps->tok = T_END; return; }
+        memcpy(ps->word, p, len); ps->word[len] = 0;
+        ps->tok = T_WORD;
+    }
+}
+
+static void node_free(QNode *n){
+    if (!n) return;
+    for (size_t i=0; i<n->nkid; i++) node_free(n->kid[i]);
+    free(n->kid);
+    nameidx_postings_free(&n->mat);
+    free(n);
+}
+
+static QNode *node_new(QParser *ps, int kind){
+    QNode *n = calloc(1, sizeof(*n));
+    if (!n) fail(ps, "memoria insuficiente");
+    else n->kind = kind;
+    return n;
+}
+
+/* AND / OR de kids[0..nk) (los NULL son palabras sin términos): los
+   hijos del mismo tipo se aplanan y con uno solo queda ese hijo */
+static QNode *node_join(QParser *ps, int kind, QNode **kids, size_t nk){
+    size_t m = 0, tot = 0;
+    for (size_t i=0; i<nk; i++){
+        if (!kids[i]) continue;
+        kids[m++] = kids[i];
+        tot += kids[i]->kind == kind ? kids[i]->nkid : 1;
+    }
+    if (m == 0) return NULL;
+    if (m == 1) return kids[0];
+    QNode *n = node_new(ps, kind);
+    if (n && !(n->kid = malloc(tot * sizeof(*n->kid)))){ free(n); n = NULL; fail(ps, "memoria insuficiente"); }
+    if (!n){ for (size_t i=0; i<m; i++) node_free(kids[i]); return NULL; }
+    for (size_t i=0; i<m; i++){
+        if (kids[i]->kind == kind){
+            memcpy(n->kid + n->nkid, kids[i]->kid, kids[i]->nkid * sizeof(*n->kid));
+            n->nkid += kids[i]->nkid;
+            kids[i]->nkid = 0;
+            node_free(kids[i]);
+        } else n->kid[n->nkid++] = kids[i];
+    }
+    return n;
+}
+
+static QNode *parse_and(QParser *ps, int depth);
+
+/* Postings del término h: se arman una sola vez por consulta */
+static const NamePostings *term_postings(QParser *ps, uint64_t h){
+    NameQuery *q = ps->q;
+    for (size_t i=0; i<q->nterms; i++)
+        if (q->h[i] == h) return &q->post[i];
+    q->h[q->nterms] = h;
+    ps->src->postings(ps->src->ctx, h, &q->post[q->nterms]);
+    return &q->post[q->nterms++];
+}
+
+/* Una palabra: AND de todos sus tokens */
+static QNode *parse_term(QParser *ps){
+    uint64_t h[NAMEQ_MAX_TERMS];
+    size_t nh = ps->src->terms(ps->src->ctx, ps->word, h, NAMEQ_MAX_TERMS);
+    next_tok(ps);
+    if (nh == 0) return NULL;
+    if (nh > NAMEQ_MAX_TERMS - ps->nterms){
+        char msg[64]; snprintf(msg, sizeof(msg), "demasiados términos (máximo %d)", NAMEQ_MAX_TERMS);
+        fail(ps, msg); return NULL;
+    }
+    ps->nterms += nh;
+    QNode *kids[NAMEQ_MAX_TERMS];
+    for (size_t i=0; i<nh; i++){
+        kids[i] = node_new(ps, Q_TERM);
+        if (kids[i]) kids[i]->p = term_postings(ps, h[i]);
+    }
+    return node_join(ps, Q_AND, kids, nh);
+}
+
+static QNode *parse_unary(QParser *ps, int depth){
+    if (depth > NAMEQ_MAX_DEPTH){ fail(ps, "demasiados paréntesis o NOT anidados"); return NULL; }
+    switch (ps->tok){
+    case T_WORD:
+        return parse_term(ps);
+    case T_NOT: {
+        next_tok(ps);
+        QNode *c = parse_unary(ps, depth + 1);
+        if (!c || ps->failed) return c;
+        if (c->kind == Q_NOT){                        // NOT NOT a = a
+            QNode *a = c->kid[0]; c->nkid = 0; node_free(c);
+            return a;
+        }
+        QNode *n = node_new(ps, Q_NOT);
+        if (n && !(n->kid = malloc(sizeof(*n->kid)))){ free(n); n = NULL; fail(ps, "memoria insuficiente"); }
+        if (!n){ node_free(c); return NULL; }
+        n->kid[0] = c; n->nkid = 1;
+        return n;
+    }
+    case T_LP: {
+        next_tok(ps);
+        QNode *n = parse_and(ps, depth + 1);
+        if (ps->failed) return n;
+        if (ps->tok != T_RP){ fail(ps, "falta ')'"); return n; }
+        next_tok(ps);
+        return n;
+    }
+    case T_OR:  fail(ps, "falta un término antes de OR"); return NULL;
+    case T_RP:  fail(ps, "sobra ')'"); return NULL;
+    default:    fail(ps, "falta un término al final"); return NULL;
+    }
+}
+
+static QNode *parse_or(QParser *ps, int depth){
+    QNode *kids[NAMEQ_MAX_TERMS + 1]; size_t nk = 0;
+    kids[nk++] = parse_unary(ps, depth);
+    while (!ps->failed && ps->tok == T_OR){
+        next_tok(ps);
+        QNode *c = parse_unary(ps, depth);
+        if (nk <= NAMEQ_MAX_TERMS) kids[nk++] = c; else node_free(c);
+    }
+    return node_join(ps, Q_OR, kids, nk);
+}
+
+static QNode *parse_and(QParser *ps, int depth){
+    QNode *kids[NAMEQ_MAX_TERMS + 1]; size_t nk = 0;
+    while (!ps->failed && ps->tok != T_END && ps->tok != T_RP){
+        if (ps->tok == T_AND){ next_tok(ps); continue; }
+        QNode *c = parse_or(ps, depth);
+        if (nk <= NAMEQ_MAX_TERMS) kids[nk++] = c; else node_free(c);
+    }
+    return node_join(ps, Q_AND, kids, nk);
+}
+
+/* ---------- Plan ---------- */
+static int cmp_est_asc(const void *a, const void *b){
+    const QNode *x = *(QNode *const *)a, *y = *(QNode *const *)b;
+    return x->est < y->est ? -1 : x->est > y->est;
+}
+static int cmp_est_desc(const void *a, const void *b){ return cmp_est_asc(b, a); }
+
+/* Quita de k[0..n) los términos repetidos (neg: hijos de NOT); devuelve
+   cuántos quedan */
+static size_t drop_dups(QNode **k, size_t n, int neg){
+    size_t m = 0;
+    for (size_t i=0; i<n; i++){
+        const QNode *t = neg ? k[i]->kid[0] : k[i];
+        size_t j = 0;
+        if (t->kind == Q_TERM)
+            for (; j<m; j++){
+                const QNode *u = neg ? k[j]->kid[0] : k[j];
+                if (u->kind == Q_TERM && u->p == t->p) break;
+            }
+        if (t->kind == Q_TERM && j < m) node_free(k[i]);
+        else k[m++] = k[i];
+    }
+    return m;
+}
+
+/* Estima las filas de cada nodo, quita lo que no aporta y ordena los
+   hijos de cada AND; NULL o el motivo si la consulta no se puede evaluar */
+static const char *plan(QNode *n){
+    const char *e;
+    switch (n->kind){
+    case Q_TERM:
+        n->est = n->p->n;
+        nameidx_rev_init(&n->c, n->p);
+        return NULL;
+    case Q_NOT:
+        return "NOT necesita al menos un término sin NOT a su lado";
+    case Q_OR: {
+        for (size_t i=0; i<n->nkid; i++){
+            if (n->kid[i]->kind == Q_NOT) return "NOT dentro de OR no está soportado";
+            if ((e = plan(n->kid[i])) != NULL) return e;
+        }
+        n->nkid = drop_dups(n->kid, n->nkid, 0);
+        size_t m = 0;
+        n->est = 0;
+        for (size_t i=0; i<n->nkid; i++){
+            QNode *c = n->kid[i];
+            if (c->est == 0){ node_free(c); continue; }        // no aporta filas
+            n->kid[m++] = c;
+            n->est = n->est + c->est < n->est ? UINT64_MAX : n->est + c->est;
+        }
+        n->nkid = m;
+        return NULL;
+    }
+    default: {                                                // Q_AND
+        for (size_t i=0; i<n->nkid; i++){
+            QNode *c = n->kid[i];
+            if ((e = plan(c->kind == Q_NOT ? c->kid[0] : c)) != NULL) return e;
+            if (c->kind == Q_NOT) c->est = c->kid[0]->est;
+        }
+        /* los positivos de menor a mayor (el más raro propone); los NOT al
+           final, primero los que más filas quitan; un NOT sin filas sobra */
+        QNode **tmp = malloc(n->nkid * sizeof(*tmp));
+        if (!tmp) return "memoria insuficiente";
+        size_t pos = 0, neg = 0;
+        for (size_t i=0; i<n->nkid; i++){
+            QNode *c = n->kid[i];
+            if (c->kind != Q_NOT) n->kid[pos++] = c;
+            else if (c->est == 0) node_free(c);
+            else tmp[neg++] = c;
+        }
+        n->npos = drop_dups(n->kid, pos, 0);
+        neg = drop_dups(tmp, neg, 1);
+        memcpy(n->kid + n->npos, tmp, neg * sizeof(*tmp));
+        n->nkid = n->npos + neg;
+        free(tmp);
+        if (n->npos == 0) return "NOT necesita al menos un término sin NOT a su lado";
+        qsort(n->kid, n->npos, sizeof(*n->kid), cmp_est_asc);
+        qsort(n->kid + n->npos, n->nkid - n->npos, sizeof(*n->kid), cmp_est_desc);
+        n->est = n->kid[0]->est;
+        return NULL;
+    }
+    }
+}
+
+NameQuery *name_query_parse(const char *text, const NameQuerySource *src,
+                            char *err, size_t errlen){
+    QParser ps = { .s = text, .src = src, .err = err, .errlen = errlen };
+    if (errlen) err[0] = 0;
+    if (!(ps.q = calloc(1, sizeof(*ps.q)))){ fail(&ps, "memoria insuficiente"); return NULL; }
+    next_tok(&ps);
+    QNode *root = parse_and(&ps, 0);
+    if (!ps.failed && ps.tok == T_RP) fail(&ps, "sobra ')'");
+    free(ps.word);
+    const char *e;
+    if (!ps.failed && root && (e = plan(root)) != NULL) fail(&ps, e);
+    if (ps.failed){
+        node_free(root);
+        name_query_free(ps.q);
+        return NULL;
+    }
+    ps.q->root = root;
+    return ps.q;
+}
+
+/* ---------- Recorrer o materializar cada AND ---------- */
+/* Mayor fila de un término (para estimar cuántas filas hay en total) */
+static uint32_t term_last(QNode *n){
+    uint32_t v = 0;
+    NameRevCursor c;
+    nameidx_rev_init(&c, n->p);
+    return nameidx_rev_seek(&c, UINT32_MAX, &v) ? v : 0;
+}
+
+static void rows_total(QNode *n, uint64_t *tot){
+    if (n->kind == Q_TERM){
+        uint64_t l = (uint64_t)term_last(n) + 1;
+        if (n->p->n && l > *tot) *tot = l;
+    }
+    for (size_t i=0; i<n->nkid; i++) rows_total(n->kid[i], tot);
+}
+
+/* Un AND con pocas coincidencias esperadas (términos independientes) no
+   corta pronto: sus términos positivos se cruzan de una vez hacia
+   adelante y quedan como una sola lista. Se esperan r = total * prod(df /
+   total) filas, la parte <= max; si son menos de DAAT_COST * k el
+   recorrido no corta mucho antes del final. */
+static int decide(QNode *n, uint32_t max, size_t k, uint64_t total){
+    for (size_t i=0; i<n->nkid; i++)
+        if (decide(n->kid[i], max, k, total) != 0) return -1;
+    if (n->kind != Q_AND || total == 0) return 0;
+    size_t nt = 0;
+    double r = (double)total;
+    for (size_t i=0; i<n->npos; i++){
+        r *= (double)n->kid[i]->est / (double)total;
+        if (n->kid[i]->kind == Q_TERM) nt++;
+    }
+    if ((uint64_t)max + 1 < total) r *= ((double)max + 1) / (double)total;
+    if (nt < 2 || r >= (double)DAAT_COST * (double)k) return 0;
+
+    NamePostings *t = malloc(nt * sizeof(*t));
+    QNode *m = calloc(1, sizeof(*m));
+    if (!t || !m){ free(t); free(m); return -1; }
+    size_t j = 0, w = 0;
+    for (size_t i=0; i<n->npos; i++)
+        if (n->kid[i]->kind == Q_TERM) t[j++] = *n->kid[i]->p;
+    size_t pn = 0;
+    uint32_t *v = nameidx_postings_and(t, nt, &pn);
+    free(t);
+    m->kind = Q_TERM;
+    m->mat.v = m->mat.own = v; m->mat.n = v ? pn : 0;
+    m->p   = &m->mat;
+    m->est = m->mat.n;
+    nameidx_rev_init(&m->c, m->p);
+    /* la lista nueva reemplaza a los términos; los demás hijos siguen */
+    for (size_t i=0; i<n->nkid; i++){
+        if (i < n->npos && n->kid[i]->kind == Q_TERM){ node_free(n->kid[i]); continue; }
+        n->kid[w++] = n->kid[i];
+    }
+    memmove(n->kid + 1, n->kid, w * sizeof(*n->kid));
+    n->kid[0] = m;
+    n->npos = n->npos - nt + 1;
+    n->nkid = w + 1;
+    qsort(n->kid, n->npos, sizeof(*n->kid), cmp_est_asc);
+    n->est = n->kid[0]->est;
+    return 0;
+}
+
+/* ---------- Evaluación desde el final ---------- */
+static int qseek(QNode *n, uint32_t x, uint32_t *out);
+
+/* Mayor fila <= x en todos los positivos y en ningún NOT */
+static int and_seek(QNode *n, uint32_t x, uint32_t *out){
+    uint32_t v;
+    for (;;){
+        size_t agree = 0, i = 0;
+        while (agree < n->npos){
+            if (!qseek(n->kid[i], x, &v)) return 0;
+            if (v == x) agree++;
+            else { x = v; agree = 1; }
+            i = i + 1 < n->npos ? i + 1 : 0;
+        }
+        size_t j = n->npos;
+        while (j < n->nkid && !(qseek(n->kid[j]->kid[0], x, &v) && v == x)) j++;
+        if (j == n->nkid){ *out = x; return 1; }
+        if (x == 0) return 0;
+        x--;
+    }
+}
+
+/* Mayor fila <= x que cumple el nodo; las x no suben entre llamadas */
+static int qseek(QNode *n, uint32_t x, uint32_t *out){
+    if (n->state == 2) return 0;
+    if (n->state == 1 && n->last <= x){ *out = n->last; return 1; }
+    int found = 0;
+    uint32_t v;
+    if (n->kind == Q_TERM) found = nameidx_rev_seek(&n->c, x, out);
+    else if (n->kind == Q_AND) found = and_seek(n, x, out);
+    else {                                                    // Q_OR
+        for (size_t i=0; i<n->nkid; i++)
+            if (qseek(n->kid[i], x, &v) && (!found || v > *out)){ *out = v; found = 1; }
+    }
+    if (found){ n->last = *out; n->state = 1; }
+    else n->state = 2;
+    return found;
+}
+
+void name_query_filter(NameQuery *q, const NameQueryFilter *f){ q->filter = f; }
+
+size_t name_query_last(NameQuery *q, uint32_t max, size_t k, uint32_t *out){
+    size_t found = 0;
+    uint32_t x = max, v, y;
+    const NameQueryFilter *f = q->filter;
+    if (!q->root) return 0;
+    if (!q->ready){
+        uint64_t total = 0;
+        rows_total(q->root, &total);
+        if (decide(q->root, max, k, total) != 0) return 0;
+        q->ready = 1;
+    }
+    while (found < k){
+        /* con filtro: x baja primero a una zona que puede tenerlo y la
+           fila que sale se vuelve a mirar (puede caer en una zona sin) */
+        if (f && !f->prev(f->ctx, x, &x)) break;
+        if (!qseek(q->root, x, &v)) break;
+        if (f){
+            if (!f->prev(f->ctx, v, &y)) break;
+            if (y != v){ x = y; continue; }
+        }
+        if (!f || f->keep(f->ctx, v)) out[found++] = v;
+        if (v == 0) break;
+        x = v - 1;
+    }
+    return found;
+}
+
+void name_query_free(NameQuery *q){
+    if (!q) return;
+    node_free(q->root);
+    for (size_t i=0; i<q->nterms; i++) nameidx_postings_free(&q->post[i]);
+    free(q);
+}
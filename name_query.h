@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "nameidx_dir.h"
+
+/* ============================================================
+   Consultas por nombre/artista sobre nameidx:
+
+     feid tusa                 AND (también "feid AND tusa")
+     tusa OR ferxxo            OR
+     feid -remix               NOT (también "feid NOT remix")
+     feid (tusa OR ferxxo)     paréntesis
+
+   Operadores en mayúsculas; NOT se une más fuerte que OR y OR más que
+   AND ("a b OR c" = a AND (b OR c)). NOT va dentro de un AND con al
+   menos un término positivo: filtra candidatos, no se recorre. Una
+   palabra con varios tokens ("feid-151") es el AND de todos; un término
+   repetido se lee una sola vez.
+
+   Plan: cada nodo estima sus filas con el df del directorio de términos
+   (AND = el menor de sus hijos, OR = la suma); los hijos de un AND se
+   cruzan de menor a mayor estimación y los NOT se consultan al final,
+   solo por las filas que ya pasaron. Un AND con un término sin filas no
+   se evalúa.
+
+   Evaluación desde el final, un documento a la vez (cursores de
+   nameidx_dir.h): AND = cada hijo salta a su mayor fila <= la candidata
+   hasta que todos coinciden; OR = la mayor de sus hijos. Se corta al
+   juntar k filas, así que el costo sigue a k y no al largo de las listas.
+   ============================================================ */
+
+#define NAMEQ_MAX_TERMS 32      // tokens por consulta
+#define NAMEQ_MAX_DEPTH 16      // paréntesis anidados
+
+/* De dónde salen los términos: quien llama normaliza y parte cada
+   palabra (como al indexar) y arma sus postings (base + delta). */
+typedef struct {
+    void    *ctx;
+    /* Palabra tal como la escribió el usuario -> hashes de todos sus
+       tokens en h (hasta max); devuelve cuántos tiene (0 si ninguno) */
+    size_t   (*terms)(void *ctx, const char *word, uint64_t *h, size_t max);
+    /* Postings de un término; n = 0 si no está o no se pudo leer */
+    void     (*postings)(void *ctx, uint64_t h, NamePostings *p);
+} NameQuerySource;
+
+typedef struct NameQuery NameQuery;
+
+/* Filtro opcional de filas (fecha, región: zonemap.h). prev da la mayor
+   fila <= x que puede cumplirlo (0 si no queda ninguna): los cursores
+   saltan de una vez las filas de en medio. keep lo prueba en una fila
+   que ya cumple la consulta. */
+typedef struct {
+    void    *ctx;
+    int     (*prev)(void *ctx, uint32_t x, uint32_t *out);
+    int     (*keep)(void *ctx, uint32_t row);
+} NameQueryFilter;
+
+/* Arma la consulta y sus postings. NULL con el motivo en err si la
+   consulta no es válida o falta memoria. Una consulta sin términos (solo
+   signos) da una consulta vacía, no un error. */
+NameQuery *name_query_parse(const char *text, const NameQuerySource *src,
+                            char *err, size_t errlen);
+/* Las k filas más altas (las más recientes) <= max que cumplen la
+   consulta, de mayor a menor, en out (lugar para k); devuelve cuántas
+   hay. Las llamadas siguientes pueden seguir con max = última fila - 1
+   (las filas no pueden subir entre llamadas). */
+size_t name_query_last(NameQuery *q, uint32_t max, size_t k, uint32_t *out);
+/* Desde aquí name_query_last solo da filas que pasan f (NULL = ninguno);
+   f tiene que seguir válido mientras se use q */
+void   name_query_filter(NameQuery *q, const NameQueryFilter *f);
+void   name_query_free(NameQuery *q);
@@ -0,0 +1,533 @@
+/* nameidx_build.c
+   Piezas comunes para construir nameidx/ (build_name_index y build_indexes):
+   - Normalización + tokenización de track_name/artist
+   - Numeración de filas (rows.off) y spill de pares (hash, fila) a 256
+     buckets temporales
+   - Compactación: ordenar y agrupar filas por hash en bXX.idx, con su
+     directorio de términos bXX.dir, y juntarlos en names.seg (ver nameidx_dir.h)
+     (con --mem-budget por mezcla de runs; con -j en varios hilos)
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "nameidx_build.h"
+#include "nameidx_dir.h"
+#include "radix_sort.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct { uint64_t h, row; } Pair;
+
+/* ---------- Normalización básica ---------- */
+static void norm_push(char **buf, size_t *len, size_t *cap, char ch){
+    if(*len+1>=*cap){ *cap=(*cap?*cap*2:64); *buf=realloc(*buf,*cap); }
+    (*buf)[(*len)++]=ch;
+}
+static char *normalize_utf8_basic(const char *s){
+    char *out=NULL; size_t L=0,C=0;
+    for(const unsigned char *p=(const unsigned char*)s; *p; ){
+        if (*p < 0x80){                      // ASCII
+            char c=(char)tolower(*p++);
+            norm_push(&out,&L,&C,c);
+        } else if (p[0]==0xC3 && p[1]){      // áéíóúüñ (y mayúsculas)
+            unsigned char c2=p[1]; char m=0;
+            switch(c2){
+                case 0xA1: case 0x81: m='a'; break; // á Á
+                case 0xA9: case 0x89: m='e'; break; // é É
+                case 0xAD: case 0x8D: m='i'; break; // í Í
+                case 0xB3: case 0x93: m='o'; break; // ó Ó
+                case 0xBA: case 0x9A: m='u'; break; // ú Ú
+                case 0xBC: case 0x9C: m='u'; break; // ü Ü
+                case 0xB1: case 0x91: m='n'; break; // ñ Ñ
+                default: m=0; break;
+            }
+            if (m){ norm_push(&out,&L,&C,m); p+=2; }
+            else   { p+=2; }                 // omite otros acentos
+        } else {
+            p++;                              // omite demás multibyte
+        }
+    }
+    norm_push(&out,&L,&C,'\0');
+    return out?out:strdup("");
+}
+
+/* ---------- Tokenización y unique por línea ---------- */
+static int cmp_strptr(const void *a, const void *b){
+    const char *const *pa=a, *const *pb=b;
+    return strcmp(*pa, *pb);
+}
+static size_t tokenize_unique(const char *norm, char ***out_tokens){
+    size_t cap=16,n=0; char **tok=malloc(cap*sizeof(char*));
+    size_t i=0,L=strlen(norm);
+    while(i<L){
+        while(i<L && !isalnum((unsigned char)norm[i])) i++;
+        if(i>=L) break;
+        size_t j=i; while(j<L && isalnum((unsigned char)norm[j])) j++;
+        if(n==cap){ cap*=2; tok=realloc(tok,cap*sizeof(char*)); }
+        tok[n++]=strndup(norm+i,j-i);
+        i=j;
+    }
+    qsort(tok,n,sizeof(char*),cmp_strptr);      // ordenar
+    size_t m=0;                                 // unique
+    for(size_t k=0;k<n;k++){
+        if (m==0 || strcmp(tok[k], tok[m-1])!=0) tok[m++]=tok[k];
+        else free(tok[k]);
+    }
+    *out_tokens=tok; return m;
+}
+
+/* ---------- Hash ---------- */
+static uint64_t fnv1a64(const char *s){
+    const uint64_t OFF=1469598103934665603ULL, PR=1099511628211ULL;
+    uint64_t h=OFF;
+    for(const unsigned char *p=(const unsigned char*)s; *p; ++p){
+        h ^= (uint64_t)*p;
+        h *= PR;
+    }
+    if(h==0){ h=1; }
+    return h;
+}
+
+size_t nameidx_row_hashes(const char *name, const char *artist, uint64_t **out){
+    char *norm_name   = normalize_utf8_basic(name   ? name   : "");
+    char *norm_artist = normalize_utf8_basic(artist ? artist : "");
+
+    size_t combo_len = strlen(norm_name) + 1 + strlen(norm_artist) + 1;
+    char *combo = (char*)malloc(combo_len);
+    snprintf(combo, combo_len, "%s %s", norm_name, norm_artist);
+
+    char **tokens=NULL; size_t ntok=tokenize_unique(combo,&tokens);
+    uint64_t *hs = (uint64_t*)malloc((ntok?ntok:1)*sizeof(uint64_t));
+    for(size_t t=0;t<ntok;t++){ hs[t]=fnv1a64(tokens[t]); free(tokens[t]); }
+    free(tokens);
+    free(combo); free(norm_name); free(norm_artist);
+    *out=hs; return ntok;
+}
+
+/* ---------- Spill a buckets temporales ---------- */
+int nameidx_spill_open(NameSpill *sp, const char *dir, size_t mem_budget){
+    memset(sp,0,sizeof(*sp));
+    snprintf(sp->dir,sizeof(sp->dir),"%s",dir);
+    if (mem_budget){
+        if (mem_budget < NAMEIDX_MIN_BUDGET) mem_budget = NAMEIDX_MIN_BUDGET;
+        sp->budget = mem_budget;
+        sp->capbuf = mem_budget / 2 / sizeof(Pair);     // mitad pares, mitad scratch del radix
+        sp->buf = (uint64_t*)malloc(sp->capbuf * sizeof(Pair));
+        sp->scratch = (uint64_t*)malloc(sp->capbuf * sizeof(Pair));
+        if(!sp->buf || !sp->scratch){
+            fprintf(stderr,"Memoria insuficiente para --mem-budget\n");
+            free(sp->buf); free(sp->scratch); sp->buf=sp->scratch=NULL;
+            return -1;
+        }
+    }
+    char path[600];
+    snprintf(path,sizeof(path),"%s/" NAMEIDX_ROWS_NAME ".tmp",dir);
+    sp->rows=fopen(path,"wb");
+    if(!sp->rows || nameidx_rows_header(sp->rows)!=0){
+        fprintf(stderr,"No puedo crear %s: %s\n", path, strerror(errno));
+        if (sp->rows) fclose(sp->rows);
+        free(sp->buf); free(sp->scratch); sp->buf=sp->scratch=NULL; sp->rows=NULL;
+        return -1;
+    }
+    setvbuf(sp->rows,NULL,_IOFBF,1<<20);
+    for(int b=0;b<NAMEIDX_NBKT;b++){
+        snprintf(path,sizeof(path),"%s/b%02x.tmp",dir,b);
+        sp->bkt[b]=fopen(path,"wb");
+        if(!sp->bkt[b]){
+            fprintf(stderr,"No puedo crear %s: %s\n", path, strerror(errno));
+            for(int k=0;k<b;k++) fclose(sp->bkt[k]);
+            fclose(sp->rows); sp->rows=NULL;
+            free(sp->buf); free(sp->scratch); sp->buf=sp->scratch=NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Orden de un run: bucket, hash, fila. Rotando el hash 8 bits a la
+   derecha el byte de bucket pasa a ser el más significativo y dentro de
+   cada bucket el orden es el mismo que por (h, fila). */
+static inline uint64_t rotr8(uint64_t h){ return (h >> 8) | (h << 56); }
+static inline uint64_t rotl8(uint64_t h){ return (h << 8) | (h >> 56); }
+
+/* Vuelca buf como un run ordenado más en cada bucket */
+static void spill_flush(NameSpill *sp){
+    if (sp->nbuf == 0) return;
+    uint64_t *nr = (uint64_t*)realloc(sp->runs, (sp->nruns+1) * NAMEIDX_NBKT * sizeof(uint64_t));
+    if (!nr){ sp->err = 1; return; }
+    sp->runs = nr;
+    uint64_t *cnt = sp->runs + sp->nruns * NAMEIDX_NBKT;
+    memset(cnt, 0, NAMEIDX_NBKT * sizeof(uint64_t));
+
+    Pair *p = (Pair*)sp->buf;
+    for (size_t i=0; i<sp->nbuf; i++) p[i].h = rotr8(p[i].h);
+    radix_sort_pairs(sp->buf, sp->nbuf, sp->scratch);
+    for (size_t i=0; i<sp->nbuf; i++) p[i].h = rotl8(p[i].h);
+    size_t i=0;
+    while (i < sp->nbuf){
+        int b = (int)(p[i].h & (NAMEIDX_NBKT-1));
+        size_t j=i; while (j < sp->nbuf && (int)(p[j].h & (NAMEIDX_NBKT-1)) == b) j++;
+        if (fwrite(p+i, sizeof(Pair), j-i, sp->bkt[b]) != j-i) sp->err = 1;
+        cnt[b] = j-i;
+        i=j;
+    }
+    sp->nruns++;
+    sp->nbuf = 0;
+}
+
+uint32_t nameidx_spill_row(NameSpill *sp, uint64_t off){
+    if (sp->nrows > UINT32_MAX){
+        if (!sp->err) fprintf(stderr,"Demasiadas filas para números de fila de 32 bits\n");
+        sp->err = 1;
+        return UINT32_MAX;
+    }
+    if (fwrite(&off, sizeof(uint64_t), 1, sp->rows) != 1) sp->err = 1;
+    return (uint32_t)sp->nrows++;
+}
+
+void nameidx_spill_add(NameSpill *sp, uint64_t h, uint32_t row){
+    uint64_t r = row;
+    if (sp->buf){
+        if (sp->nbuf == sp->capbuf) spill_flush(sp);
+        sp->buf[2*sp->nbuf] = h; sp->buf[2*sp->nbuf+1] = r;
+        sp->nbuf++;
+        return;
+    }
+    int b=(int)(h & (NAMEIDX_NBKT-1));
+    fwrite(&h, sizeof(uint64_t), 1, sp->bkt[b]);
+    fwrite(&r, sizeof(uint64_t), 1, sp->bkt[b]);
+}
+int nameidx_spill_close(NameSpill *sp){
+    int rc=0;
+    if (sp->rows && fclose(sp->rows)!=0) rc=-1;
+    sp->rows=NULL;
+    if (sp->buf){ spill_flush(sp); free(sp->buf); free(sp->scratch); sp->buf=sp->scratch=NULL; }
+    for(int b=0;b<NAMEIDX_NBKT;b++){
+        if (sp->bkt[b] && fclose(sp->bkt[b])!=0) rc=-1;
+        sp->bkt[b]=NULL;
+    }
+    if (sp->err){ fprintf(stderr,"Error escribiendo runs temporales en %s/\n", sp->dir); rc=-1; }
+    return rc;
+}
+
+size_t nameidx_parse_size(const char *s){
+    char *end=NULL;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (end == s) return 0;
+    switch (*end){
+        case 'k': case 'K': v <<= 10; end++; break;
+        case 'm': case 'M': v <<= 20; end++; break;
+        case 'g': case 'G': v <<= 30; end++; break;
+        default: break;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    return *end ? 0 : (size_t)v;
+}
+
+
+/* ---------- Compactación por mezcla k-way (con --mem-budget) ---------- */
+/* Cursor sobre un run de bXX.tmp, leído con pread en bloques */
+typedef struct {
+    off_t  pos, end;         // bytes pendientes del run en el archivo
+    Pair  *buf;
+    size_t n, i;
+} RunCursor;
+
+static int run_fill(int fd, RunCursor *c, size_t cap){
+    size_t want = (size_t)(c->end - c->pos) / sizeof(Pair);
+    if (want > cap) want = cap;
+    c->i = 0; c->n = 0;
+    if (want == 0) return 0;
+    ssize_t r = pread(fd, c->buf, want * sizeof(Pair), c->pos);
+    if (r != (ssize_t)(want * sizeof(Pair))) return -1;
+    c->pos += r; c->n = want;
+    return 0;
+}
+
+static int run_less(const RunCursor *a, const RunCursor *b){
+    const Pair *x = &a->buf[a->i], *y = &b->buf[b->i];
+    return x->h < y->h || (x->h == y->h && x->row < y->row);
+}
+static void heap_down(RunCursor **hp, size_t n, size_t i){
+    for(;;){
+        size_t l = 2*i+1, m = i;
+        if (l < n && run_less(hp[l], hp[m])) m = l;
+        if (l+1 < n && run_less(hp[l+1], hp[m])) m = l+1;
+        if (m == i) return;
+        RunCursor *t = hp[i]; hp[i] = hp[m]; hp[m] = t; i = m;
+    }
+}
+
+/* Bloque en escritura: las filas se juntan en memoria hasta blk_cap; si
+   el token tiene más, se escriben sobre la marcha y al final se corrige df */
+typedef struct {
+    FILE     *fo;
+    NameDirWriter *dw;
+    uint64_t  h, last;
+    uint32_t  df;
+    int       open, streamed;
+    off_t     hdr_pos;
+    uint64_t *blk; size_t nblk, blk_cap;
+} BlockWriter;
+
+static int block_end(BlockWriter *w){
+    if (!w->open) return 0;
+    uint32_t pad=0;
+    if (!w->streamed){
+        w->hdr_pos = ftello(w->fo);
+        fwrite(&w->h, 8, 1, w->fo); fwrite(&w->df, 4, 1, w->fo); fwrite(&pad, 4, 1, w->fo);
+        fwrite(w->blk, 8, w->nblk, w->fo);
+    } else {
+        fwrite(w->blk, 8, w->nblk, w->fo);
+        off_t end = ftello(w->fo);
+        if (fseeko(w->fo, w->hdr_pos + 8, SEEK_SET) != 0) return -1;
+        fwrite(&w->df, 4, 1, w->fo);
+        if (fseeko(w->fo, end, SEEK_SET) != 0) return -1;
+    }
+    if (nameidx_dir_add(w->dw, w->h, (uint64_t)w->hdr_pos + 16, w->df) != 0) return -1;
+    w->open = 0; w->nblk = 0;
+    return ferror(w->fo) ? -1 : 0;
+}
+
+static int block_add(BlockWriter *w, uint64_t h, uint64_t row){
+    if (w->open && h == w->h){
+        if (row == w->last) return 0;        // fila duplicada
+    } else {
+        if (block_end(w) != 0) return -1;
+        w->open = 1; w->streamed = 0; w->h = h; w->df = 0;
+    }
+    if (w->nblk == w->blk_cap){
+        if (!w->streamed){
+            uint32_t zero=0;
+            w->hdr_pos = ftello(w->fo);
+            fwrite(&w->h, 8, 1, w->fo); fwrite(&zero, 4, 1, w->fo); fwrite(&zero, 4, 1, w->fo);
+            w->streamed = 1;
+        }
+        fwrite(w->blk, 8, w->nblk, w->fo);
+        w->nblk = 0;
+    }
+    w->blk[w->nblk++] = row; w->last = row; w->df++;
+    return 0;
+}
+
+static int compact_runs(const NameSpill *sp, int b, size_t budget, const char *tin, const char *tout){
+    NameDirWriter dw;
+    size_t k=0; uint64_t total=0;
+    for (size_t r=0; r<sp->nruns; r++){
+        uint64_t c = sp->runs[r*NAMEIDX_NBKT + b];
+        if (c){ k++; total += c; }
+    }
+    if (total == 0){ unlink(tin); return 0; }
+
+    /* Mitad del presupuesto para leer los runs, mitad para el bloque */
+    size_t cap = budget / 2 / k / sizeof(Pair);
+    if (cap < 256) cap = 256;
+    BlockWriter w; memset(&w, 0, sizeof(w));
+    w.blk_cap = budget / 2 / sizeof(uint64_t);
+    RunCursor *cur = (RunCursor*)calloc(k, sizeof(RunCursor));
+    RunCursor **hp = (RunCursor**)calloc(k, sizeof(RunCursor*));
+    Pair *pool = (Pair*)malloc(k * cap * sizeof(Pair));
+    w.blk = (uint64_t*)malloc(w.blk_cap * sizeof(uint64_t));
+    int fd = open(tin, O_RDONLY), rc = -1;
+    FILE *fo = NULL;
+    if (!cur || !hp || !pool || !w.blk){ fprintf(stderr,"Memoria insuficiente en bucket %02x\n", b); goto out; }
+    if (fd < 0){ fprintf(stderr,"No puedo abrir %s: %s\n", tin, strerror(errno)); goto out; }
+
+    size_t nh=0, j=0; off_t pos=0;
+    for (size_t r=0; r<sp->nruns; r++){
+        uint64_t c = sp->runs[r*NAMEIDX_NBKT + b];
+        if (!c) continue;
+        RunCursor *rc_ = &cur[j];
+        rc_->buf = pool + j*cap; rc_->pos = pos; rc_->end = pos + (off_t)(c * sizeof(Pair));
+        pos = rc_->end; j++;
+        if (run_fill(fd, rc_, cap) != 0){ fprintf(stderr,"Lectura incompleta en %s\n", tin); goto out; }
+        hp[nh++] = rc_;
+    }
+    for (size_t i=nh/2; i-- > 0; ) heap_down(hp, nh, i);
+
+    if (nameidx_dir_begin(&dw, sp->dir, b) != 0){ fprintf(stderr,"No puedo crear %s: %s\n", dw.tmp, strerror(errno)); goto out; }
+    w.dw = &dw;
+    fo = fopen(tout,"wb");
+    if(!fo){ fprintf(stderr,"No puedo crear %s: %s\n", tout, strerror(errno)); goto out; }
+    setvbuf(fo, NULL, _IOFBF, 1<<20);
+    w.fo = fo;
+    while (nh){
+        RunCursor *c = hp[0];
+        if (block_add(&w, c->buf[c->i].h, c->buf[c->i].row) != 0) goto werr;
+        if (++c->i == c->n){
+            if (run_fill(fd, c, cap) != 0){ fprintf(stderr,"Lectura incompleta en %s\n", tin); goto out; }
+            if (c->n == 0){ hp[0] = hp[--nh]; }
+        }
+        if (nh) heap_down(hp, nh, 0);
+    }
+    if (block_end(&w) != 0) goto werr;
+    off_t idx_size = ftello(fo);
+    if (fclose(fo) != 0){ fo = NULL; goto werr; }
+    fo = NULL;
+    if (nameidx_dir_finish(&dw, (uint64_t)idx_size) != 0){ w.dw = NULL; goto werr; }
+    w.dw = NULL;
+    unlink(tin);
+    fprintf(stderr,"Bucket %02x listo -> %s (%zu runs)\n", b, tout, k);
+    rc = 0;
+    goto out;
+werr:
+    fprintf(stderr,"Escritura %s: %s\n", tout, strerror(errno));
+out:
+    if (fo) fclose(fo);
+    if (w.dw) nameidx_dir_abort(w.dw);
+    if (fd >= 0) close(fd);
+    free(cur); free(hp); free(pool); free(w.blk);
+    return rc;
+}
+
+/* ---------- Compactación: ordenar y agrupar filas ---------- */
+static int compact_whole(const char *dir, int b, const char *tin, const char *tout){
+    FILE *fi=fopen(tin,"rb");
+    if(!fi){ return 0; } // bucket vacío
+    if (fseeko(fi,0,SEEK_END)!=0){ fclose(fi); return 0; }
+    off_t sz=ftello(fi); fseeko(fi,0,SEEK_SET);
+    size_t n=(size_t)(sz/sizeof(Pair));
+    if (n==0){ fclose(fi); unlink(tin); return 0; }
+
+    Pair *arr=malloc(n*sizeof(Pair));
+    if(!arr){ fprintf(stderr,"Memoria insuficiente en bucket %02x\n", b); fclose(fi); return -1; }
+    if (fread(arr,sizeof(Pair),n,fi)!=n){
+        fprintf(stderr,"Lectura incompleta en %s\n", tin);
+        free(arr); fclose(fi); return -1;
+    }
+    fclose(fi);
+
+    radix_sort_pairs((uint64_t*)arr, n, NULL);
+
+    NameDirWriter dw;
+    if (nameidx_dir_begin(&dw, dir, b) != 0){
+        fprintf(stderr,"No puedo crear %s: %s\n", dw.tmp, strerror(errno)); free(arr); return -1;
+    }
+    FILE *fo=fopen(tout,"wb");
+    if(!fo){ fprintf(stderr,"No puedo crear %s: %s\n", tout, strerror(errno)); nameidx_dir_abort(&dw); free(arr); return -1; }
+
+    size_t i=0; uint64_t pos=0; int werr=0;
+    while(i<n){
+        uint64_t h=arr[i].h;
+        // compactar filas duplicadas
+        size_t j=i; uint32_t df=0;
+        size_t w=i; uint64_t last=~(uint64_t)0;
+        while(j<n && arr[j].h==h){
+            if (arr[j].row!=last){ arr[w++]=arr[j]; last=arr[j].row; df++; }
+            j++;
+        }
+        // escribir bloque: [hash][df][pad][df * filas]
+        fwrite(&h, 8, 1, fo);
+        fwrite(&df,4, 1, fo);
+        uint32_t pad=0; fwrite(&pad,4,1,fo);
+        for(size_t k=i;k<i+df;k++) fwrite(&arr[k].row,8,1,fo);
+        if (nameidx_dir_add(&dw, h, pos+16, df)!=0) werr=1;
+        pos += 16 + (uint64_t)df*8;
+
+        i=j;
+    }
+    if (ferror(fo)) werr=1;
+    if (fclose(fo)!=0) werr=1;
+    free(arr);
+    if (werr || nameidx_dir_finish(&dw, pos)!=0){
+        fprintf(stderr,"Escritura %s: %s\n", tout, strerror(errno));
+        nameidx_dir_abort(&dw);
+        return -1;
+    }
+    unlink(tin); // borrar tmp
+    fprintf(stderr,"Bucket %02x listo -> %s\n", b, tout);
+    return 0;
+}
+
+static int compact_one(NameSpill *sp, int b, size_t budget){
+    char tin[600], tout[600];
+    snprintf(tin, sizeof(tin),  "%s/b%02x.tmp", sp->dir, b);
+    snprintf(tout,sizeof(tout), "%s/b%02x.dir", sp->dir, b);
+    unlink(tout);                     // restos de un build anterior (bucket ahora vacío)
+    snprintf(tout,sizeof(tout), "%s/b%02x.idx", sp->dir, b);
+    unlink(tout);
+    return budget ? compact_runs(sp, b, budget, tin, tout) : compact_whole(sp->dir, b, tin, tout);
+}
+
+/* ---------- Compactación en paralelo (-j) ----------
+   Cola compartida con los buckets de mayor a menor (por tamaño de bXX.tmp):
+   cada hilo toma el siguiente con un contador atómico, así los grandes
+   arrancan primero y los chicos rellenan al final. */
+typedef struct {
+    NameSpill *sp;
+    int        order[NAMEIDX_NBKT];
+    int        next, failed;
+    size_t     budget;            // por hilo
+} CompactPool;
+
+static void *compact_worker(void *arg){
+    CompactPool *p = (CompactPool*)arg;
+    for(;;){
+        if (__atomic_load_n(&p->failed, __ATOMIC_RELAXED)) break;
+        int i = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED);
+        if (i >= NAMEIDX_NBKT) break;
+        if (compact_one(p->sp, p->order[i], p->budget) != 0)
+            __atomic_store_n(&p->failed, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+static off_t bucket_bytes(const NameSpill *sp, int b){
+    char tin[600]; struct stat st;
+    snprintf(tin, sizeof(tin), "%s/b%02x.tmp", sp->dir, b);
+    return stat(tin, &st) == 0 ? st.st_size : 0;
+}
+
+int nameidx_compact_buckets(NameSpill *sp, int nthreads){
+    int rc = 0;
+    if (nthreads <= 1){
+        for(int b=0;b<NAMEIDX_NBKT && rc==0;b++) rc = compact_one(sp, b, sp->budget);
+    } else {
+        if (nthreads > NAMEIDX_NBKT) nthreads = NAMEIDX_NBKT;
+        CompactPool p; memset(&p, 0, sizeof(p));
+        p.sp = sp;
+        /* Con --mem-budget el tope se reparte entre los hilos */
+        p.budget = sp->budget ? sp->budget / (size_t)nthreads : 0;
+        if (sp->budget && p.budget < NAMEIDX_MIN_BUDGET) p.budget = NAMEIDX_MIN_BUDGET;
+        off_t sz[NAMEIDX_NBKT];
+        for (int b=0;b<NAMEIDX_NBKT;b++){ p.order[b] = b; sz[b] = bucket_bytes(sp, b); }
+        for (int i=1;i<NAMEIDX_NBKT;i++){           // inserción: de mayor a menor
+            int b = p.order[i], j = i;
+            while (j > 0 && sz[p.order[j-1]] < sz[b]){ p.order[j] = p.order[j-1]; j--; }
+            p.order[j] = b;
+        }
+        pthread_t th[NAMEIDX_NBKT];
+        int started = 0;
+        for (; started<nthreads; started++)
+            if (pthread_create(&th[started], NULL, compact_worker, &p) != 0) break;
+        if (started == 0) compact_worker(&p);       // sin hilos: en este mismo
+        for (int t=0;t<started;t++) pthread_join(th[t], NULL);
+        rc = p.failed ? -1 : 0;
+    }
+    free(sp->runs); sp->runs=NULL; sp->nruns=0;
+    /* Un solo archivo para las consultas: names.seg, y su tabla de filas */
+    char tmp[620], path[600];
+    snprintf(path, sizeof(path), "%s/" NAMEIDX_ROWS_NAME, sp->dir);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (rc == 0) rc = nameidx_segment_build(sp->dir, sp->nrows);
+    if (rc == 0 && rename(tmp, path) != 0){
+        fprintf(stderr,"No puedo crear %s: %s\n", path, strerror(errno)); rc = -1;
+    }
+    if (rc != 0){ unlink(tmp); return rc; }
+    /* Las altas del delta ya están en el CSV que se acaba de indexar */
+    for (int b=0; b<NAMEIDX_NBKT; b++){
+        snprintf(path, sizeof(path), "%s/updates/b%02x.log", sp->dir, b);
+        unlink(path);
+    }
+    return 0;
+}
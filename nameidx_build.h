@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+/* Construcción del índice invertido por nombre/artista (nameidx/).
+   Cada fila del CSV recibe un número (0, 1, 2... en orden de lectura) y
+   su offset va a rows.off; los postings son números de fila.
+   Formato intermedio de cada bucket bXX.idx: bloques
+   [hash u64][df u32][pad u32][df * fila u64], ordenados por hash y con
+   filas ascendentes (al final se comprimen en names.seg). */
+
+#define NAMEIDX_NBKT 256        // 256 buckets -> b00..bff
+
+#define NAMEIDX_MIN_BUDGET (1u << 20)   // --mem-budget mínimo (1 MiB)
+
+/* Archivos temporales bXX.tmp con pares (hash, fila).
+   Sin presupuesto de memoria (budget 0) van sin ordenar y la compactación
+   carga cada bucket entero. Con presupuesto, los pares se acumulan en buf
+   (budget bytes) y cada vez que se llena se vuelcan ordenados: cada bXX.tmp
+   queda como una serie de runs ordenados que luego se mezclan k-way sin
+   cargar el bucket. */
+typedef struct {
+    char      dir[512];
+    FILE     *bkt[NAMEIDX_NBKT];
+    size_t    budget;        // bytes (0 = sin límite)
+    uint64_t *buf;           // pares pendientes (h, fila), 2 u64 cada uno
+    uint64_t *scratch;       // auxiliar del radix sort (mismo tamaño que buf)
+    size_t    nbuf, capbuf;
+    uint64_t *runs;          // runs[r*NAMEIDX_NBKT + b] = pares del run r en el bucket b
+    size_t    nruns;
+    FILE     *rows;          // rows.off.tmp: offset de cada fila
+    uint64_t  nrows;
+    int       err;
+} NameSpill;
+
+int  nameidx_spill_open(NameSpill *sp, const char *dir, size_t mem_budget);
+/* Número de la fila que empieza en off (llamar una vez por fila, en orden) */
+uint32_t nameidx_spill_row(NameSpill *sp, uint64_t off);
+void nameidx_spill_add(NameSpill *sp, uint64_t h, uint32_t row);
+int  nameidx_spill_close(NameSpill *sp);
+
+/* Tokens únicos (normalizados) de "track_name artist" -> hashes FNV-1a 64.
+   Devuelve cuántos hashes quedaron en *out (malloc, lo libera quien llama). */
+size_t nameidx_row_hashes(const char *name, const char *artist, uint64_t **out);
+
+/* Ordena y agrupa cada bXX.tmp en su bXX.idx final (borra los .tmp) y al
+   final junta los buckets en nameidx/names.seg (ver nameidx_dir.h), deja
+   la tabla rows.off y vacía el delta (updates/): el CSV ya entró entero.
+   Con presupuesto de memoria mezcla los runs de cada bucket sin pasarse de
+   sp->budget (repartido entre los hilos). Con nthreads > 1 compacta varios
+   buckets a la vez, los más grandes primero.
+   Devuelve 0 si todo sale bien, -1 si hay error (mensaje en stderr). */
+int nameidx_compact_buckets(NameSpill *sp, int nthreads);
+
+/* "512M", "2G", "65536" -> bytes (0 si no es válido) */
+size_t nameidx_parse_size(const char *s);
@@ -0,0 +1,664 @@
+/* nameidx_dir.c
+   Directorio de términos de nameidx (bXX.dir): escritura durante la
+   compactación, armado de names.seg, tabla fila -> offset (rows.off) y
+   lectura mapeada con búsqueda por interpolación. Ver nameidx_dir.h.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "nameidx_dir.h"
+#include "postings_codec.h"
+#include "postings_ops.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define INTERP_STEPS 4        // pasos de interpolación antes de pasar a binaria
+#define INTERP_MIN   16       // tramo en el que ya conviene la binaria
+
+/* ---------- Escritura ---------- */
+int nameidx_dir_begin(NameDirWriter *w, const char *dir, int b){
+    memset(w, 0, sizeof(*w));
+    snprintf(w->path, sizeof(w->path), "%s/b%02x.dir", dir, b);
+    snprintf(w->tmp,  sizeof(w->tmp),  "%s.tmp", w->path);
+    unlink(w->path);                       // no dejar uno viejo junto al bXX.idx nuevo
+    w->f = fopen(w->tmp, "wb");
+    if (!w->f) return -1;
+    setvbuf(w->f, NULL, _IOFBF, 1<<20);
+    NameDirHeader hd; memset(&hd, 0, sizeof(hd));
+    if (fwrite(&hd, sizeof(hd), 1, w->f) != 1){ nameidx_dir_abort(w); return -1; }
+    return 0;
+}
+
+int nameidx_dir_add(NameDirWriter *w, uint64_t h, uint64_t off, uint32_t df){
+    NameDirEntry e = { h, off, df, 0 };
+    if (fwrite(&e, sizeof(e), 1, w->f) != 1) return -1;
+    w->n++;
+    return 0;
+}
+
+int nameidx_dir_finish(NameDirWriter *w, uint64_t idx_size){
+    NameDirHeader hd; memset(&hd, 0, sizeof(hd));
+    memcpy(hd.magic, "NIDXDIR", 7);
+    hd.nterms   = w->n;
+    hd.idx_size = idx_size;
+    hd.version  = NAMEIDX_DIR_VERSION;
+    if (fseeko(w->f, 0, SEEK_SET) != 0 || fwrite(&hd, sizeof(hd), 1, w->f) != 1){
+        nameidx_dir_abort(w); return -1;
+    }
+    int rc = fclose(w->f); w->f = NULL;
+    if (rc != 0){ unlink(w->tmp); return -1; }
+    if (rename(w->tmp, w->path) != 0){ int e=errno; unlink(w->tmp); errno=e; return -1; }
+    return 0;
+}
+
+void nameidx_dir_abort(NameDirWriter *w){
+    if (w->f){ fclose(w->f); w->f = NULL; }
+    if (w->tmp[0]) unlink(w->tmp);
+}
+
+/* ---------- Segmento único (names.seg) ---------- */
+typedef struct {
+    uint64_t nterms, nposts, idx_size;
+    int      present;
+} SegBucket;
+
+/* Cabecera de bXX.dir y tamaño de bXX.idx; 0 si el bucket no existe */
+static int seg_bucket_info(const char *dir, int b, SegBucket *sb){
+    char path[600]; struct stat st;
+    memset(sb, 0, sizeof(*sb));
+    snprintf(path, sizeof(path), "%s/b%02x.idx", dir, b);
+    if (stat(path, &st) != 0) return 0;
+    snprintf(path, sizeof(path), "%s/b%02x.dir", dir, b);
+    FILE *f = fopen(path, "rb");
+    NameDirHeader hd;
+    if (!f || fread(&hd, sizeof(hd), 1, f) != 1 || strncmp(hd.magic, "NIDXDIR", 7) != 0 ||
+        hd.version != NAMEIDX_DIR_VERSION || hd.idx_size != (uint64_t)st.st_size ||
+        hd.idx_size < hd.nterms * 16 || (hd.idx_size - hd.nterms * 16) % 8 != 0){
+        if (f) fclose(f);
+        fprintf(stderr, "Falta o no corresponde %s\n", path);
+        return -1;
+    }
+    fclose(f);
+    sb->present  = 1;
+    sb->nterms   = hd.nterms;
+    sb->idx_size = hd.idx_size;
+    sb->nposts   = (hd.idx_size - hd.nterms * 16) / 8;
+    return 0;
+}
+
+#define SEG_CHUNK 65536          // postings por lectura al pasar listas a names.seg
+
+/* Siguientes k filas de bXX.idx (u64) como u32 */
+static int read_rows(FILE *fi, uint64_t *buf, uint32_t *rows, size_t k){
+    if (fread(buf, 8, k, fi) != k) return -1;
+    for (size_t i=0; i<k; i++){
+        if (buf[i] > UINT32_MAX){ errno = ERANGE; return -1; }
+        rows[i] = (uint32_t)buf[i];
+    }
+    return 0;
+}
+
+/* Pasa la lista de df filas que sigue en fi (u64 en bXX.idx) a fo, de a
+   SEG_CHUNK para no cargarla entera: comprimida (con tabla de saltos si
+   es larga) o, si es muy larga y no ocupa más del doble, como Roaring
+   alineada a 8 (la primera pasada solo mide los dos tamaños). *pos =
+   bytes escritos en fo hasta ahora. */
+static int seg_put_list(FILE *fi, FILE *fo, uint64_t df, uint64_t *buf, uint32_t *rows,
+                        uint64_t *pos, uint64_t *off, uint32_t *enc){
+    int roar = 0;
+    if (df >= NAMEIDX_ROAR_MIN_DF){
+        off_t start = ftello(fi);
+        PcodecWriter pw; RoarWriter rw;
+        if (start < 0 || roar_writer_begin(&rw, NULL) != 0) return -1;
+        pcodec_writer_begin(&pw, NULL);
+        for (uint64_t left = df; left; ){
+            size_t k = left < SEG_CHUNK ? (size_t)left : SEG_CHUNK;
+            if (read_rows(fi, buf, rows, k) != 0 || roar_writer_add(&rw, rows, k) != 0){ roar_writer_free(&rw); return -1; }
+            pcodec_writer_add(&pw, rows, k);
+            left -= k;
+        }
+        pcodec_writer_end(&pw);
+        if (roar_writer_end(&rw) != 0){ roar_writer_free(&rw); return -1; }
+        roar = rw.bytes <= 2 * pw.bytes;
+        roar_writer_free(&rw);
+        if (fseeko(fi, start, SEEK_SET) != 0) return -1;
+    }
+
+    if (roar){
+        static const uint8_t zero[8];
+        size_t padn = (size_t)((8 - *pos % 8) % 8);
+        if (fwrite(zero, 1, padn, fo) != padn) return -1;
+        *pos += padn;
+        RoarWriter rw;
+        if (roar_writer_begin(&rw, fo) != 0) return -1;
+        *enc = NAMEIDX_ENC_ROAR; *off = *pos;
+        for (uint64_t left = df; left; ){
+            size_t k = left < SEG_CHUNK ? (size_t)left : SEG_CHUNK;
+            if (read_rows(fi, buf, rows, k) != 0 || roar_writer_add(&rw, rows, k) != 0){ roar_writer_free(&rw); return -1; }
+            left -= k;
+        }
+        int rc = roar_writer_end(&rw);
+        *pos += rw.bytes;
+        roar_writer_free(&rw);
+        return rc;
+    }
+
+    PcodecWriter w;
+    int skip = df >= NAMEIDX_SKIP_MIN_DF;
+    if (skip) pcodec_writer_begin_skip(&w, fo);
+    else      pcodec_writer_begin(&w, fo);
+    *enc = skip ? NAMEIDX_ENC_SKIP : NAMEIDX_ENC_SVB; *off = *pos;
+    for (uint64_t left = df; left; ){
+        size_t k = left < SEG_CHUNK ? (size_t)left : SEG_CHUNK;
+        if (read_rows(fi, buf, rows, k) != 0 || pcodec_writer_add(&w, rows, k) != 0) goto fail;
+        left -= k;
+    }
+    if (pcodec_writer_end(&w) != 0) goto fail;
+    *pos += w.bytes;
+    if (skip){
+        /* Tabla de saltos detrás de los bloques: el relleno va antes, de
+           modo que la lista termine alineada a 8 (la tabla queda a 4) */
+        static const uint8_t zero[8];
+        size_t tail = w.nskip * sizeof(PcodecSkip) + 4;
+        size_t padn = (size_t)((8 - (*pos + tail) % 8) % 8);
+        uint32_t nskip = (uint32_t)w.nskip;
+        if (fwrite(zero, 1, padn, fo) != padn ||
+            fwrite(w.skip, sizeof(PcodecSkip), w.nskip, fo) != w.nskip ||
+            fwrite(&nskip, 4, 1, fo) != 1) goto fail;
+        *pos += padn + w.nskip * sizeof(PcodecSkip) + 4;
+    }
+    pcodec_writer_free(&w);
+    return 0;
+fail:
+    pcodec_writer_free(&w);
+    return -1;
+}
+
+int nameidx_segment_build(const char *dir, uint64_t nrows){
+    SegBucket sb[256];
+    errno = 0;
+    uint64_t bstart[257], nterms = 0, nposts = 0;
+    for (int b=0; b<256; b++){
+        if (seg_bucket_info(dir, b, &sb[b]) != 0) return -1;
+        bstart[b] = nterms;
+        nterms += sb[b].nterms;
+        nposts += sb[b].nposts;
+    }
+    bstart[256] = nterms;
+
+    NameSegHeader hd; memset(&hd, 0, sizeof(hd));
+    memcpy(hd.magic, "NIDXSEG", 7);
+    hd.version  = NAMEIDX_SEG_VERSION;
+    hd.nterms   = nterms;
+    hd.nposts   = nposts;
+    hd.nrows    = nrows;
+    hd.post_off = sizeof(NameSegHeader) + sizeof(bstart);
+
+    char path[600], tmp[610], dtmp[620], bpath[600];
+    snprintf(path, sizeof(path), "%s/" NAMEIDX_SEG_NAME, dir);
+    snprintf(tmp,  sizeof(tmp),  "%s.tmp", path);
+    snprintf(dtmp, sizeof(dtmp), "%s.dict", tmp);
+    bpath[0] = '\0';
+    uint64_t *buf = malloc(SEG_CHUNK * sizeof(uint64_t));
+    uint32_t *rows = malloc(SEG_CHUNK * sizeof(uint32_t));
+    FILE *fo = fopen(tmp, "wb"), *fd = fopen(dtmp, "w+b"), *fi = NULL, *fe = NULL;
+    unlink(dtmp);                                  // temporal: solo vive abierto
+    if (!buf || !rows || !fo || !fd){ fprintf(stderr, "No puedo crear %s: %s\n", tmp, strerror(errno)); goto fail; }
+    setvbuf(fo, NULL, _IOFBF, 1<<20);
+    if (fwrite(&hd, sizeof(hd), 1, fo) != 1 || fwrite(bstart, sizeof(bstart), 1, fo) != 1) goto werr;
+
+    /* Postings de cada término (en el orden del diccionario); las entradas
+       del diccionario, ya con su posición, van a un temporal */
+    uint64_t pos = hd.post_off;
+    for (int b=0; b<256; b++){
+        if (!sb[b].present) continue;
+        snprintf(bpath, sizeof(bpath), "%s/b%02x.dir", dir, b);
+        fe = fopen(bpath, "rb");
+        if (!fe || fseeko(fe, sizeof(NameDirHeader), SEEK_SET) != 0) goto rerr;
+        snprintf(bpath, sizeof(bpath), "%s/b%02x.idx", dir, b);
+        fi = fopen(bpath, "rb");
+        if (!fi) goto rerr;
+        setvbuf(fi, NULL, _IOFBF, 1<<20);
+        for (uint64_t t=0; t<sb[b].nterms; t++){
+            NameDirEntry e;
+            uint64_t hh; uint32_t df, pad;
+            if (fread(&e, sizeof(e), 1, fe) != 1) goto rerr;
+            if (fread(&hh,8,1,fi)!=1 || fread(&df,4,1,fi)!=1 || fread(&pad,4,1,fi)!=1) goto rerr;
+            if (hh != e.h || df != e.df){ fprintf(stderr, "%s no cuadra con su directorio\n", bpath); goto fail; }
+            if (seg_put_list(fi, fo, df, buf, rows, &pos, &e.off, &e.enc) != 0){
+                if (ferror(fo)) goto werr;
+                goto rerr;
+            }
+            if (fwrite(&e, sizeof(e), 1, fd) != 1) goto werr;
+        }
+        fclose(fi); fi = NULL;
+        fclose(fe); fe = NULL;
+    }
+
+    /* Diccionario al final (alineado a 8) */
+    static const uint8_t zero[8];
+    size_t padn = (size_t)((8 - pos % 8) % 8);
+    if (fwrite(zero, 1, padn, fo) != padn) goto werr;
+    pos += padn;
+    hd.dict_off  = pos;
+    hd.file_size = pos + nterms * sizeof(NameDirEntry);
+    if (fflush(fd) != 0 || fseeko(fd, 0, SEEK_SET) != 0) goto werr;
+    for (;;){
+        size_t k = fread(buf, 1, SEG_CHUNK * sizeof(uint64_t), fd);
+        if (k == 0) break;
+        if (fwrite(buf, 1, k, fo) != k) goto werr;
+    }
+    if (ferror(fd) || fseeko(fo, 0, SEEK_SET) != 0 || fwrite(&hd, sizeof(hd), 1, fo) != 1) goto werr;
+    if (fflush(fo) != 0 || fseeko(fo, 0, SEEK_END) != 0 || ftello(fo) != (off_t)hd.file_size) goto werr;
+    fclose(fd); fd = NULL;
+    if (fclose(fo) != 0){ fo = NULL; goto werr; }
+    fo = NULL;
+    if (rename(tmp, path) != 0) goto werr;
+    free(buf); free(rows);
+
+    for (int b=0; b<256; b++){
+        if (!sb[b].present) continue;
+        snprintf(bpath, sizeof(bpath), "%s/b%02x.idx", dir, b); unlink(bpath);
+        snprintf(bpath, sizeof(bpath), "%s/b%02x.dir", dir, b); unlink(bpath);
+    }
+    fprintf(stderr, "Segmento %s: %" PRIu64 " términos, %" PRIu64 " postings, %.2f B/posting (crudo: 4)\n",
+            path, nterms, nposts, nposts ? (double)(hd.dict_off - hd.post_off) / (double)nposts : 0.0);
+    return 0;
+
+rerr:
+    fprintf(stderr, "Lectura %s: %s\n", bpath, errno ? strerror(errno) : "archivo incompleto");
+    goto fail;
+werr:
+    fprintf(stderr, "Escritura %s: %s\n", tmp, strerror(errno));
+fail:
+    if (fi) fclose(fi);
+    if (fe) fclose(fe);
+    if (fd) fclose(fd);
+    if (fo) fclose(fo);
+    unlink(tmp);
+    free(buf); free(rows);
+    return -1;
+}
+
+/* ---------- Tabla fila -> offset (rows.off) ---------- */
+static void rows_header_init(NameRowsHeader *hd){
+    memset(hd, 0, sizeof(*hd));
+    memcpy(hd->magic, "NIDXROW", 7);
+    hd->version = NAMEIDX_ROWS_VERSION;
+}
+
+int nameidx_rows_header(FILE *f){
+    NameRowsHeader hd;
+    rows_header_init(&hd);
+    return fwrite(&hd, sizeof(hd), 1, f) == 1 ? 0 : -1;
+}
+
+/* Un solo escritor (el servidor atiende de a un cliente) */
+int nameidx_rows_append(const char *dir, uint64_t off, uint32_t *row){
+    char path[600];
+    snprintf(path, sizeof(path), "%s/" NAMEIDX_ROWS_NAME, dir);
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0664);
+    if (fd < 0) return -1;
+    struct stat st;
+    int e = 0;
+    if (fstat(fd, &st) != 0){ e = errno; goto fail; }
+    if (st.st_size == 0){
+        NameRowsHeader hd;
+        rows_header_init(&hd);
+        if (write(fd, &hd, sizeof(hd)) != (ssize_t)sizeof(hd)){ e = errno; goto fail; }
+        st.st_size = sizeof(hd);
+    }
+    uint64_t data = (uint64_t)st.st_size - sizeof(NameRowsHeader);
+    if ((uint64_t)st.st_size < sizeof(NameRowsHeader) || data % 8 != 0){ e = EINVAL; goto fail; }
+    if (data / 8 > UINT32_MAX){ e = ERANGE; goto fail; }
+    if (write(fd, &off, 8) != 8){ e = errno; goto fail; }
+    if (close(fd) != 0) return -1;
+    *row = (uint32_t)(data / 8);
+    return 0;
+fail:
+    close(fd);
+    errno = e;
+    return -1;
+}
+
+/* ---------- Lectura ---------- */
+void nameidx_reader_init(NameIdxReader *r, const char *dir){
+    memset(r, 0, sizeof(*r));
+    snprintf(r->dir, sizeof(r->dir), "%s", dir);
+}
+
+void nameidx_reader_close(NameIdxReader *r){
+    if (r->seg)  munmap(r->seg, r->seg_size);
+    if (r->rmap) munmap(r->rmap, r->rsize);
+    r->seg = r->rmap = NULL; r->seg_tried = 0;
+    r->rowoff = NULL; r->nrows = 0;
+}
+
+/* Mapea un archivo entero de solo lectura; NULL si no existe o está vacío */
+static unsigned char *map_file(const char *path, size_t *size){
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    off_t sz = lseek(fd, 0, SEEK_END);
+    void *map = sz > 0 ? mmap(NULL, (size_t)sz, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    *size = (size_t)sz;
+    return (unsigned char*)map;
+}
+
+/* (Re)mapea rows.off; 0 si tiene la cabecera correcta */
+static int rows_map(NameIdxReader *r){
+    char path[600];
+    if (r->rmap){ munmap(r->rmap, r->rsize); r->rmap = NULL; r->rowoff = NULL; r->nrows = 0; }
+    snprintf(path, sizeof(path), "%s/" NAMEIDX_ROWS_NAME, r->dir);
+    size_t sz = 0;
+    unsigned char *map = map_file(path, &sz);
+    if (!map) return -1;
+    const NameRowsHeader *hd = (const NameRowsHeader*)map;
+    if (sz < sizeof(NameRowsHeader) || strncmp(hd->magic, "NIDXROW", 7) != 0 ||
+        hd->version != NAMEIDX_ROWS_VERSION){
+        fprintf(stderr, "Aviso: %s no es una tabla de filas válida\n", path);
+        munmap(map, sz);
+        return -1;
+    }
+    posix_madvise(map, sz, POSIX_MADV_RANDOM);
+    r->rmap   = map;
+    r->rsize  = sz;
+    r->rowoff = (const uint64_t*)(map + sizeof(NameRowsHeader));
+    r->nrows  = (sz - sizeof(NameRowsHeader)) / 8;   // un ADD a medio escribir no cuenta
+    return 0;
+}
+
+static void segment_open(NameIdxReader *r){
+    char path[600];
+    r->seg_tried = 1;
+    snprintf(path, sizeof(path), "%s/" NAMEIDX_SEG_NAME, r->dir);
+    size_t sz = 0;
+    unsigned char *map = map_file(path, &sz);
+    if (!map) return;
+    const NameSegHeader *hd = (const NameSegHeader*)map;
+    const uint64_t *bstart = (const uint64_t*)(map + sizeof(NameSegHeader));
+    const uint64_t tables = sizeof(NameSegHeader) + 257 * sizeof(uint64_t);
+    int ok = sz >= tables && strncmp(hd->magic, "NIDXSEG", 7) == 0 &&
+             hd->file_size == (uint64_t)sz && bstart[256] == hd->nterms;
+    if (ok && (hd->version < 3 || hd->version == 5 || hd->version > NAMEIDX_SEG_VERSION)){     // v3: sin Roaring, v4: sin saltos
+        fprintf(stderr, "Aviso: %s es de un formato anterior; reconstruye el índice con build_name_index\n", path);
+        munmap(map, sz);
+        return;
+    }
+    ok = ok && hd->post_off == tables && hd->dict_off >= tables && hd->dict_off % 8 == 0 &&
+         hd->file_size == hd->dict_off + hd->nterms * sizeof(NameDirEntry);
+    for (int b=0; ok && b<256; b++)
+        if (bstart[b] > bstart[b+1]) ok = 0;
+    if (ok && (rows_map(r) != 0 || r->nrows < hd->nrows)){
+        fprintf(stderr, "Aviso: falta o está incompleto %s/" NAMEIDX_ROWS_NAME "\n", r->dir);
+        ok = 0;
+    }
+    if (!ok){
+        fprintf(stderr, "Aviso: %s no es un segmento válido\n", path);
+        munmap(map, sz);
+        return;
+    }
+    posix_madvise(map + hd->dict_off, hd->nterms * sizeof(NameDirEntry), POSIX_MADV_RANDOM);
+    r->seg      = map;
+    r->seg_size = sz;
+    r->bstart   = bstart;
+    r->dict     = (const NameDirEntry*)(map + hd->dict_off);
+    r->nterms   = hd->nterms;
+    r->post_end = hd->dict_off;
+}
+
+const NameDirEntry *nameidx_dir_find(const NameDirEntry *e, uint64_t n, uint64_t h){
+    if (n == 0) return NULL;
+    uint64_t lo = 0, hi = n - 1;
+    /* Interpolación: los hashes están repartidos de forma uniforme */
+    for (int s=0; s<INTERP_STEPS && hi - lo > INTERP_MIN; s++){
+        uint64_t a = e[lo].h, z = e[hi].h;
+        if (h < a || h > z) return NULL;
+        if (a == z) break;
+        uint64_t p = lo + (uint64_t)((double)(h - a) / (double)(z - a) * (double)(hi - lo));
+        if (p > hi) p = hi;
+        if (e[p].h == h) return &e[p];
+        if (e[p].h < h) lo = p + 1; else { if (p == 0) return NULL; hi = p - 1; }
+        if (lo > hi) return NULL;
+    }
+    while (lo <= hi){
+        uint64_t m = lo + (hi - lo) / 2;
+        if (e[m].h == h) return &e[m];
+        if (e[m].h < h) lo = m + 1;
+        else { if (m == 0) return NULL; hi = m - 1; }
+    }
+    return NULL;
+}
+
+int nameidx_postings(NameIdxReader *r, uint64_t h, NamePostings *p){
+    int b = (int)(h & 0xFF);
+    memset(p, 0, sizeof(*p));
+    if (!r->seg_tried) segment_open(r);
+    if (!r->seg) return 0;
+    const NameDirEntry *e = nameidx_dir_find(r->dict + r->bstart[b], r->bstart[b+1] - r->bstart[b], h);
+    if (!e) return 0;
+    /* La lista termina donde empieza la siguiente */
+    uint64_t end = (uint64_t)(e - r->dict) + 1 < r->nterms ? e[1].off : r->post_end;
+    if (e->off >= end || end > r->seg_size) goto bad;
+    if (e->enc == NAMEIDX_ENC_ROAR){
+        if (roar_view_open(&p->bm, r->seg + e->off, (size_t)(end - e->off)) != 0 || p->bm.card != e->df) goto bad;
+        p->is_bm = 1; p->n = e->df;
+        return 0;
+    }
+    if (e->enc == NAMEIDX_ENC_SKIP){
+        /* [bloques][relleno][PcodecSkip[nskip]][nskip u32] */
+        uint32_t nskip;
+        if (end - e->off < 4 || end % 8 != 0 || e->df < 2) goto bad;
+        memcpy(&nskip, r->seg + end - 4, 4);
+        uint64_t tab = end - 4 - (uint64_t)nskip * sizeof(PcodecSkip);
+        if (nskip != (e->df - 2) / PCODEC_BLOCK + 1 || tab > end || tab <= e->off) goto bad;
+        p->enc     = r->seg + e->off;
+        p->enc_end = r->seg + tab;
+        p->skip    = (const PcodecSkip*)(r->seg + tab);
+        p->nskip   = nskip;
+        if (pcodec_decode(p->enc, (size_t)(tab - e->off), 1, &p->first) != 0) goto bad;
+        p->is_skip = 1; p->n = e->df;
+        return 0;
+    }
+    if (e->enc != NAMEIDX_ENC_SVB) goto bad;
+    uint32_t *arr = malloc((size_t)e->df * sizeof(uint32_t));
+    if (!arr) return -1;
+    if (pcodec_decode(r->seg + e->off, (size_t)(end - e->off), e->df, arr) != 0){ free(arr); goto bad; }
+    p->v = p->own = arr; p->n = e->df;
+    return 0;
+bad:
+    fprintf(stderr, "Aviso: lista dañada en %s/" NAMEIDX_SEG_NAME " (hash %016" PRIx64 ")\n", r->dir, h);
+    memset(p, 0, sizeof(*p));
+    return -1;
+}
+
+void nameidx_postings_free(NamePostings *p){
+    free(p->own);
+    memset(p, 0, sizeof(*p));
+}
+
+/* Lista Roaring o con saltos -> arreglo propio */
+static int postings_expand(NamePostings *p){
+    if (!p->is_bm && !p->is_skip) return 0;
+    uint32_t *a = malloc((p->n ? p->n : 1) * sizeof(uint32_t));
+    if (!a) return -1;
+    if (p->is_bm) p->n = roar_to_array(&p->bm, a);
+    else if (pcodec_decode(p->enc, (size_t)(p->enc_end - p->enc), p->n, a) != 0){ free(a); return -1; }
+    free(p->own);
+    p->v = p->own = a; p->is_bm = p->is_skip = 0;
+    return 0;
+}
+
+int nameidx_postings_merge(NamePostings *p, const uint32_t *d, size_t nd){
+    if (nd == 0) return 0;
+    if (postings_expand(p) != 0) return -1;
+    uint32_t *m = malloc((p->n + nd + POPS_SLACK) * sizeof(uint32_t));
+    if (!m) return -1;
+    size_t k = pops_union(p->v, p->n, d, nd, m);
+    free(p->own);
+    p->v = p->own = m; p->n = k;
+    return 0;
+}
+
+/* Primer i' >= i con v[i'] >= x (n si no hay): pasos de 1, 2, 4... y
+   binaria en el último tramo, O(log distancia) */
+static size_t gallop_u32(const uint32_t *v, size_t n, size_t i, uint32_t x){
+    if (i >= n || v[i] >= x) return i;
+    size_t lo = i, step = 1;                        // v[lo] < x
+    while (lo + step < n && v[lo + step] < x){ lo += step; step <<= 1; }
+    size_t hi = lo + step < n ? lo + step : n;      // v[hi] >= x o hi == n
+    while (hi - lo > 1){
+        size_t m = lo + (hi - lo) / 2;
+        if (v[m] < x) lo = m; else hi = m;
+    }
+    return hi;
+}
+
+/* Lo mismo sobre los last de la tabla de saltos: primer bloque que puede
+   tener x */
+static size_t gallop_skip(const PcodecSkip *s, size_t n, size_t i, uint32_t x){
+    if (i >= n || s[i].last >= x) return i;
+    size_t lo = i, step = 1;
+    while (lo + step < n && s[lo + step].last < x){ lo += step; step <<= 1; }
+    size_t hi = lo + step < n ? lo + step : n;
+    while (hi - lo > 1){
+        size_t m = lo + (hi - lo) / 2;
+        if (s[m].last < x) lo = m; else hi = m;
+    }
+    return hi;
+}
+
+/* Filtro in situ de los candidatos c[0..n) (ascendentes) */
+static size_t filter_skip(uint32_t *c, size_t n, const NamePostings *p){
+    uint32_t blk[PCODEC_BLOCK];
+    size_t k = 0, b = 0, j = 0, nblk = 0, have = SIZE_MAX;
+    for (size_t i=0; i<n; i++){
+        uint32_t x = c[i];
+        if (x <= p->first){ if (x == p->first) c[k++] = x; continue; }
+        b = gallop_skip(p->skip, p->nskip, b, x);
+        if (b == p->nskip) break;
+        if (b != have){                              // solo el bloque que puede tener x
+            size_t from = 1 + b * PCODEC_BLOCK;
+            nblk = p->n - from < PCODEC_BLOCK ? p->n - from : PCODEC_BLOCK;
+            uint32_t base = b ? p->skip[b-1].last : p->first;
+            if (p->skip[b].off >= (size_t)(p->enc_end - p->enc) ||
+                !pcodec_decode_block(p->enc + p->skip[b].off, p->enc_end, nblk, base, blk)) break;
+            have = b; j = 0;
+        }
+        j = gallop_u32(blk, nblk, j, x);
+        if (j < nblk && blk[j] == x){ c[k++] = x; j++; }
+    }
+    return k;
+}
+
+uint32_t *nameidx_postings_and(const NamePostings *t, size_t n, size_t *out_n){
+    *out_n = 0;
+    if (n == 0) return NULL;
+    for (size_t i=0; i<n; i++) if (t[i].n == 0) return NULL;
+
+    /* De menor a mayor df */
+    const NamePostings **ord = malloc(n * sizeof(*ord));
+    if (!ord) return NULL;
+    for (size_t i=0; i<n; i++){
+        size_t j = i;
+        for (; j > 0 && ord[j-1]->n > t[i].n; j--) ord[j] = ord[j-1];
+        ord[j] = &t[i];
+    }
+
+    /* cur: candidatos; tmp: destino de pops_intersect (no admite solapes) */
+    const NamePostings *a = ord[0];
+    size_t from = 1, cn = 0;
+    uint32_t *cur = malloc((a->n + POPS_SLACK) * sizeof(uint32_t));
+    uint32_t *tmp = malloc((a->n + POPS_SLACK) * sizeof(uint32_t));
+    if (!cur || !tmp){ free(cur); free(tmp); free(ord); return NULL; }
+    if (a->is_bm && n > 1 && ord[1]->is_bm){ cn = roar_and(&a->bm, &ord[1]->bm, cur); from = 2; }
+    else if (a->is_bm) cn = roar_to_array(&a->bm, cur);
+    else if (a->is_skip) cn = pcodec_decode(a->enc, (size_t)(a->enc_end - a->enc), a->n, cur) == 0 ? a->n : 0;
+    else { memcpy(cur, a->v, a->n * sizeof(uint32_t)); cn = a->n; }
+
+    for (size_t i=from; i<n && cn; i++){
+        const NamePostings *p = ord[i];
+        if (p->is_bm)        cn = roar_and_array(&p->bm, cur, cn, cur);
+        else if (p->is_skip) cn = filter_skip(cur, cn, p);
+        else {
+            cn = pops_intersect(cur, cn, p->v, p->n, tmp);
+            uint32_t *t = cur; cur = tmp; tmp = t;
+        }
+    }
+    free(ord); free(tmp);
+    if (cn == 0){ free(cur); return NULL; }
+    *out_n = cn;
+    return cur;
+}
+
+/* ---- Cursor hacia atrás (los más recientes primero) ---- */
+void nameidx_rev_init(NameRevCursor *c, const NamePostings *p){
+    c->p    = p;
+    c->hi   = p->is_skip ? p->nskip : p->n;
+    c->have = SIZE_MAX;
+    c->nbuf = 0;
+}
+
+/* Cantidad de v[0..hi) que son <= x, retrocediendo 1, 2, 4... desde hi */
+static size_t gallop_rev(const uint32_t *v, size_t hi, uint32_t x){
+    if (hi == 0 || v[hi-1] <= x) return hi;
+    size_t top = hi - 1, step = 1;                   // v[top] > x
+    while (step <= top && v[top - step] > x){ top -= step; step <<= 1; }
+    size_t lo = step <= top ? top - step + 1 : 0;    // v[lo-1] <= x (o lo == 0)
+    while (lo < top){
+        size_t m = lo + (top - lo) / 2;
+        if (v[m] <= x) lo = m + 1; else top = m;
+    }
+    return lo;
+}
+
+int nameidx_rev_seek(NameRevCursor *c, uint32_t x, uint32_t *out){
+    const NamePostings *p = c->p;
+    if (p->is_bm) return roar_prev(&p->bm, x, out);
+    if (!p->is_skip){
+        c->hi = gallop_rev(p->v, c->hi, x);
+        if (c->hi == 0) return 0;
+        *out = p->v[c->hi - 1];
+        return 1;
+    }
+    if (x < p->first) return 0;
+    /* Primer bloque (hasta c->hi) cuyo último valor es >= x */
+    size_t lo = 0, hi = c->hi + 1;
+    while (lo < hi){
+        size_t m = lo + (hi - lo) / 2;
+        if (m < p->nskip && p->skip[m].last < x) lo = m + 1; else hi = m;
+    }
+    if (lo >= p->nskip){ *out = p->skip[p->nskip - 1].last; return 1; }
+    c->hi = lo;
+    if (p->skip[lo].last == x){ *out = x; return 1; }
+    uint32_t base = lo ? p->skip[lo-1].last : p->first;        // < x
+    if (c->have != lo){
+        size_t from = 1 + lo * PCODEC_BLOCK;
+        c->nbuf = p->n - from < PCODEC_BLOCK ? p->n - from : PCODEC_BLOCK;
+        if (p->skip[lo].off >= (size_t)(p->enc_end - p->enc) ||
+            !pcodec_decode_block(p->enc + p->skip[lo].off, p->enc_end, c->nbuf, base, c->buf)) return 0;
+        c->have = lo;
+    }
+    size_t k = gallop_rev(c->buf, c->nbuf, x);
+    *out = k ? c->buf[k-1] : base;
+    return 1;
+}
+
+int nameidx_row_offset(NameIdxReader *r, uint32_t row, uint64_t *off){
+    if (!r->seg_tried) segment_open(r);
+    if (row >= r->nrows && rows_map(r) != 0) return -1;
+    if (row >= r->nrows) return -1;
+    *off = r->rowoff[row];
+    return 0;
+}
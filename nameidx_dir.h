@@ -0,0 +1,218 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "roaring.h"
+#include "postings_codec.h"
+
+/* ============================================================
+   Directorio de términos de nameidx: nameidx/bXX.dir
+   Al lado de cada bXX.idx, una tabla ordenada por hash con la posición
+   de los postings de cada término en bXX.idx:
+
+     Cabecera (32 B) | entradas NameDirEntry[nterms]
+
+   Es un paso intermedio de la compactación: al terminar, los 256 pares
+   bXX.idx + bXX.dir se juntan en names.seg (abajo) y se borran.
+   La misma entrada sirve de diccionario en names.seg: los hashes de un
+   bucket comparten el byte bajo y el resto es uniforme (FNV-1a), así que
+   la búsqueda por interpolación llega en 1-2 pasos.
+   ============================================================ */
+
+#define NAMEIDX_DIR_VERSION 1
+
+typedef struct {
+    char     magic[8];      // "NIDXDIR"
+    uint64_t nterms;
+    uint64_t idx_size;      // tamaño de bXX.idx al escribir el directorio
+    uint32_t version;
+    uint32_t reserved;
+} __attribute__((packed)) NameDirHeader;
+
+#define NAMEIDX_ENC_RAW 0       // df u64 crudos (bXX.idx y names.seg v1/v2)
+#define NAMEIDX_ENC_SVB 1       // delta + Stream VByte (postings_codec.h), solo en names.seg
+#define NAMEIDX_ENC_ROAR 2      // contenedores Roaring (roaring.h), solo en names.seg
+#define NAMEIDX_ENC_SKIP 3      // como SVB + tabla de saltos al final, solo en names.seg
+
+typedef struct {
+    uint64_t h;
+    uint64_t off;           // primer posting en bXX.idx (tras [hash][df][pad])
+    uint32_t df;
+    uint32_t enc;           // NAMEIDX_ENC_*
+} NameDirEntry;
+
+/* ---- Escritura (compactación): entradas en orden de hash ---- */
+typedef struct {
+    FILE     *f;
+    char      path[600], tmp[610];
+    uint64_t  n;
+} NameDirWriter;
+
+/* Borra el bXX.dir anterior y empieza bXX.dir.tmp. 0 o -1 con errno. */
+int  nameidx_dir_begin(NameDirWriter *w, const char *dir, int b);
+int  nameidx_dir_add(NameDirWriter *w, uint64_t h, uint64_t off, uint32_t df);
+/* Cierra y renombra a bXX.dir; idx_size = tamaño final de bXX.idx */
+int  nameidx_dir_finish(NameDirWriter *w, uint64_t idx_size);
+void nameidx_dir_abort(NameDirWriter *w);
+
+/* ============================================================
+   Segmento único: nameidx/names.seg
+   Al terminar la compactación los 256 pares bXX.idx/bXX.dir se juntan en
+   un solo archivo y se borran:
+
+     Cabecera (64 B) | bstart[257] u64 | postings | diccionario NameDirEntry[nterms]
+
+   El diccionario va ordenado por (bucket, hash); los términos del bucket b
+   son [bstart[b], bstart[b+1]). En cada entrada, off es la posición (en
+   bytes, desde el inicio del archivo) de su lista y las listas están en el
+   mismo orden que el diccionario, así que cada una termina donde empieza
+   la siguiente (la última, en dict_off).
+   Versión 3: los postings son números de fila (u32, ver rows.off abajo)
+   comprimidos con NAMEIDX_ENC_SVB. Las versiones 1 y 2 guardaban offsets
+   del CSV (u64) y ya no se leen: hay que reconstruir el índice.
+   Versión 4: las listas de al menos NAMEIDX_ROAR_MIN_DF filas van como
+   contenedores Roaring (NAMEIDX_ENC_ROAR, alineadas a 8) si no ocupan más
+   del doble que comprimidas; los AND de palabras frecuentes se hacen
+   sobre el mapeo sin decodificarlas.
+   Versión 5: las demás listas de al menos NAMEIDX_SKIP_MIN_DF filas llevan
+   detrás de los bloques su tabla de saltos (NAMEIDX_ENC_SKIP):
+     [primer valor + bloques SVB] [relleno] [PcodecSkip[nskip]] [nskip u32]
+   con la que el AND salta directo al bloque que puede tener cada fila
+   candidata y decodifica solo ese.
+   Versión 6: el relleno de una lista con saltos la hace terminar alineada
+   a 8, así que una lista Roaring detrás no lleva relleno propio y nskip
+   son siempre los últimos 4 bytes (en la 5 podían ir seguidos de ceros;
+   esos segmentos ya no se leen).
+   ============================================================ */
+
+#define NAMEIDX_SEG_NAME    "names.seg"
+#define NAMEIDX_SEG_VERSION 6
+#define NAMEIDX_ROAR_MIN_DF 4096
+#define NAMEIDX_SKIP_MIN_DF 1024
+
+typedef struct {
+    char     magic[8];      // "NIDXSEG"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t nterms;
+    uint64_t nposts;
+    uint64_t dict_off;
+    uint64_t post_off;
+    uint64_t file_size;
+    uint64_t nrows;         // filas del CSV al construir (entradas de rows.off)
+} __attribute__((packed)) NameSegHeader;
+
+/* Junta los bXX.idx/bXX.dir de dir en names.seg (escribe en .tmp y
+   renombra) y borra los archivos por bucket. nrows = filas indexadas.
+   0 o -1 (mensaje en stderr). */
+int nameidx_segment_build(const char *dir, uint64_t nrows);
+
+/* ============================================================
+   Tabla fila -> offset: nameidx/rows.off
+   Los postings guardan el número de fila (0 = primera fila de datos) y
+   no el offset: 4 bytes en lugar de 8 por posting y listas densas que se
+   comprimen e intersecan mejor. El offset de cada fila se busca al final,
+   solo para las filas que se muestran:
+
+     Cabecera (16 B) | offset u64 [nrows]
+
+   Las filas crecen con el offset, así que "recientes primero" sigue
+   siendo el orden inverso de los postings. Cada ADD del servidor agrega
+   su offset al final (nameidx_rows_append) y anota el número de fila en
+   el delta; el siguiente build renumera el CSV completo y vacía updates/.
+   ============================================================ */
+
+#define NAMEIDX_ROWS_NAME    "rows.off"
+#define NAMEIDX_ROWS_VERSION 1
+
+typedef struct {
+    char     magic[8];      // "NIDXROW"
+    uint32_t version;
+    uint32_t reserved;
+} __attribute__((packed)) NameRowsHeader;
+
+/* Escribe la cabecera de una tabla nueva en f (los offsets van detrás) */
+int nameidx_rows_header(FILE *f);
+/* Agrega una fila al final de dir/rows.off (la crea si no existe);
+   *row = su número. 0 o -1 con errno (ERANGE si no cabe en 32 bits). */
+int nameidx_rows_append(const char *dir, uint64_t off, uint32_t *row);
+
+/* ---- Lectura ----
+   names.seg y rows.off se mapean una vez (al primer uso) y quedan así
+   hasta nameidx_reader_close, así que un proceso largo (track_server)
+   solo paga la apertura una vez. Las listas cortas se decodifican a
+   memoria propia; las Roaring y las que tienen tabla de saltos se usan
+   desde el mapeo. */
+typedef struct {
+    char                dir[512];
+    int                 seg_tried;
+    unsigned char      *seg;      // names.seg mapeado (NULL = no hay índice válido)
+    size_t              seg_size;
+    const uint64_t     *bstart;
+    const NameDirEntry *dict;
+    uint64_t            nterms;
+    uint64_t            post_end; // fin de la última lista
+    unsigned char      *rmap;     // rows.off mapeado
+    size_t              rsize;
+    const uint64_t     *rowoff;
+    uint64_t            nrows;
+} NameIdxReader;
+
+void nameidx_reader_init(NameIdxReader *r, const char *dir);
+void nameidx_reader_close(NameIdxReader *r);
+/* Entrada del término h en una tabla ordenada por hash, o NULL */
+const NameDirEntry *nameidx_dir_find(const NameDirEntry *e, uint64_t n, uint64_t h);
+
+/* Postings de un término: filas ascendentes en un arreglo o, sobre el
+   mapeo de names.seg, la vista Roaring (is_bm) o la lista comprimida con
+   su tabla de saltos (is_skip) */
+typedef struct {
+    const uint32_t   *v;
+    size_t            n;        // filas (con cualquier representación)
+    uint32_t         *own;      // memoria de v, si es propia
+    RoarView          bm;
+    int               is_bm;
+    const uint8_t    *enc, *enc_end;   // primer valor + bloques
+    const PcodecSkip *skip;
+    uint32_t          nskip, first;
+    int               is_skip;
+} NamePostings;
+
+/* Postings base de h (n = 0 si no está). 0 o -1 si la lista está dañada
+   o falta memoria. */
+int  nameidx_postings(NameIdxReader *r, uint64_t h, NamePostings *p);
+/* Suma las filas del delta (ascendentes, sin repetidos); una lista
+   Roaring o con saltos pasa a arreglo. 0 o -1. */
+int  nameidx_postings_merge(NamePostings *p, const uint32_t *d, size_t nd);
+/* AND de t[0..n): filas ascendentes en memoria nueva (la libera quien
+   llama); NULL con *out_n = 0 si no hay ninguna. Se parte de la lista
+   más corta y los candidatos se filtran con las demás de menor a mayor
+   df: pops_intersect en los arreglos (SIMD o búsqueda exponencial según
+   los tamaños), tabla de saltos + un bloque
+   en las comprimidas, bits en las Roaring (si las dos más cortas son
+   Roaring se cruzan contenedor a contenedor). El costo sigue a la lista
+   más rara, no a la más larga. */
+uint32_t *nameidx_postings_and(const NamePostings *t, size_t n, size_t *out_n);
+void nameidx_postings_free(NamePostings *p);
+
+/* Recorrido de una lista desde el final (los más recientes primero):
+   seek da la mayor fila <= x. Las x de llamadas sucesivas no pueden
+   subir; así cada cursor lee su lista una vez como mucho (galloping
+   hacia atrás en arreglos, tabla de saltos y un solo bloque en las
+   comprimidas, roar_prev en Roaring). Base de las consultas de
+   name_query.h. */
+typedef struct {
+    const NamePostings *p;
+    size_t   hi;                        // arreglo: v[0..hi) sin descartar; saltos: bloques [0..hi]
+    size_t   have;                      // bloque decodificado en buf
+    uint32_t buf[PCODEC_BLOCK];
+    size_t   nbuf;
+} NameRevCursor;
+
+void nameidx_rev_init(NameRevCursor *c, const NamePostings *p);
+/* 1 con *out = mayor fila <= x; 0 si no hay ninguna (o lista dañada) */
+int  nameidx_rev_seek(NameRevCursor *c, uint32_t x, uint32_t *out);
+/* Offset en el CSV de la fila row. Si la fila es posterior al mapeo
+   (ADD después de abrir) se vuelve a mapear rows.off. 0 o -1. */
+int nameidx_row_offset(NameIdxReader *r, uint32_t row, uint64_t *off);
@@ -1,9 +1,14 @@
 /*
   p1-dataProgram.c (rev con delta nameidx + "recientes primero")
-  - Lookup por ID usando tracks.idx (IDX1TRK)
-  - Búsqueda por palabras = base (nameidx/bXX.idx) + delta (nameidx/updates/bXX.log)
+  - Lookup por ID usando tracks.idx (ver track_idx.h); si existe
+    tracks.idx.rows muestra todas las apariciones del track en los charts
+    (las más recientes primero)
+  - Búsqueda por palabras = base (nameidx/names.seg) + delta (nameidx/updates/bXX.log);
+    las palabras admiten OR, NOT / -palabra y paréntesis (ver name_query.h)
   - Soporta filas nuevas “cortas” (track_id,name,artist,album,duration_ms)
   - Muestra los resultados más recientes primero en la búsqueda por palabras
+  - Los resultados de la búsqueda salen de nameidx/docs.seg (ver docstore.h);
+    el CSV solo se lee para las filas agregadas después del build
 
   Menú:
     0) Ingresar track_id exacto
@@ -33,22 +38,17 @@
 #include <unistd.h>
 
 #include "add_track.h"
+#include "track_idx.h"
+#include "track_rows.h"
+#include "nameidx_dir.h"
+#include "name_query.h"
+#include "docstore.h"
+#include "radix_sort.h"
 
 /* ---------- Constantes ---------- */
 #define NBKT 256
 #define MAX_SHOW 20
 
-/* ---------- Estructuras del índice por ID ---------- */
-typedef struct {
-    char     magic[8];
-    uint64_t capacity;   // número de slots (potencia de 2)
-    uint32_t key_col;    // columna de track_id en el CSV
-    uint32_t version;
-    uint64_t reserved[3];
-} __attribute__((packed)) IdxHeader;
-
-typedef struct { uint64_t hash, offset; } __attribute__((packed)) Slot;
-
 /* ---------- CSV (parser que respeta comillas) ---------- */
 static size_t parse_csv_line(const char *line, char **out, size_t max_fields){
     size_t n=0, L=strlen(line), bi=0; int inq=0;
@@ -120,14 +120,6 @@ static size_t tokenize_unique(const char *norm, char ***out_tokens){
     *out_tokens=tok; return m;
 }
 
-/* ---------- Comparador uint64 (para qsort) ---------- */
-static int cmp_u64(const void *a,const void *b){
-    const uint64_t *pa=(const uint64_t*)a, *pb=(const uint64_t*)b;
-    if (*pa < *pb) return -1;
-    if (*pa > *pb) return 1;
-    return 0;
-}
-
 /* ---------- Hash FNV-1a 64 ---------- */
 static uint64_t fnv1a64(const char *s){
     const uint64_t OFF=1469598103934665603ULL, PR=1099511628211ULL;
@@ -137,35 +129,13 @@ static uint64_t fnv1a64(const char *s){
     return h;
 }
 
-/* ---------- Lectura postings base ---------- */
-static uint64_t *load_postings(const char *dir, uint64_t h, size_t *out_n){
-    int b=(int)(h & (NBKT-1));
-    char path[512]; snprintf(path,sizeof(path),"%s/b%02x.idx",dir,b);
-    FILE *f=fopen(path,"rb"); if(!f){ *out_n=0; return NULL; }
-    for(;;){
-        uint64_t hh; uint32_t df, pad;
-        if (fread(&hh,8,1,f)!=1) break;
-        if (fread(&df,4,1,f)!=1) break;
-        if (fread(&pad,4,1,f)!=1) break;
-        if (hh==h){
-            uint64_t *arr=malloc((size_t)df*sizeof(uint64_t));
-            if (!arr){ fclose(f); *out_n=0; return NULL; }
-            if (fread(arr,8,df,f)!=(size_t)df){ free(arr); fclose(f); *out_n=0; return NULL; }
-            fclose(f); *out_n=df; return arr;
-        } else {
-            if (fseeko(f, (off_t)df*8, SEEK_CUR)!=0) break;
-        }
-    }
-    fclose(f); *out_n=0; return NULL;
-}
-
 /* ---------- Lectura postings delta (nameidx/updates/bXX.log) ---------- */
-static uint64_t *load_postings_delta(const char *dir, uint64_t h, size_t *out_n){
+static uint32_t *load_postings_delta(const char *dir, uint64_t h, size_t *out_n){
     int b=(int)(h & (NBKT-1));
-    char path[512]; snprintf(path,sizeof(path),"%s/updates/b%02x.log",dir,b);
+    char path[600]; snprintf(path,sizeof(path),"%s/updates/b%02x.log",dir,b);
     FILE *f=fopen(path,"rb"); if(!f){ *out_n=0; return NULL; }
 
-    size_t cap=128, n=0; uint64_t *arr=malloc(cap*sizeof(uint64_t));
+    size_t cap=128, n=0; uint32_t *arr=malloc(cap*sizeof(uint32_t));
     char *line=NULL; size_t L=0; ssize_t len;
     while ((len=getline(&line,&L,f))>0){
         if (len < 18) continue;               /* 16 hex + espacio mínimo */
@@ -176,46 +146,21 @@ static uint64_t *load_postings_delta(const char *dir, uint64_t h, size_t *out_n)
 
         char *sp=strchr(line,' ');
         if (!sp) continue;
-        uint64_t off=0; if (sscanf(sp+1,"%" SCNu64, &off)!=1) continue;
+        uint32_t row=0; if (sscanf(sp+1,"%" SCNu32, &row)!=1) continue;
 
-        if (n==cap){ cap*=2; arr=realloc(arr,cap*sizeof(uint64_t)); }
-        arr[n++]=off;
+        if (n==cap){ cap*=2; arr=realloc(arr,cap*sizeof(uint32_t)); }
+        arr[n++]=row;
     }
     free(line); fclose(f);
 
     if (n>1){
-        qsort(arr,n,sizeof(uint64_t),cmp_u64);
+        radix_sort_u32(arr,n,NULL);
         size_t m=0; for(size_t i=0;i<n;i++){ if (m==0 || arr[i]!=arr[m-1]) arr[m++]=arr[i]; }
         n=m;
     }
     *out_n=n; return arr;
 }
 
-/* ---------- Merge base + delta (ambas ordenadas) ---------- */
-static uint64_t *merge_base_delta(const uint64_t *base,size_t nb,const uint64_t *del,size_t nd,size_t *nout){
-    uint64_t *r=malloc(((nb+nd)?(nb+nd):1)*sizeof(uint64_t));
-    size_t i=0,j=0,k=0;
-    while(i<nb && j<nd){
-        if (base[i] < del[j]) r[k++]=base[i++];
-        else if (del[j] < base[i]) r[k++]=del[j++];
-        else { r[k++]=base[i]; i++; j++; }
-    }
-    while(i<nb) r[k++]=base[i++];
-    while(j<nd) r[k++]=del[j++];
-    *nout=k; return r;
-}
-
-/* ---------- Intersección (decl/proto + def) ---------- */
-static uint64_t *intersect(const uint64_t *a, size_t na,
-                           const uint64_t *b, size_t nb,
-                           size_t *nc);
-
-static uint64_t *intersect(const uint64_t *a,size_t na,const uint64_t *b,size_t nb,size_t *nc){
-    size_t i=0,j=0,cap=(na<nb?na:nb),n=0; uint64_t *c=malloc((cap?cap:1)*sizeof(uint64_t));
-    while(i<na && j<nb){ if(a[i]==b[j]){ c[n++]=a[i]; i++; j++; } else if(a[i]<b[j]) i++; else j++; }
-    *nc=n; return c;
-}
-
 /* ---------- Detección de columnas + formateo compacto ---------- */
 typedef struct { int track_id, track_name, artist, date, region; } ColIdx;
 static ColIdx gcols = {10, 1, 4, 3, 6};  // defaults por si el header no está
@@ -258,116 +203,118 @@ static void print_compact_line(const char *line){
     printf("%s | %s | %s | %s | %s\n", id, name, art, date, reg);
     free_fields(f,nx);
 }
+/* La misma línea desde docs.seg (sin copiar los campos) */
+static void print_doc(const DocView *v){
+    printf("%.*s | %.*s | %.*s | %.*s | %.*s\n", v->id.len, v->id.s, v->name.len, v->name.s,
+           v->artist.len, v->artist.s, v->date.len, v->date.s, v->region.len, v->region.s);
+}
 
 /* ---------- Lookup por track_id (usa tracks.idx) ---------- */
 static int lookup_by_id(const char *csv, const char *idx, const char *key){
-    int fd = open(idx, O_RDONLY);
-    if (fd < 0){ fprintf(stderr,"Índice: %s\n", strerror(errno)); return -1; }
-    off_t sz = lseek(fd, 0, SEEK_END);
-    void *map = mmap(NULL, sz, PROT_READ, MAP_SHARED, fd, 0);
-    if (map == MAP_FAILED){ fprintf(stderr,"mmap: %s\n", strerror(errno)); close(fd); return -1; }
-
-    IdxHeader *h = (IdxHeader*)map;
-    if (strncmp(h->magic,"IDX1TRK",7)!=0){
-        fprintf(stderr,"Índice inválido\n"); munmap(map,sz); close(fd); return -1;
+    TrackIdx ti;
+    if (trackidx_open(&ti, idx, 0) != 0){
+        if (errno == EINVAL) fprintf(stderr,"Índice inválido\n");
+        else fprintf(stderr,"Índice: %s\n", strerror(errno));
+        return -1;
     }
-    uint64_t cap=h->capacity; uint32_t key_col=h->key_col;
-    Slot *slots = (Slot*)((char*)map + sizeof(IdxHeader));
 
     FILE *fp=fopen(csv,"r");
-    if(!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); munmap(map,sz); close(fd); return -1; }
+    if(!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); trackidx_close(&ti); return -1; }
     setvbuf(fp,NULL,_IOFBF,4*1024*1024);
 
-    uint64_t hv=fnv1a64(key), i=hv&(cap-1), start=i;
-    char *line=NULL; size_t bufcap=0; ssize_t len;
-    int found=0;
-
-    for(;;){
-        Slot s=slots[i];
-        if(s.hash==0) break;
-        if(s.hash==hv){
-            if (fseeko(fp,(off_t)s.offset,SEEK_SET)==0){
-                len=getline(&line,&bufcap,fp);
-                if (len>0){
-                    char *f[256]={0};
-                    size_t nx=parse_csv_line(line,f,256);
-
-                    /* Fallback: si key_col está fuera de rango (fila corta), usar col 0 */
-                    const char *field = NULL;
-                    if (key_col < (uint32_t)nx) field = f[key_col];
-                    else if (nx > 0)            field = f[0];
-
-                    if (field && strcmp(field,key)==0){
-                        print_compact_line(line);
-                        free_fields(f,nx); found=1; break;
-                    }
-                    free_fields(f,nx);
-                }
+    /* Con IDX2TRK la clave se compara en memoria; el CSV solo se lee para imprimir */
+    uint64_t off=0;
+    int found = trackidx_find(&ti, key, fp, &off);
+    if (found){
+        /* Historial completo si hay tracks.idx.rows; si no (o el track se
+           agregó después del build) solo la primera fila */
+        char rows_path[600]; trackrows_path(rows_path, sizeof(rows_path), idx);
+        TrackRows tr; uint64_t n=0;
+        const RowEntry *e = NULL;
+        int have_rows = trackrows_open(&tr, rows_path) == 0;
+        if (have_rows) e = trackrows_get(&tr, off, &n);
+
+        char *line=NULL; size_t bufcap=0; ssize_t len=-1;
+        if (e && n > 1){
+            uint64_t shown=0;
+            for (uint64_t i=n; i-- > 0 && shown < MAX_SHOW; ){
+                if (fseeko(fp,(off_t)e[i].offset,SEEK_SET)!=0) continue;
+                if (getline(&line,&bufcap,fp)>0){ print_compact_line(line); shown++; }
             }
+            printf("(%" PRIu64 " apariciones en charts; mostrando %" PRIu64 ")\n", n, shown);
+        } else {
+            if (fseeko(fp,(off_t)off,SEEK_SET)==0) len=getline(&line,&bufcap,fp);
+            if (len>0) print_compact_line(line); else found=0;
         }
-        i=(i+1)&(cap-1);
-        if (i==start) break;
+        free(line);
+        if (have_rows) trackrows_close(&tr);
     }
 
-    free(line); fclose(fp); munmap(map,sz); close(fd);
+    fclose(fp); trackidx_close(&ti);
     if(!found) printf("NOT_FOUND\n");
     return found?0:1;
 }
 
 /* ---------- Búsqueda por palabras (base + delta) ---------- */
-static int search_by_words(const char *csv, const char *dir, const char **words, int nwords){
-    uint64_t *post=NULL; size_t pn=0;
-    for(int qi=0; qi<nwords; ++qi){
-        char *norm=normalize_utf8_basic(words[qi]);
-        char **toks=NULL; size_t ntok=tokenize_unique(norm,&toks);
-        free(norm);
-        if (ntok==0){ free(toks); continue; }
-
-        uint64_t h = fnv1a64(toks[0]);        /* usamos el 1er token del argumento */
-        for (size_t k=0;k<ntok;k++){ free(toks[k]); }
-        free(toks);
-
-        /* Cargar base + delta y fusionar */
-        size_t tn_base=0, tn_delta=0, tn=0;
-        uint64_t *tp_base  = load_postings(dir, h, &tn_base);
-        uint64_t *tp_delta = load_postings_delta(dir, h, &tn_delta);
-        uint64_t *tp = NULL;
-
-        if (tp_base && tp_delta) {
-            tp = merge_base_delta(tp_base, tn_base, tp_delta, tn_delta, &tn);
-            free(tp_base); free(tp_delta);
-        } else if (tp_base) {
-            tp = tp_base; tn = tn_base;
-        } else if (tp_delta) {
-            tp = tp_delta; tn = tn_delta;
-        } else {
-            tp = NULL; tn = 0;
-        }
-
-        if (qi==0){ post=tp; pn=tn; }
-        else {
-            size_t cn=0; uint64_t *cp=intersect(post,pn,tp,tn,&cn);
-            free(post); free(tp); post=cp; pn=cn;
-        }
-        if (pn==0) break;
+typedef struct { NameIdxReader *names; } WordSource;
+
+static size_t word_terms(void *ctx, const char *word, uint64_t *h, size_t max){
+    (void)ctx;
+    char *norm=normalize_utf8_basic(word);
+    char **toks=NULL; size_t ntok=tokenize_unique(norm,&toks);
+    free(norm);
+    for (size_t k=0;k<ntok;k++){            /* todos los tokens de la palabra */
+        if (k<max) h[k]=fnv1a64(toks[k]);
+        free(toks[k]);
     }
-    if (pn==0 || !post){ printf("NOT_FOUND\n"); return 1; }
+    free(toks);
+    return ntok;
+}
 
-    FILE *fp=fopen(csv,"r");
-    if(!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); free(post); return -1; }
-    setvbuf(fp,NULL,_IOFBF,4*1024*1024);
+static void word_postings(void *ctx, uint64_t h, NamePostings *p){
+    NameIdxReader *names = ((WordSource*)ctx)->names;
+    size_t tn_delta=0;
+    nameidx_postings(names, h, p);
+    uint32_t *tp_delta = load_postings_delta(names->dir, h, &tn_delta);
+    if (nameidx_postings_merge(p, tp_delta, tn_delta)!=0) p->n=0;
+    free(tp_delta);
+}
 
-    /* Mostrar los más recientes primero (últimos MAX_SHOW) */
+static int search_by_words(const char *csv, NameIdxReader *names, const DocStore *docs, const char **words, int nwords){
+    /* las palabras de los criterios forman una sola consulta */
+    char text[1600]=""; size_t L=0;
+    for (int qi=0; qi<nwords; ++qi)
+        L += (size_t)snprintf(text+L, sizeof(text)-L, "%s%s", qi?" ":"", words[qi]);
+    WordSource ws = { names };
+    NameQuerySource src = { &ws, word_terms, word_postings };
+    char err[128];
+    NameQuery *q = name_query_parse(text, &src, err, sizeof(err));
+    if (!q){ printf("Consulta inválida: %s\n", err); return -1; }
+
+    /* Solo los MAX_SHOW más recientes: evaluación desde el final, ya en orden */
+    uint32_t post[MAX_SHOW];
+    size_t pn=name_query_last(q,UINT32_MAX,MAX_SHOW,post);
+    name_query_free(q);
+    if (pn==0){ printf("NOT_FOUND\n"); return 1; }
+
+    /* docs.seg; el CSV (abierto al primer uso) solo para filas posteriores al build */
+    FILE *fp=NULL;
     size_t shown=0;
-    size_t start = (pn > MAX_SHOW) ? (pn - MAX_SHOW) : 0;
-    for (ssize_t idx = (ssize_t)pn - 1; idx >= (ssize_t)start && shown < MAX_SHOW; --idx) {
-        if (fseeko(fp,(off_t)post[idx],SEEK_SET)!=0) continue;
+    for (size_t idx = 0; idx < pn; ++idx) {
+        DocView v;
+        if (docs_get(docs,post[idx],&v)){ print_doc(&v); shown++; continue; }
+        if (!fp){
+            fp=fopen(csv,"r");
+            if(!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); return -1; }
+        }
+        uint64_t off;
+        if (nameidx_row_offset(names,post[idx],&off)!=0 || fseeko(fp,(off_t)off,SEEK_SET)!=0) continue;
         char *line=NULL; size_t cap=0; ssize_t len=getline(&line,&cap,fp);
         if (len>0){ print_compact_line(line); shown++; }
         free(line);
     }
     if (shown==0) printf("NOT_FOUND\n");
-    fclose(fp); free(post);
+    if (fp) fclose(fp);
     return shown?0:1;
 }
 
@@ -388,6 +335,13 @@ int main(void){
 
     /* Detectar columnas del CSV una sola vez para la salida compacta */
     load_cols_once(csv);
+    /* Directorios de términos de nameidx: se abren al primer uso */
+    NameIdxReader names;
+    nameidx_reader_init(&names, namedir);
+    /* Columnas de los resultados por fila (sin docs.seg se leen del CSV) */
+    DocStore docs;
+    if (docs_open(&docs, namedir) != 0 && errno == ENOENT)
+        fprintf(stderr, "Aviso: falta %s/" DOCS_NAME "; los resultados se leen del CSV (reconstruye el índice)\n", namedir);
 
     char id[256]="";
     char w1[128]="", w2[128]="", w3[128]="";
@@ -470,7 +424,7 @@ int main(void){
                 if (w2[0]) words[n++]=w2;
                 if (w3[0]) words[n++]=w3;
                 if (n==0) printf("NOT_FOUND\n");
-                else (void)search_by_words(csv, namedir, words, n);
+                else (void)search_by_words(csv, &names, &docs, words, n);
             }
             printf("=== Fin ===\n");
         } else if (o==5){
@@ -479,5 +433,7 @@ int main(void){
             printf("Opción inválida.\n");
         }
     }
+    nameidx_reader_close(&names);
+    docs_close(&docs);
     return 0;
 }
@@ -0,0 +1,218 @@
+/* postings_codec.c
+   Delta + Stream VByte para listas de postings. Ver postings_codec.h.
+*/
+
+#include "postings_codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define PCODEC_SIMD 1
+#endif
+
+/* ---------- Tablas: largo de datos y máscara pshufb por byte de control ---------- */
+static uint8_t pc_len[256];
+static uint8_t pc_shuf[256][16];
+static int     pc_ready;          // 0 sin armar, 1 escalar, 2 SSSE3
+
+static int tables_init(void){
+    int st = __atomic_load_n(&pc_ready, __ATOMIC_ACQUIRE);
+    if (st) return st;
+    for (int c=0; c<256; c++){
+        int pos = 0;
+        for (int j=0; j<4; j++){
+            int len = ((c >> (2*j)) & 3) + 1;
+            for (int b=0; b<4; b++)
+                pc_shuf[c][4*j+b] = (uint8_t)(b < len ? pos + b : 0x80);
+            pos += len;
+        }
+        pc_len[c] = (uint8_t)pos;
+    }
+    st = 1;
+#ifdef PCODEC_SIMD
+    if (__builtin_cpu_supports("ssse3")) st = 2;
+#endif
+    __atomic_store_n(&pc_ready, st, __ATOMIC_RELEASE);
+    return st;
+}
+
+/* ---------- Codificación ---------- */
+static inline unsigned gap_len(uint32_t g){
+    return g < (1u<<8) ? 1 : g < (1u<<16) ? 2 : g < (1u<<24) ? 3 : 4;
+}
+
+/* k saltos -> [controles][datos]; devuelve los bytes escritos */
+static size_t enc_block(const uint32_t *g, size_t k, uint8_t *out){
+    size_t nc = (k + 3) / 4;
+    uint8_t *d = out + nc;
+    memset(out, 0, nc);
+    for (size_t i=0; i<k; i++){
+        unsigned len = gap_len(g[i]);
+        out[i>>2] |= (uint8_t)((len - 1) << ((i & 3) * 2));
+        memcpy(d, &g[i], len);          // little endian, como el resto del índice
+        d += len;
+    }
+    return (size_t)(d - out);
+}
+
+/* Primer valor en LEB128: 7 bits por byte, el bit alto indica que sigue
+   otro (1 a 5 bytes) */
+static size_t put_varint(uint32_t x, uint8_t *out){
+    size_t i = 0;
+    while (x >= 0x80){ out[i++] = (uint8_t)(x | 0x80); x >>= 7; }
+    out[i++] = (uint8_t)x;
+    return i;
+}
+
+static const uint8_t *get_varint(const uint8_t *in, const uint8_t *end, uint32_t *x){
+    uint32_t v = 0;
+    for (unsigned sh=0; sh<32 && in<end; sh+=7){
+        uint8_t c = *in++;
+        v |= (uint32_t)(c & 0x7F) << sh;
+        if (!(c & 0x80)){ *x = v; return in; }
+    }
+    return NULL;
+}
+
+size_t pcodec_bound(size_t n){
+    if (n == 0) return 0;
+    return 5 + (n - 1) / 4 + 1 + 4 * (n - 1);
+}
+
+size_t pcodec_encode(const uint32_t *v, size_t n, uint8_t *out){
+    if (n == 0) return 0;
+    size_t pos = put_varint(v[0], out);
+    uint32_t g[PCODEC_BLOCK];
+    for (size_t i=1; i<n; ){
+        size_t k = n - i < PCODEC_BLOCK ? n - i : PCODEC_BLOCK;
+        for (size_t j=0; j<k; j++) g[j] = v[i+j] - v[i+j-1];
+        pos += enc_block(g, k, out + pos);
+        i += k;
+    }
+    return pos;
+}
+
+void pcodec_writer_begin(PcodecWriter *w, FILE *f){
+    memset(w, 0, sizeof(*w));
+    w->f = f;
+}
+
+void pcodec_writer_begin_skip(PcodecWriter *w, FILE *f){
+    pcodec_writer_begin(w, f);
+    w->keep_skip = 1;
+}
+
+void pcodec_writer_free(PcodecWriter *w){
+    free(w->skip);
+    w->skip = NULL; w->nskip = w->capskip = 0;
+}
+
+static int writer_flush(PcodecWriter *w){
+    if (w->keep_skip){
+        if (w->bytes > UINT32_MAX){ w->err = 1; return -1; }
+        if (w->nskip == w->capskip){
+            size_t cap = w->capskip ? 2 * w->capskip : 64;
+            PcodecSkip *s = realloc(w->skip, cap * sizeof(PcodecSkip));
+            if (!s){ w->err = 1; return -1; }
+            w->skip = s; w->capskip = cap;
+        }
+        w->skip[w->nskip++] = (PcodecSkip){ w->prev, (uint32_t)w->bytes };
+    }
+    uint8_t buf[PCODEC_BLOCK / 4 + 4 * PCODEC_BLOCK];
+    size_t len = enc_block(w->gap, w->k, buf);
+    if (w->f && fwrite(buf, 1, len, w->f) != len) return -1;
+    w->bytes += len; w->k = 0;
+    return 0;
+}
+
+int pcodec_writer_add(PcodecWriter *w, const uint32_t *v, size_t n){
+    for (size_t i=0; i<n; i++){
+        if (w->n++ == 0){
+            uint8_t b[5];
+            size_t len = put_varint(v[i], b);
+            if (w->f && fwrite(b, 1, len, w->f) != len) return -1;
+            w->bytes = len;
+            w->prev = v[i];
+        } else {
+            w->gap[w->k++] = v[i] - w->prev;
+            w->prev = v[i];
+            if (w->k == PCODEC_BLOCK && writer_flush(w) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+int pcodec_writer_end(PcodecWriter *w){
+    return w->k ? writer_flush(w) : 0;
+}
+
+/* ---------- Decodificación ---------- */
+/* Saltos [i, k) de un bloque, uno por uno */
+static const uint8_t *dec_tail(const uint8_t *ctrl, const uint8_t *d, const uint8_t *end,
+                               size_t i, size_t k, uint32_t v, uint32_t *out){
+    for (; i<k; i++){
+        unsigned len = ((ctrl[i>>2] >> ((i & 3) * 2)) & 3) + 1;
+        if ((size_t)(end - d) < len) return NULL;
+        uint32_t g = 0;
+        memcpy(&g, d, len);
+        d += len; v += g; out[i] = v;
+    }
+    return d;
+}
+
+static const uint8_t *dec_block_scalar(const uint8_t *in, const uint8_t *end, size_t k,
+                                       uint32_t base, uint32_t *out){
+    size_t nc = (k + 3) / 4;
+    if ((size_t)(end - in) < nc) return NULL;
+    return dec_tail(in, in + nc, end, 0, k, base, out);
+}
+
+#ifdef PCODEC_SIMD
+/* 4 saltos por byte de control: pshufb los expande a 4 u32 y la suma
+   prefija se hace con dos sumas desplazadas (4 y 8 bytes) */
+__attribute__((target("ssse3")))
+static const uint8_t *dec_block_ssse3(const uint8_t *in, const uint8_t *end, size_t k,
+                                      uint32_t base, uint32_t *out){
+    size_t nc = (k + 3) / 4, i = 0;
+    if ((size_t)(end - in) < nc) return NULL;
+    const uint8_t *ctrl = in, *d = in + nc;
+    __m128i vb = _mm_set1_epi32((int)base);
+    for (; i + 4 <= k && end - d >= 16; i += 4){
+        uint8_t c = ctrl[i>>2];
+        __m128i g = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)d),
+                                     _mm_loadu_si128((const __m128i*)pc_shuf[c]));
+        g = _mm_add_epi32(g, _mm_slli_si128(g, 4));        // g0, g0+g1, g1+g2, g2+g3
+        g = _mm_add_epi32(g, _mm_slli_si128(g, 8));        // sumas prefijas
+        g = _mm_add_epi32(g, vb);
+        _mm_storeu_si128((__m128i*)(out + i), g);
+        vb = _mm_shuffle_epi32(g, 0xFF);
+        d += pc_len[c];
+    }
+    /* Resto del bloque (y los últimos bytes de la lista) */
+    return dec_tail(ctrl, d, end, i, k, i ? out[i-1] : base, out);
+}
+#endif
+
+const uint8_t *pcodec_decode_block(const uint8_t *in, const uint8_t *end, size_t k,
+                                   uint32_t base, uint32_t *out){
+#ifdef PCODEC_SIMD
+    if (tables_init() == 2) return dec_block_ssse3(in, end, k, base, out);
+#else
+    tables_init();
+#endif
+    return dec_block_scalar(in, end, k, base, out);
+}
+
+int pcodec_decode(const uint8_t *in, size_t avail, size_t n, uint32_t *out){
+    if (n == 0) return 0;
+    const uint8_t *end = in + avail;
+    if (!(in = get_varint(in, end, &out[0]))) return -1;
+    for (size_t i=1; i<n; ){
+        size_t k = n - i < PCODEC_BLOCK ? n - i : PCODEC_BLOCK;
+        if (!(in = pcodec_decode_block(in, end, k, out[i-1], out + i))) return -1;
+        i += k;
+    }
+    return 0;
+}
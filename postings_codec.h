@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* ============================================================
+   Compresión de listas de postings (números de fila ascendentes):
+   saltos entre filas consecutivas codificados con Stream VByte.
+
+     [primer valor, varint LEB128] [bloque]...
+     bloque (hasta PCODEC_BLOCK saltos): [controles][datos]
+       controles: 1 byte cada 4 saltos, 2 bits por salto = largo - 1
+       datos: cada salto en 1..4 bytes (little endian)
+
+   Separar controles y datos permite decodificar 4 saltos con un solo
+   pshufb (tabla de 256 máscaras) y la suma prefija en SSE2; se elige en
+   tiempo de ejecución (SSSE3) y hay versión escalar. Los bloques se
+   pueden escribir sin conocer el largo total de la lista.
+   Con valores de 32 bits todo salto cabe en 4 bytes: cualquier lista se
+   puede codificar.
+   ============================================================ */
+
+#define PCODEC_BLOCK 128
+
+/* Bytes máximos que ocupa una lista de n valores */
+size_t pcodec_bound(size_t n);
+/* Codifica en memoria (v ascendente); devuelve los bytes escritos */
+size_t pcodec_encode(const uint32_t *v, size_t n, uint8_t *out);
+/* Decodifica n valores; avail = bytes legibles desde in (puede sobrar).
+   0 o -1 si la lista está truncada. */
+int    pcodec_decode(const uint8_t *in, size_t avail, size_t n, uint32_t *out);
+
+/* Un bloque: k saltos (PCODEC_BLOCK salvo el último de la lista) sumados
+   a base (el valor anterior). Devuelve dónde termina o NULL si está
+   truncado. Con la tabla de saltos permite decodificar solo los bloques
+   que hacen falta. */
+const uint8_t *pcodec_decode_block(const uint8_t *in, const uint8_t *end, size_t k,
+                                   uint32_t base, uint32_t *out);
+
+/* Tabla de saltos: por bloque, su último valor y dónde empieza (bytes
+   desde el inicio de la lista). El bloque i cubre los valores
+   1 + i*PCODEC_BLOCK ...; su base es el last del anterior (o el primero). */
+typedef struct { uint32_t last, off; } PcodecSkip;
+
+/* Escritura por partes a un FILE (listas que no caben en memoria).
+   Con f = NULL solo cuenta los bytes. */
+typedef struct {
+    FILE       *f;
+    uint64_t    n, bytes;
+    uint32_t    prev;
+    uint32_t    gap[PCODEC_BLOCK];
+    size_t      k;
+    int         keep_skip;      // armar la tabla de saltos
+    PcodecSkip *skip;
+    size_t      nskip, capskip;
+    int         err;
+} PcodecWriter;
+
+void pcodec_writer_begin(PcodecWriter *w, FILE *f);
+/* Igual, pero anotando cada bloque en w->skip (se libera con _free) */
+void pcodec_writer_begin_skip(PcodecWriter *w, FILE *f);
+/* Agrega valores (ascendentes) */
+int  pcodec_writer_add(PcodecWriter *w, const uint32_t *v, size_t n);
+/* Vuelca el último bloque; w->bytes = tamaño de la lista. 0 o -1. */
+int  pcodec_writer_end(PcodecWriter *w);
+void pcodec_writer_free(PcodecWriter *w);
@@ -0,0 +1,268 @@
+/* postings_ops.c
+   AND / OR de listas de filas ordenadas con kernels SIMD (AVX2, SSE4.1)
+   y versión escalar. Ver postings_ops.h.
+*/
+
+#include "postings_ops.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define POPS_SIMD 1
+#endif
+
+/* ---------- Tablas de compactación y CPU ---------- */
+static uint8_t  ops_shuf[16][16];     // pshufb: carriles marcados al frente
+static uint32_t ops_perm[256][8];     // vpermd: ídem con 8 carriles
+static int      ops_ready;            // 0 sin armar, si no 1 + kernel SIMD
+
+static int tables_init(void){
+    int st = __atomic_load_n(&ops_ready, __ATOMIC_ACQUIRE);
+    if (st) return st - 1;
+    for (int m=0; m<16; m++){
+        int p = 0;
+        memset(ops_shuf[m], 0x80, 16);
+        for (int l=0; l<4; l++)
+            if (m & (1 << l)){ for (int b=0; b<4; b++) ops_shuf[m][4*p+b] = (uint8_t)(4*l + b); p++; }
+    }
+    for (int m=0; m<256; m++){
+        int p = 0;
+        memset(ops_perm[m], 0, sizeof(ops_perm[m]));
+        for (int l=0; l<8; l++) if (m & (1 << l)) ops_perm[m][p++] = (uint32_t)l;
+    }
+    st = POPS_SCALAR;
+#ifdef POPS_SIMD
+    if (__builtin_cpu_supports("sse4.1")) st = POPS_SSE41;
+    if (__builtin_cpu_supports("avx2"))   st = POPS_AVX2;
+#endif
+    __atomic_store_n(&ops_ready, st + 1, __ATOMIC_RELEASE);
+    return st;
+}
+
+int pops_simd_kernel(void){
+    return tables_init();
+}
+
+/* ---------- Escalar ---------- */
+static size_t isect_scalar(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb){
+        if (a[i] == b[j]){ out[k++] = a[i]; i++; j++; }
+        else if (a[i] < b[j]) i++; else j++;
+    }
+    return k;
+}
+
+static size_t union_scalar(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb){
+        if (a[i] < b[j]) out[k++] = a[i++];
+        else if (b[j] < a[i]) out[k++] = b[j++];
+        else { out[k++] = a[i]; i++; j++; }
+    }
+    memcpy(out + k, a + i, (na - i) * sizeof(uint32_t)); k += na - i;
+    memcpy(out + k, b + j, (nb - j) * sizeof(uint32_t)); k += nb - j;
+    return k;
+}
+
+/* Primer j' >= j con v[j'] >= x (n si no hay) */
+static size_t gallop(const uint32_t *v, size_t n, size_t j, uint32_t x){
+    if (j >= n || v[j] >= x) return j;
+    size_t lo = j, step = 1;                        // v[lo] < x
+    while (lo + step < n && v[lo + step] < x){ lo += step; step <<= 1; }
+    size_t hi = lo + step < n ? lo + step : n;
+    while (hi - lo > 1){
+        size_t m = lo + (hi - lo) / 2;
+        if (v[m] < x) lo = m; else hi = m;
+    }
+    return hi;
+}
+
+/* a (chica) busca cada fila en b (grande) */
+static size_t isect_gallop(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    size_t j = 0, k = 0;
+    for (size_t i=0; i<na; i++){
+        j = gallop(b, nb, j, a[i]);
+        if (j == nb) break;
+        if (b[j] == a[i]){ out[k++] = a[i]; j++; }
+    }
+    return k;
+}
+
+/* Copia los tramos de b entre filas de a */
+static size_t union_gallop(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    size_t j = 0, k = 0;
+    for (size_t i=0; i<na; i++){
+        size_t p = gallop(b, nb, j, a[i]);
+        memcpy(out + k, b + j, (p - j) * sizeof(uint32_t)); k += p - j;
+        j = p;
+        out[k++] = a[i];
+        if (j < nb && b[j] == a[i]) j++;
+    }
+    memcpy(out + k, b + j, (nb - j) * sizeof(uint32_t));
+    return k + nb - j;
+}
+
+#ifdef POPS_SIMD
+/* ---------- SSE4.1 ---------- */
+/* Bloques de 4: cada carril de va contra los 4 de vb (3 rotaciones); el
+   bloque con el máximo menor avanza. El resto va por la versión escalar
+   (lo que ya coincidió queda antes de lo que falta comparar). */
+__attribute__((target("sse4.1")))
+static size_t isect_sse41(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    size_t i = 0, j = 0, k = 0;
+    size_t na4 = na & ~(size_t)3, nb4 = nb & ~(size_t)3;
+    if (na4 && nb4){
+        __m128i va = _mm_loadu_si128((const __m128i*)a), vb = _mm_loadu_si128((const __m128i*)b);
+        for (;;){
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),
+                _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4E)),
+                             _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+            _mm_storeu_si128((__m128i*)(out + k),
+                             _mm_shuffle_epi8(va, _mm_loadu_si128((const __m128i*)ops_shuf[mask])));
+            k += (size_t)__builtin_popcount((unsigned)mask);
+            uint32_t amax = a[i+3], bmax = b[j+3];
+            if (amax <= bmax) i += 4;
+            if (bmax <= amax) j += 4;
+            if (i == na4 || j == nb4) break;
+            if (amax <= bmax) va = _mm_loadu_si128((const __m128i*)(a + i));
+            if (bmax <= amax) vb = _mm_loadu_si128((const __m128i*)(b + j));
+        }
+    }
+    return k + isect_scalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+/* Red de mezcla: de a y b (4 ordenados cada uno) deja los 4 menores en
+   lo y los 4 mayores en hi, ambos ordenados */
+__attribute__((target("sse4.1")))
+static inline void merge4(__m128i a, __m128i b, __m128i *lo, __m128i *hi){
+    __m128i t = _mm_min_epu32(a, b), mx = _mm_max_epu32(a, b), mn;
+    for (int r=0; r<3; r++){
+        t  = _mm_alignr_epi8(t, t, 4);
+        mn = _mm_min_epu32(t, mx);
+        mx = _mm_max_epu32(t, mx);
+        t  = mn;
+    }
+    *lo = _mm_alignr_epi8(t, t, 4);
+    *hi = mx;
+}
+
+/* Guarda los carriles de v que no repiten al anterior (el último de old
+   para el primero); devuelve cuántos */
+__attribute__((target("sse4.1")))
+static inline size_t store_unique(__m128i old, __m128i v, uint32_t *out){
+    __m128i prev = _mm_alignr_epi8(v, old, 12);
+    int keep = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(prev, v))) & 15;
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i*)ops_shuf[keep])));
+    return (size_t)__builtin_popcount((unsigned)keep);
+}
+
+/* Se carga el bloque de la lista cuyo próximo valor es menor y se mezcla
+   con los 4 mayores pendientes: salen siempre los 4 menores, en orden */
+__attribute__((target("sse4.1")))
+static size_t union_sse41(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    size_t na4 = na & ~(size_t)3, nb4 = nb & ~(size_t)3;
+    if (!na4 || !nb4) return union_scalar(a, na, b, nb, out);
+    __m128i lo, hi, last = _mm_set1_epi32(-1);
+    merge4(_mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)b), &lo, &hi);
+    size_t i = 4, j = 4, k = store_unique(last, lo, out);
+    last = lo;
+    while (i < na4 && j < nb4){
+        __m128i v;
+        if (a[i] <= b[j]){ v = _mm_loadu_si128((const __m128i*)(a + i)); i += 4; }
+        else             { v = _mm_loadu_si128((const __m128i*)(b + j)); j += 4; }
+        merge4(v, hi, &lo, &hi);
+        k += store_unique(last, lo, out + k);
+        last = lo;
+    }
+    /* Pendientes + restos de a (y de b, si a terminó) en escalar */
+    uint32_t pend[4 + 4], tail[4 + 4 + 4 + POPS_SLACK];
+    size_t np = store_unique(last, hi, pend);
+    size_t nt;
+    if (i == na4) nt = union_scalar(pend, np, a + i, na - i, tail), i = na;
+    else          nt = union_scalar(pend, np, b + j, nb - j, tail), j = nb;
+    size_t n = i == na ? union_scalar(tail, nt, b + j, nb - j, out + k)
+                       : union_scalar(tail, nt, a + i, na - i, out + k);
+    /* Lo ya emitido es menor que todo lo que queda salvo un posible igual */
+    size_t drop = 0;
+    while (k && drop < n && out[k + drop] <= out[k-1]) drop++;
+    if (drop) memmove(out + k, out + k + drop, (n - drop) * sizeof(uint32_t));
+    return k + n - drop;
+}
+
+/* ---------- AVX2 ---------- */
+/* Como isect_sse41 con bloques de 8: 8 comparaciones (vb y sus 7
+   rotaciones con vpermd) y compactación con ops_perm */
+__attribute__((target("avx2")))
+static size_t isect_avx2(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    size_t i = 0, j = 0, k = 0;
+    size_t na8 = na & ~(size_t)7, nb8 = nb & ~(size_t)7;
+    if (na8 && nb8){
+        const __m256i rot = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        __m256i va = _mm256_loadu_si256((const __m256i*)a), vb = _mm256_loadu_si256((const __m256i*)b);
+        for (;;){
+            __m256i r = vb, m = _mm256_cmpeq_epi32(va, vb);
+            for (int s=1; s<8; s++){
+                r = _mm256_permutevar8x32_epi32(r, rot);
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, r));
+            }
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+            _mm256_storeu_si256((__m256i*)(out + k),
+                _mm256_permutevar8x32_epi32(va, _mm256_loadu_si256((const __m256i*)ops_perm[mask])));
+            k += (size_t)__builtin_popcount((unsigned)mask);
+            uint32_t amax = a[i+7], bmax = b[j+7];
+            if (amax <= bmax) i += 8;
+            if (bmax <= amax) j += 8;
+            if (i == na8 || j == nb8) break;
+            if (amax <= bmax) va = _mm256_loadu_si256((const __m256i*)(a + i));
+            if (bmax <= amax) vb = _mm256_loadu_si256((const __m256i*)(b + j));
+        }
+    }
+    return k + isect_scalar(a + i, na - i, b + j, nb - j, out + k);
+}
+#endif
+
+/* ---------- Selección ---------- */
+size_t pops_intersect_with(int kernel, const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    int best = tables_init();
+    if (kernel == POPS_GALLOP)
+        return na <= nb ? isect_gallop(a, na, b, nb, out) : isect_gallop(b, nb, a, na, out);
+#ifdef POPS_SIMD
+    if (kernel == POPS_AVX2 && best == POPS_AVX2) return isect_avx2(a, na, b, nb, out);
+    if (kernel >= POPS_SSE41 && best >= POPS_SSE41) return isect_sse41(a, na, b, nb, out);
+#else
+    (void)best;
+#endif
+    return isect_scalar(a, na, b, nb, out);
+}
+
+size_t pops_union_with(int kernel, const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    int best = tables_init();
+    if (kernel == POPS_GALLOP)
+        return na <= nb ? union_gallop(a, na, b, nb, out) : union_gallop(b, nb, a, na, out);
+#ifdef POPS_SIMD
+    if (kernel >= POPS_SSE41 && best >= POPS_SSE41) return union_sse41(a, na, b, nb, out);
+#else
+    (void)best;
+#endif
+    return union_scalar(a, na, b, nb, out);
+}
+
+size_t pops_intersect(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    if (na > nb){ const uint32_t *t = a; a = b; b = t; size_t n = na; na = nb; nb = n; }
+    if (na == 0) return 0;
+    int best = tables_init();
+    if (nb / na >= (best == POPS_AVX2 ? POPS_GALLOP_RATIO : POPS_GALLOP_RATIO / 2))
+        return isect_gallop(a, na, b, nb, out);
+    return pops_intersect_with(best, a, na, b, nb, out);
+}
+
+size_t pops_union(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out){
+    if (na > nb){ const uint32_t *t = a; a = b; b = t; size_t n = na; na = nb; nb = n; }
+    if (na == 0){ memcpy(out, b, nb * sizeof(uint32_t)); return nb; }
+    if (nb / na >= POPS_GALLOP_RATIO) return union_gallop(a, na, b, nb, out);
+    return pops_union_with(tables_init(), a, na, b, nb, out);
+}
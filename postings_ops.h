@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* ============================================================
+   AND / OR de listas de postings ya decodificadas (filas u32
+   ascendentes, sin repetidos).
+
+   Kernels, elegidos en tiempo de ejecución por CPU y por la relación
+   de tamaños entre las listas:
+     - galloping: la lista chica busca en la grande con pasos 1, 2, 4...
+       (si una es POPS_GALLOP_RATIO veces más larga que la otra; la mitad
+       sin AVX2, donde la mezcla rinde menos)
+     - AVX2: bloques de 8 x 8; se compara un bloque de a con las 8
+       rotaciones del de b (vpermd) y las coincidencias se compactan con
+       una tabla de 256 permutaciones (intersección "por shuffle" de
+       Schlegel et al., como la usa Lemire)
+     - SSE4.1: lo mismo con bloques de 4 x 4 y pshufb; la unión usa una
+       red de mezcla min/max de 4 + 4 y quita repetidos con una tabla de
+       16 máscaras
+     - escalar (sin SSE4.1)
+   Los kernels escriben vectores enteros: out necesita POPS_SLACK lugares
+   más que el resultado máximo y no puede solapar a ni b.
+   ============================================================ */
+
+#define POPS_SLACK        8
+#define POPS_GALLOP_RATIO 32
+
+enum { POPS_SCALAR, POPS_GALLOP, POPS_SSE41, POPS_AVX2 };
+
+/* a AND b; out con lugar para min(na, nb) + POPS_SLACK */
+size_t pops_intersect(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+/* a OR b; out con lugar para na + nb + POPS_SLACK */
+size_t pops_union(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+
+/* Con un kernel fijo (para bench_ops); si la CPU no lo tiene se usa el
+   escalar. La unión no tiene versión AVX2 (usa SSE4.1). */
+size_t pops_intersect_with(int kernel, const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+size_t pops_union_with(int kernel, const uint32_t *a, size_t na, const uint32_t *b, size_t nb, uint32_t *out);
+/* Mejor kernel SIMD disponible: POPS_AVX2, POPS_SSE41 o POPS_SCALAR */
+int    pops_simd_kernel(void);
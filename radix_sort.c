@@ -0,0 +1,148 @@
+/* radix_sort.c
+   Radix LSD para uint64_t, uint32_t y pares (hash, offset). Ver radix_sort.h.
+*/
+
+#include "radix_sort.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_SMALL 64          // por debajo: inserción
+
+/* ---------- Comparadores (respaldo con qsort) ---------- */
+static int cmp_u64(const void *a, const void *b){
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+static int cmp_u32(const void *a, const void *b){
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+static int cmp_pair(const void *a, const void *b){
+    const uint64_t *x = (const uint64_t*)a, *y = (const uint64_t*)b;
+    if (x[0] != y[0]) return x[0] < y[0] ? -1 : 1;
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+/* ---------- uint64_t ---------- */
+void radix_sort_u64(uint64_t *a, size_t n, uint64_t *scratch){
+    if (n < 2) return;
+    if (n < RADIX_SMALL){
+        for (size_t i=1; i<n; i++){
+            uint64_t v = a[i]; size_t j = i;
+            while (j > 0 && a[j-1] > v){ a[j] = a[j-1]; j--; }
+            a[j] = v;
+        }
+        return;
+    }
+    uint64_t *tmp = scratch ? scratch : (uint64_t*)malloc(n * sizeof(uint64_t));
+    if (!tmp){ qsort(a, n, sizeof(uint64_t), cmp_u64); return; }
+
+    size_t cnt[8][256];
+    memset(cnt, 0, sizeof(cnt));
+    for (size_t i=0; i<n; i++){
+        uint64_t v = a[i];
+        for (int d=0; d<8; d++) cnt[d][(v >> (8*d)) & 0xFF]++;
+    }
+
+    uint64_t *src = a, *dst = tmp;
+    for (int d=0; d<8; d++){
+        int sh = 8*d;
+        if (cnt[d][(src[0] >> sh) & 0xFF] == n) continue;   // dígito constante
+        size_t pos = 0;
+        for (int k=0; k<256; k++){ size_t c = cnt[d][k]; cnt[d][k] = pos; pos += c; }
+        for (size_t i=0; i<n; i++){
+            uint64_t v = src[i];
+            dst[cnt[d][(v >> sh) & 0xFF]++] = v;
+        }
+        uint64_t *t = src; src = dst; dst = t;
+    }
+    if (src != a) memcpy(a, src, n * sizeof(uint64_t));
+    if (!scratch) free(tmp);
+}
+
+/* ---------- uint32_t (números de fila) ---------- */
+void radix_sort_u32(uint32_t *a, size_t n, uint32_t *scratch){
+    if (n < 2) return;
+    if (n < RADIX_SMALL){
+        for (size_t i=1; i<n; i++){
+            uint32_t v = a[i]; size_t j = i;
+            while (j > 0 && a[j-1] > v){ a[j] = a[j-1]; j--; }
+            a[j] = v;
+        }
+        return;
+    }
+    uint32_t *tmp = scratch ? scratch : (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!tmp){ qsort(a, n, sizeof(uint32_t), cmp_u32); return; }
+
+    size_t cnt[4][256];
+    memset(cnt, 0, sizeof(cnt));
+    for (size_t i=0; i<n; i++){
+        uint32_t v = a[i];
+        for (int d=0; d<4; d++) cnt[d][(v >> (8*d)) & 0xFF]++;
+    }
+
+    uint32_t *src = a, *dst = tmp;
+    for (int d=0; d<4; d++){
+        int sh = 8*d;
+        if (cnt[d][(src[0] >> sh) & 0xFF] == n) continue;   // dígito constante
+        size_t pos = 0;
+        for (int k=0; k<256; k++){ size_t c = cnt[d][k]; cnt[d][k] = pos; pos += c; }
+        for (size_t i=0; i<n; i++){
+            uint32_t v = src[i];
+            dst[cnt[d][(v >> sh) & 0xFF]++] = v;
+        }
+        uint32_t *t = src; src = dst; dst = t;
+    }
+    if (src != a) memcpy(a, src, n * sizeof(uint32_t));
+    if (!scratch) free(tmp);
+}
+
+/* ---------- Pares (h, off) ---------- */
+void radix_sort_pairs(uint64_t *a, size_t n, uint64_t *scratch){
+    if (n < 2) return;
+    if (n < RADIX_SMALL){
+        for (size_t i=1; i<n; i++){
+            uint64_t h = a[2*i], o = a[2*i+1]; size_t j = i;
+            while (j > 0 && (a[2*(j-1)] > h || (a[2*(j-1)] == h && a[2*(j-1)+1] > o))){
+                a[2*j] = a[2*(j-1)]; a[2*j+1] = a[2*(j-1)+1]; j--;
+            }
+            a[2*j] = h; a[2*j+1] = o;
+        }
+        return;
+    }
+    uint64_t *tmp = scratch ? scratch : (uint64_t*)malloc(n * 2 * sizeof(uint64_t));
+    if (!tmp){ qsort(a, n, 2 * sizeof(uint64_t), cmp_pair); return; }
+
+    size_t (*cnt)[256] = (size_t(*)[256])calloc(16, sizeof(*cnt));
+    if (!cnt){
+        if (!scratch) free(tmp);
+        qsort(a, n, 2 * sizeof(uint64_t), cmp_pair);
+        return;
+    }
+    for (size_t i=0; i<n; i++){
+        uint64_t h = a[2*i], o = a[2*i+1];
+        for (int d=0; d<8; d++){
+            cnt[d][(o >> (8*d)) & 0xFF]++;
+            cnt[8+d][(h >> (8*d)) & 0xFF]++;
+        }
+    }
+
+    uint64_t *src = a, *dst = tmp;
+    /* Dígito d de la clave de 128 bits: 0..7 = bytes de off, 8..15 = bytes de h */
+    for (int d=0; d<16; d++){
+        int w = d < 8 ? 1 : 0, sh = 8 * (d & 7);
+        if (cnt[d][(src[w] >> sh) & 0xFF] == n) continue;    // dígito constante
+        size_t pos = 0;
+        for (int k=0; k<256; k++){ size_t c = cnt[d][k]; cnt[d][k] = pos; pos += c; }
+        for (size_t i=0; i<n; i++){
+            const uint64_t *p = src + 2*i;
+            uint64_t *q = dst + 2*cnt[d][(p[w] >> sh) & 0xFF]++;
+            q[0] = p[0]; q[1] = p[1];
+        }
+        uint64_t *t = src; src = dst; dst = t;
+    }
+    if (src != a) memcpy(a, src, n * 2 * sizeof(uint64_t));
+    free(cnt);
+    if (!scratch) free(tmp);
+}
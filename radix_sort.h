@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* Ordenamiento radix LSD (dígitos de 8 bits, estable) para la construcción
+   y fusión de postings. Un solo recorrido arma los histogramas de todos
+   los dígitos; los dígitos que son iguales en todas las claves (bytes
+   altos de offsets, byte de bucket del hash) no generan pasada.
+
+   scratch es opcional: n elementos del mismo tipo (2n uint64_t en pares).
+   Si es NULL se reserva y libera adentro; si no hay memoria cae a qsort. */
+
+/* Ascendente */
+void radix_sort_u64(uint64_t *a, size_t n, uint64_t *scratch);
+void radix_sort_u32(uint32_t *a, size_t n, uint32_t *scratch);
+
+/* Pares {h, off} contiguos (a[2i] = h, a[2i+1] = off), por (h, off)
+   ascendente: el mismo orden que cmp_pair */
+void radix_sort_pairs(uint64_t *a, size_t n, uint64_t *scratch);
@@ -0,0 +1,326 @@
+/* roaring.c
+   Postings como contenedores estilo Roaring (arreglo, bitmap, run):
+   escritura por partes, lectura sobre el mapeo y kernels AND.
+   Ver roaring.h.
+*/
+
+#include "roaring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- Escritura ---------- */
+static int put(RoarWriter *w, const void *p, size_t len){
+    if (w->f && fwrite(p, 1, len, w->f) != len){ w->err = 1; return -1; }
+    w->bytes += len;
+    return 0;
+}
+
+static int pad8(RoarWriter *w){
+    static const uint8_t zero[8];
+    return put(w, zero, (size_t)((8 - w->bytes % 8) % 8));
+}
+
+int roar_writer_begin(RoarWriter *w, FILE *f){
+    memset(w, 0, sizeof(*w));
+    w->f = f;
+    w->cur = (uint16_t*)malloc(65536 * sizeof(uint16_t));
+    return w->cur ? 0 : -1;
+}
+
+void roar_writer_free(RoarWriter *w){
+    free(w->cur); free(w->dir);
+    w->cur = NULL; w->dir = NULL;
+}
+
+/* Cierra el contenedor en curso con el tipo que ocupe menos */
+static int flush_container(RoarWriter *w){
+    if (!w->open) return 0;
+    w->open = 0;
+    const uint16_t *c = w->cur;
+    size_t card = w->ncur, runs = 0;
+    for (size_t i=0; i<card; i++) if (i == 0 || c[i] != c[i-1] + 1) runs++;
+
+    if (w->ndir == w->capdir){
+        size_t cap = w->capdir ? w->capdir * 2 : 16;
+        RoarDirEntry *d = (RoarDirEntry*)realloc(w->dir, cap * sizeof(RoarDirEntry));
+        if (!d){ w->err = 1; return -1; }
+        w->dir = d; w->capdir = cap;
+    }
+    if (w->bytes > UINT32_MAX){ w->err = 1; return -1; }
+    RoarDirEntry *e = &w->dir[w->ndir++];
+    memset(e, 0, sizeof(*e));
+    e->key  = (uint16_t)w->key;
+    e->card = (uint32_t)card;
+    e->off  = (uint32_t)w->bytes;
+
+    size_t sa = 2 * card, sr = 4 * runs, sb = ROAR_BITMAP_WORDS * 8;
+    if (sr < sa && sr < sb){
+        uint16_t rb[512];
+        size_t k = 0;
+        e->type = ROAR_RUN; e->n = (uint32_t)runs;
+        for (size_t i=0; i<card; ){
+            size_t j = i + 1;
+            while (j < card && c[j] == c[j-1] + 1) j++;
+            rb[k++] = c[i]; rb[k++] = (uint16_t)(j - i - 1);
+            if (k == 512){ if (put(w, rb, sizeof(rb)) != 0) return -1; k = 0; }
+            i = j;
+        }
+        if (k && put(w, rb, k * sizeof(uint16_t)) != 0) return -1;
+    } else if (sa <= sb){
+        e->type = ROAR_ARRAY; e->n = (uint32_t)card;
+        if (put(w, c, sa) != 0) return -1;
+    } else {
+        uint64_t bm[ROAR_BITMAP_WORDS];
+        memset(bm, 0, sizeof(bm));
+        for (size_t i=0; i<card; i++) bm[c[i] >> 6] |= 1ULL << (c[i] & 63);
+        e->type = ROAR_BITMAP; e->n = ROAR_BITMAP_WORDS;
+        if (put(w, bm, sizeof(bm)) != 0) return -1;
+    }
+    w->ncur = 0;
+    return pad8(w);
+}
+
+int roar_writer_add(RoarWriter *w, const uint32_t *v, size_t n){
+    for (size_t i=0; i<n; i++){
+        uint32_t key = v[i] >> 16;
+        if (w->open && key != w->key && flush_container(w) != 0) return -1;
+        if (!w->open){ w->open = 1; w->key = key; w->ncur = 0; }
+        w->cur[w->ncur++] = (uint16_t)v[i];
+    }
+    return w->err ? -1 : 0;
+}
+
+int roar_writer_end(RoarWriter *w){
+    if (flush_container(w) != 0) return -1;
+    uint32_t tr[2] = { (uint32_t)w->ndir, 0 };
+    if (w->ndir && put(w, w->dir, w->ndir * sizeof(RoarDirEntry)) != 0) return -1;
+    if (put(w, tr, sizeof(tr)) != 0) return -1;
+    return w->err ? -1 : 0;
+}
+
+/* ---------- Lectura ---------- */
+int roar_view_open(RoarView *rv, const uint8_t *p, size_t len){
+    memset(rv, 0, sizeof(*rv));
+    if (len < 8 || len % 8 != 0 || ((uintptr_t)p & 7)) return -1;
+    uint32_t nc;
+    memcpy(&nc, p + len - 8, 4);
+    if ((uint64_t)nc * sizeof(RoarDirEntry) > len - 8) return -1;
+    size_t data_end = len - 8 - (size_t)nc * sizeof(RoarDirEntry);
+    const RoarDirEntry *d = (const RoarDirEntry*)(p + data_end);
+    uint64_t card = 0;
+    for (uint32_t i=0; i<nc; i++){
+        const RoarDirEntry *e = &d[i];
+        uint64_t size;
+        if (i && e->key <= d[i-1].key) return -1;
+        if (e->card == 0 || e->card > 65536 || e->off % 8 != 0) return -1;
+        switch (e->type){
+            case ROAR_ARRAY:  if (e->n != e->card) return -1; size = 2ULL * e->n; break;
+            case ROAR_BITMAP: if (e->n != ROAR_BITMAP_WORDS) return -1; size = 8ULL * e->n; break;
+            case ROAR_RUN:    if (e->n == 0 || e->n > e->card) return -1; size = 4ULL * e->n; break;
+            default: return -1;
+        }
+        if (e->off > data_end || size > data_end - e->off) return -1;
+        card += e->card;
+    }
+    rv->base  = p;
+    rv->dir   = d;
+    rv->ncont = nc;
+    rv->card  = card;
+    return 0;
+}
+
+static inline const uint16_t *c_u16(const RoarView *rv, const RoarDirEntry *e){
+    return (const uint16_t*)(rv->base + e->off);
+}
+static inline const uint64_t *c_u64(const RoarView *rv, const RoarDirEntry *e){
+    return (const uint64_t*)(rv->base + e->off);
+}
+
+/* Marca [lo, hi] en un bitmap de 1024 palabras */
+static void set_range(uint64_t *bm, uint32_t lo, uint32_t hi){
+    uint32_t wl = lo >> 6, wh = hi >> 6;
+    uint64_t ml = ~0ULL << (lo & 63), mh = ~0ULL >> (63 - (hi & 63));
+    if (wl == wh){ bm[wl] |= ml & mh; return; }
+    bm[wl] |= ml;
+    for (uint32_t k=wl+1; k<wh; k++) bm[k] = ~0ULL;
+    bm[wh] |= mh;
+}
+
+/* Contenedor como bitmap: el propio si lo es, si no expandido en tmp */
+static const uint64_t *as_bitmap(const RoarView *rv, const RoarDirEntry *e, uint64_t *tmp){
+    if (e->type == ROAR_BITMAP) return c_u64(rv, e);
+    memset(tmp, 0, ROAR_BITMAP_WORDS * 8);
+    const uint16_t *c = c_u16(rv, e);
+    if (e->type == ROAR_RUN){
+        for (uint32_t i=0; i<e->n; i++) set_range(tmp, c[2*i], (uint32_t)c[2*i] + c[2*i+1]);
+    } else {
+        for (uint32_t i=0; i<e->n; i++) tmp[c[i] >> 6] |= 1ULL << (c[i] & 63);
+    }
+    return tmp;
+}
+
+static size_t bitmap_out(const uint64_t *bm, uint32_t hi, uint32_t *out){
+    size_t k = 0;
+    for (uint32_t w=0; w<ROAR_BITMAP_WORDS; w++){
+        uint64_t x = bm[w];
+        while (x){
+            out[k++] = hi | (w << 6) | (uint32_t)__builtin_ctzll(x);
+            x &= x - 1;
+        }
+    }
+    return k;
+}
+
+size_t roar_to_array(const RoarView *rv, uint32_t *out){
+    size_t k = 0;
+    for (uint32_t i=0; i<rv->ncont; i++){
+        const RoarDirEntry *e = &rv->dir[i];
+        uint32_t hi = (uint32_t)e->key << 16;
+        const uint16_t *c = c_u16(rv, e);
+        if (e->type == ROAR_ARRAY){
+            for (uint32_t j=0; j<e->n; j++) out[k++] = hi | c[j];
+        } else if (e->type == ROAR_RUN){
+            for (uint32_t j=0; j<e->n; j++)
+                for (uint32_t v=c[2*j], z=(uint32_t)c[2*j] + c[2*j+1]; v<=z; v++) out[k++] = hi | v;
+        } else {
+            k += bitmap_out(c_u64(rv, e), hi, out + k);
+        }
+    }
+    return k;
+}
+
+int roar_prev(const RoarView *rv, uint32_t x, uint32_t *out){
+    uint16_t key = (uint16_t)(x >> 16);
+    uint32_t lo = 0, hi = rv->ncont;                 // dir[0..lo): clave <= key
+    while (lo < hi){
+        uint32_t m = lo + (hi - lo) / 2;
+        if (rv->dir[m].key <= key) lo = m + 1; else hi = m;
+    }
+    while (lo > 0){
+        const RoarDirEntry *e = &rv->dir[--lo];
+        uint32_t base = (uint32_t)e->key << 16;
+        uint32_t lim = e->key == key ? (x & 0xFFFF) : 0xFFFF;
+        const uint16_t *c = c_u16(rv, e);
+        if (e->type == ROAR_ARRAY){
+            uint32_t l = 0, h = e->n;                // c[0..l) <= lim
+            while (l < h){ uint32_t m = l + (h - l) / 2; if (c[m] <= lim) l = m + 1; else h = m; }
+            if (l){ *out = base | c[l-1]; return 1; }
+        } else if (e->type == ROAR_RUN){
+            uint32_t l = 0, h = e->n;                // tramos que empiezan <= lim
+            while (l < h){ uint32_t m = l + (h - l) / 2; if (c[2*m] <= lim) l = m + 1; else h = m; }
+            if (l){
+                uint32_t z = (uint32_t)c[2*(l-1)] + c[2*(l-1)+1];
+                *out = base | (z < lim ? z : lim);
+                return 1;
+            }
+        } else {
+            const uint64_t *bm = c_u64(rv, e);
+            uint32_t w = lim >> 6;
+            uint64_t m = bm[w] & (~0ULL >> (63 - (lim & 63)));
+            for (;;){
+                if (m){ *out = base | (w << 6) | (63u - (uint32_t)__builtin_clzll(m)); return 1; }
+                if (w == 0) break;
+                m = bm[--w];
+            }
+        }
+    }
+    return 0;
+}
+
+/* ---------- AND ---------- */
+static size_t and_containers(const RoarView *a, const RoarDirEntry *x,
+                             const RoarView *b, const RoarDirEntry *y, uint32_t *out){
+    uint32_t hi = (uint32_t)x->key << 16;
+    size_t k = 0;
+    if (x->type == ROAR_ARRAY && y->type == ROAR_ARRAY){        // mezcla
+        const uint16_t *p = c_u16(a, x), *q = c_u16(b, y);
+        uint32_t i = 0, j = 0;
+        while (i < x->n && j < y->n){
+            if (p[i] == q[j]){ out[k++] = hi | p[i]; i++; j++; }
+            else if (p[i] < q[j]) i++; else j++;
+        }
+        return k;
+    }
+    uint64_t t1[ROAR_BITMAP_WORDS], t2[ROAR_BITMAP_WORDS];
+    if (x->type == ROAR_ARRAY || y->type == ROAR_ARRAY){          // probar bits
+        const RoarView *av = x->type == ROAR_ARRAY ? a : b, *bv = x->type == ROAR_ARRAY ? b : a;
+        const RoarDirEntry *ae = x->type == ROAR_ARRAY ? x : y, *be = x->type == ROAR_ARRAY ? y : x;
+        const uint16_t *p = c_u16(av, ae);
+        const uint64_t *bm = as_bitmap(bv, be, t1);
+        for (uint32_t i=0; i<ae->n; i++)
+            if (bm[p[i] >> 6] >> (p[i] & 63) & 1) out[k++] = hi | p[i];
+        return k;
+    }
+    const uint64_t *p = as_bitmap(a, x, t1), *q = as_bitmap(b, y, t2);
+    for (uint32_t w=0; w<ROAR_BITMAP_WORDS; w++){                  // palabra por palabra
+        uint64_t z = p[w] & q[w];
+        while (z){
+            out[k++] = hi | (w << 6) | (uint32_t)__builtin_ctzll(z);
+            z &= z - 1;
+        }
+    }
+    return k;
+}
+
+size_t roar_and(const RoarView *a, const RoarView *b, uint32_t *out){
+    uint32_t i = 0, j = 0;
+    size_t k = 0;
+    while (i < a->ncont && j < b->ncont){
+        uint16_t ka = a->dir[i].key, kb = b->dir[j].key;
+        if (ka == kb){ k += and_containers(a, &a->dir[i], b, &b->dir[j], out + k); i++; j++; }
+        else if (ka < kb) i++; else j++;
+    }
+    return k;
+}
+
+/* Primer índice >= i de c[0..n) con c[idx] >= x (búsqueda exponencial) */
+static uint32_t gallop_u16(const uint16_t *c, uint32_t n, uint32_t i, uint16_t x){
+    uint32_t step = 1, lo = i, hi = i;
+    while (hi < n && c[hi] < x){ lo = hi + 1; hi += step; step <<= 1; }
+    if (hi > n) hi = n;
+    while (lo < hi){
+        uint32_t m = lo + (hi - lo) / 2;
+        if (c[m] < x) lo = m + 1; else hi = m;
+    }
+    return lo;
+}
+
+size_t roar_and_array(const RoarView *a, const uint32_t *v, size_t n, uint32_t *out){
+    size_t i = 0, k = 0;
+    uint32_t c = 0;
+    while (i < n && c < a->ncont){
+        uint32_t key = v[i] >> 16;
+        while (c < a->ncont && a->dir[c].key < key) c++;
+        if (c == a->ncont) break;
+        size_t end = i;
+        while (end < n && (v[end] >> 16) == key) end++;
+        const RoarDirEntry *e = &a->dir[c];
+        if (e->key == key){
+            const uint16_t *p = c_u16(a, e);
+            if (e->type == ROAR_BITMAP){
+                const uint64_t *bm = c_u64(a, e);
+                for (size_t t=i; t<end; t++){
+                    uint16_t lo = (uint16_t)v[t];
+                    if (bm[lo >> 6] >> (lo & 63) & 1) out[k++] = v[t];
+                }
+            } else if (e->type == ROAR_ARRAY){
+                uint32_t j = 0;
+                for (size_t t=i; t<end && j<e->n; t++){
+                    uint16_t lo = (uint16_t)v[t];
+                    j = gallop_u16(p, e->n, j, lo);
+                    if (j < e->n && p[j] == lo) out[k++] = v[t];
+                }
+            } else {
+                uint32_t j = 0;
+                for (size_t t=i; t<end && j<e->n; t++){
+                    uint16_t lo = (uint16_t)v[t];
+                    while (j < e->n && (uint32_t)p[2*j] + p[2*j+1] < lo) j++;
+                    if (j < e->n && p[2*j] <= lo) out[k++] = v[t];
+                }
+            }
+        }
+        i = end;
+    }
+    return k;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* ============================================================
+   Listas de postings como bitmaps estilo Roaring (filas u32).
+   Las filas se agrupan por sus 16 bits altos (clave); cada grupo es un
+   contenedor de uno de tres tipos, el que ocupe menos:
+
+     ROAR_ARRAY  card u16 ordenados (2 B por fila)
+     ROAR_BITMAP 1024 u64 = 65536 bits (8 KB fijos)
+     ROAR_RUN    tramos {inicio u16, largo-1 u16} de filas consecutivas
+
+   Serializado (empieza y termina alineado a 8):
+
+     [contenedores, cada uno alineado a 8] [RoarDirEntry[ncont]] [ncont u32][0 u32]
+
+   El directorio va al final para poder escribir la lista de corrido; se
+   lee desde el final de la lista (que el que llama conoce). Los AND se
+   hacen contenedor por contenedor sin decodificar la lista entera:
+   bitmap AND bitmap palabra por palabra, bitmap AND arreglo probando
+   bits, arreglo AND arreglo por mezcla; los runs se expanden a bitmap.
+   ============================================================ */
+
+#define ROAR_ARRAY  1
+#define ROAR_BITMAP 2
+#define ROAR_RUN    3
+
+#define ROAR_BITMAP_WORDS 1024
+
+typedef struct {
+    uint16_t key;           // 16 bits altos de las filas
+    uint8_t  type;          // ROAR_*
+    uint8_t  pad;
+    uint32_t card;          // filas en el contenedor (1..65536)
+    uint32_t off;           // desde el inicio de la lista
+    uint32_t n;             // elementos: card (arreglo), 1024 (bitmap), tramos (run)
+} RoarDirEntry;
+
+/* ---- Escritura por partes (valores ascendentes, sin repetidos) ----
+   Con f = NULL solo cuenta los bytes (para decidir el formato). */
+typedef struct {
+    FILE         *f;
+    uint64_t      bytes;
+    uint32_t      key;
+    int           open;
+    uint16_t     *cur;      // filas del contenedor en curso (16 bits bajos)
+    size_t        ncur;
+    RoarDirEntry *dir;
+    size_t        ndir, capdir;
+    int           err;
+} RoarWriter;
+
+int  roar_writer_begin(RoarWriter *w, FILE *f);
+int  roar_writer_add(RoarWriter *w, const uint32_t *v, size_t n);
+/* Cierra el último contenedor y escribe el directorio; w->bytes = tamaño */
+int  roar_writer_end(RoarWriter *w);
+void roar_writer_free(RoarWriter *w);
+
+/* ---- Lectura sobre la lista serializada (mapeada, alineada a 8) ---- */
+typedef struct {
+    const uint8_t      *base;
+    const RoarDirEntry *dir;
+    uint32_t            ncont;
+    uint64_t            card;
+} RoarView;
+
+/* Valida la lista [p, p+len); 0 o -1 */
+int    roar_view_open(RoarView *rv, const uint8_t *p, size_t len);
+/* Todas las filas, ascendentes; out con lugar para rv->card */
+size_t roar_to_array(const RoarView *rv, uint32_t *out);
+/* Mayor fila <= x en *out; 0 si no hay ninguna */
+int    roar_prev(const RoarView *rv, uint32_t x, uint32_t *out);
+/* a AND b; out con lugar para min(a->card, b->card) */
+size_t roar_and(const RoarView *a, const RoarView *b, uint32_t *out);
+/* a AND v[0..n) (ascendente); out con lugar para n (puede ser v) */
+size_t roar_and_array(const RoarView *a, const uint32_t *v, size_t n, uint32_t *out);
@@ -1,5 +1,6 @@
 // search_name.c
-// Consulta el índice "nameidx" (track_name + artist) por 1–3 palabras (AND)
+// Consulta el índice "nameidx" (track_name + artist) por palabras: AND de
+// todas, con OR, NOT / -palabra y paréntesis como en el menú (name_query.h)
 #define _POSIX_C_SOURCE 200809L
 #ifndef _FILE_OFFSET_BITS
 #define _FILE_OFFSET_BITS 64
@@ -13,6 +14,9 @@
 #include <errno.h>
 #include <ctype.h>
 
+#include "nameidx_dir.h"
+#include "name_query.h"
+
 #define NBKT 256
 #define MAX_SHOW 20
 
@@ -79,80 +83,58 @@ static uint64_t fnv1a64(const char *s){
     return h;
 }
 
-/* ---- cargar postings de un token ---- */
-static uint64_t *load_postings(const char *dir, uint64_t h, size_t *out_n){
-    int b=(int)(h & (NBKT-1));
-    char path[512]; snprintf(path,sizeof(path),"%s/b%02x.idx",dir,b);
-    FILE *f=fopen(path,"rb"); if(!f){ *out_n=0; return NULL; }
-    for(;;){
-        uint64_t hh; uint32_t df, pad;
-        if (fread(&hh,8,1,f)!=1) break;
-        if (fread(&df,4,1,f)!=1) break;
-        if (fread(&pad,4,1,f)!=1) break;
-        if (hh==h){
-            uint64_t *arr=malloc((size_t)df*sizeof(uint64_t));
-            if (!arr){ fclose(f); *out_n=0; return NULL; }
-            if (fread(arr,8,df,f)!=(size_t)df){ free(arr); fclose(f); *out_n=0; return NULL; }
-            fclose(f); *out_n=df; return arr;
-        } else {
-            if (fseeko(f, (off_t)df*8, SEEK_CUR)!=0) break;
-        }
+/* ---- términos de la consulta: solo names.seg (sin delta) ---- */
+static size_t word_terms(void *ctx, const char *word, uint64_t *h, size_t max){
+    (void)ctx;
+    char *norm=normalize_utf8_basic(word);
+    char **toks=NULL; size_t ntok=tokenize_unique(norm,&toks);
+    free(norm);
+    for(size_t k=0;k<ntok;k++){             /* todos los tokens de la palabra */
+        if (k<max) h[k]=fnv1a64(toks[k]);
+        free(toks[k]);
     }
-    fclose(f); *out_n=0; return NULL;
+    free(toks);
+    return ntok;
 }
 
-/* ---- intersección AND de dos listas ordenadas ---- */
-static uint64_t *intersect(const uint64_t *a,size_t na,const uint64_t *b,size_t nb,size_t *nc){
-    size_t i=0,j=0; size_t cap=(na<nb?na:nb), n=0;
-    uint64_t *c=malloc(cap?cap:1*sizeof(uint64_t));
-    while(i<na && j<nb){
-        if (a[i]==b[j]){ c[n++]=a[i]; i++; j++; }
-        else if (a[i]<b[j]) i++; else j++;
-    }
-    *nc=n; return c;
+static void word_postings(void *ctx, uint64_t h, NamePostings *p){
+    nameidx_postings((NameIdxReader*)ctx, h, p);
 }
 
 int main(int argc, char **argv){
     if (argc < 4){
-        fprintf(stderr,"Uso: %s <dataset.csv> <dir_idx> <pal1> [pal2] [pal3]\n", argv[0]);
+        fprintf(stderr,"Uso: %s <dataset.csv> <dir_idx> <consulta...>\n"
+                       "  ej.: %s data.csv nameidx feid \"tusa OR ferxxo\" -remix\n", argv[0], argv[0]);
         return 1;
     }
     const char *csv=argv[1], *dir=argv[2];
-
-    /* normalizar/ tokenizar argumentos de consulta */
-    char **qargv=&argv[3]; int qn=argc-3; if(qn>3) qn=3;
-
-    uint64_t *post=NULL; size_t pn=0;
-    for(int qi=0; qi<qn; ++qi){
-        char *norm=normalize_utf8_basic(qargv[qi]);
-        char **toks=NULL; size_t ntok=tokenize_unique(norm,&toks);
-        free(norm);
-        if (ntok==0){ free(toks); continue; }
-
-        /* Usamos el primer token del argumento */
-        uint64_t h = fnv1a64(toks[0]);
-        for(size_t k=0;k<ntok;k++){ free(toks[k]); }
-        free(toks);
-
-        size_t tn=0; uint64_t *tp=load_postings(dir,h,&tn);
-        if (qi==0){ post=tp; pn=tn; }
-        else {
-            size_t cn=0; uint64_t *cp=intersect(post,pn,tp,tn,&cn);
-            free(post); free(tp); post=cp; pn=cn;
-        }
-        if (pn==0) break;
-    }
-
-    if (pn==0 || !post){ printf("NOT_FOUND\n"); return 0; }
-
-    /* abrir CSV y devolver hasta MAX_SHOW líneas */
+    NameIdxReader names;
+    nameidx_reader_init(&names, dir);
+
+    /* los argumentos forman una sola consulta */
+    char text[1600]=""; size_t L=0;
+    for(int qi=3; qi<argc && L<sizeof(text); ++qi)
+        L += (size_t)snprintf(text+L, sizeof(text)-L, "%s%s", qi>3?" ":"", argv[qi]);
+    NameQuerySource src = { &names, word_terms, word_postings };
+    char err[128];
+    NameQuery *q = name_query_parse(text, &src, err, sizeof(err));
+    if (!q){ fprintf(stderr,"Consulta inválida: %s\n", err); nameidx_reader_close(&names); return 1; }
+
+    /* las MAX_SHOW filas más recientes, ya en orden (evaluación desde el final) */
+    uint32_t post[MAX_SHOW];
+    size_t pn=name_query_last(q,UINT32_MAX,MAX_SHOW,post);
+    name_query_free(q);
+
+    if (pn==0){ printf("NOT_FOUND\n"); nameidx_reader_close(&names); return 0; }
+
+    /* abrir CSV y devolver las filas */
     FILE *fp=fopen(csv,"r");
-    if (!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); free(post); return 1; }
-    setvbuf(fp,NULL,_IOFBF,4*1024*1024);
+    if (!fp){ fprintf(stderr,"CSV: %s\n", strerror(errno)); nameidx_reader_close(&names); return 1; }
 
     size_t shown=0;
-    for(size_t i=0;i<pn && shown<MAX_SHOW;i++){
-        if (fseeko(fp,(off_t)post[i],SEEK_SET)!=0) continue;
+    for(size_t i=0;i<pn;i++){
+        uint64_t off;
+        if (nameidx_row_offset(&names,post[i],&off)!=0 || fseeko(fp,(off_t)off,SEEK_SET)!=0) continue;
         char *line=NULL; size_t cap=0; ssize_t len=getline(&line,&cap,fp);
         if (len>0){ fwrite(line,1,(size_t)len,stdout); shown++; }
         free(line);
@@ -160,6 +142,6 @@ int main(int argc, char **argv){
     if (shown==0) printf("NOT_FOUND\n");
 
     fclose(fp);
-    free(post);
+    nameidx_reader_close(&names);
     return 0;
 }
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -11,7 +12,11 @@ static void usage(const char *prog){
     fprintf(stderr,
       "Uso:\n"
       "  %s <host> <port> ADD <track_id> <name> <artist> <album> <duration_ms>\n"
-      "  %s <host> <port> SEARCH <palabra1> [<palabra2>] [<palabra3>]\n", prog, prog);
+      "  %s <host> <port> SEARCH <consulta...> [DATE=d] [REGION=r] [LIMIT=n] [CURSOR=c]\n"
+      "  (hasta 32 términos, AND entre ellos; OR, NOT o -palabra y paréntesis:\n"
+      "   %s 127.0.0.1 5555 SEARCH feid \"(tusa OR ferxxo)\" NOT remix)\n"
+      "  (si la respuesta trae NEXT <c>, CURSOR=<c> pide la página siguiente)\n"
+      "  %s <host> <port> TOP <region|*> <desde AAAA-MM-DD> <hasta AAAA-MM-DD> [n]\n", prog, prog, prog, prog);
 }
 
 int main(int argc, char **argv) {
@@ -34,11 +39,18 @@ int main(int argc, char **argv) {
         snprintf(line, sizeof line, "ADD|%s|%s|%s|%s|%s\n",
                  argv[4], argv[5], argv[6], argv[7], argv[8]);
     } else if (!strcasecmp(cmd, "SEARCH")) {
-        // SEARCH|w1[|w2][|w3]
+        // SEARCH|consulta[|...][|DATE=d][|REGION=r][|LIMIT=n][|CURSOR=c]; los campos
+        // de la consulta se unen con espacios (hasta 32 términos, OR, NOT, -palabra, paréntesis)
         snprintf(line, sizeof line, "SEARCH|%s", argv[4]);
-        if (argc > 5) { strncat(line, "|", sizeof line - strlen(line) - 1); strncat(line, argv[5], sizeof line - strlen(line) - 1); }
-        if (argc > 6) { strncat(line, "|", sizeof line - strlen(line) - 1); strncat(line, argv[6], sizeof line - strlen(line) - 1); }
+        for (int i = 5; i < argc; i++) {
+            strncat(line, "|", sizeof line - strlen(line) - 1);
+            strncat(line, argv[i], sizeof line - strlen(line) - 1);
+        }
         strncat(line, "\n", sizeof line - strlen(line) - 1);
+    } else if (!strcasecmp(cmd, "TOP")) {
+        // TOP|region|desde|hasta|n (n = 20 si no se da)
+        if (argc < 7) { usage(argv[0]); close(fd); return 1; }
+        snprintf(line, sizeof line, "TOP|%s|%s|%s|%s\n", argv[4], argv[5], argv[6], argc > 7 ? argv[7] : "20");
     } else {
         usage(argv[0]); close(fd); return 1;
     }
@@ -50,7 +62,7 @@ int main(int argc, char **argv) {
     while ((n = recv(fd, buf, sizeof buf - 1, 0)) > 0) {
         buf[n] = '\0';
         fputs(buf, stdout);
-        // parar cuando llegue END (en SEARCH)
+        // parar cuando llegue END (en SEARCH y TOP)
         if (strstr(buf, "\nEND\n")) break;
     }
 
@@ -0,0 +1,927 @@
+/* track_idx.c
+   Acceso al índice tracks.idx (IDX1TRK / IDX2TRK / IDX3SWT / IDX4MPH): apertura por mmap,
+   búsqueda, construcción y alta incremental. Ver track_idx.h.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "track_idx.h"
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* ============================================================
+   Hash y empaquetado de claves
+   ============================================================ */
+uint64_t trk_hash(const char *s){
+    const uint64_t OFF=1469598103934665603ULL, PR=1099511628211ULL;
+    uint64_t h=OFF;
+    for (const unsigned char *p=(const unsigned char*)s; *p; ++p){
+        h ^= (uint64_t)(*p);
+        h *= PR;
+    }
+    if (h==0) h=1; /* reservamos 0 como “vacío” en slots */
+    return h;
+}
+
+static int b62_digit(unsigned char c){
+    if (c>='0' && c<='9') return c-'0';
+    if (c>='a' && c<='z') return c-'a'+10;
+    if (c>='A' && c<='Z') return c-'A'+36;
+    return -1;
+}
+
+uint64_t trk_pack_key(const char *id, uint8_t out[16]){
+    size_t L = strlen(id);
+    memset(out, 0, 16);
+    if (L == 22){
+        /* base62 -> entero de 128 bits (lo, hi) con control de desborde */
+        uint64_t lo=0, hi=0; int ok=1;
+        for (size_t i=0; i<L && ok; i++){
+            int d = b62_digit((unsigned char)id[i]);
+            if (d < 0){ ok=0; break; }
+            unsigned __int128 l = (unsigned __int128)lo * 62 + (unsigned)d;
+            unsigned __int128 h = (unsigned __int128)hi * 62 + (uint64_t)(l >> 64);
+            if (h >> 64){ ok=0; break; }
+            lo = (uint64_t)l; hi = (uint64_t)h;
+        }
+        if (ok){
+            memcpy(out, &lo, 8); memcpy(out+8, &hi, 8);
+            return TRK_KEY_B62;
+        }
+        memset(out, 0, 16);
+    }
+    if (L > 0 && L <= 16){ memcpy(out, id, L); return TRK_KEY_RAW; }
+    return TRK_KEY_NONE;
+}
+
+static const char B62[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+int trk_unpack_key(uint64_t kind, const uint8_t key[16], char *out){
+    if (kind == TRK_KEY_RAW){
+        memcpy(out, key, 16); out[16] = '\0';
+        return 1;
+    }
+    if (kind != TRK_KEY_B62) return 0;
+    uint64_t lo, hi;
+    memcpy(&lo, key, 8); memcpy(&hi, key+8, 8);
+    unsigned __int128 v = ((unsigned __int128)hi << 64) | lo;
+    for (int i=21; i>=0; i--){ out[i] = B62[(int)(v % 62)]; v /= 62; }
+    out[22] = '\0';
+    return 1;
+}
+
+/* ============================================================
+   CSV mínimo (parser que respeta comillas) para confirmar claves
+   ============================================================ */
+static size_t parse_csv_line_min(const char *line, char **out, size_t max_fields){
+    size_t n=0, L=strlen(line), bi=0; int inq=0;
+    char *buf=(char*)malloc(L+1); if(!buf) return 0;
+    for(size_t i=0;i<L;i++){
+        char c=line[i];
+        if(c=='"'){
+            if(inq && i+1<L && line[i+1]=='"'){ buf[bi++]='"'; i++; }
+            else inq=!inq;
+        } else if(c==',' && !inq){
+            buf[bi]='\0'; if(n<max_fields) out[n++]=strdup(buf); bi=0;
+        } else if(c=='\r' || c=='\n'){
+            /* ignorar finales de línea */
+        } else {
+            buf[bi++]=c;
+        }
+    }
+    buf[bi]='\0'; if(n<max_fields) out[n++]=strdup(buf);
+    free(buf); return n;
+}
+static void free_fields_min(char **f, size_t n){ for(size_t i=0;i<n;i++) free(f[i]); }
+
+/* ¿En el CSV, columna key_col de la fila en 'offset', está exactamente key?
+   Filas "cortas" (ADD: track_id,name,artist,album,duration_ms) usan la col 0. */
+static int csv_key_equals(FILE *fp, uint32_t key_col, uint64_t offset, const char *key){
+    if (!fp) return 0;
+    if (fseeko(fp, (off_t)offset, SEEK_SET)!=0) return 0;
+    char *line=NULL; size_t cap=0; ssize_t len=getline(&line,&cap,fp);
+    int eq=0;
+    if (len>0){
+        char *f[256]={0}; size_t nf=parse_csv_line_min(line,f,256);
+        const char *field = NULL;
+        if (key_col < (uint32_t)nf) field = f[key_col];
+        else if (nf > 0)            field = f[0];
+        if (field && strcmp(field, key)==0) eq=1;
+        free_fields_min(f,nf);
+    }
+    free(line);
+    return eq;
+}
+
+/* ============================================================
+   Apertura / cierre
+   ============================================================ */
+static int format_from_magic(const IdxHeader *h, size_t *slot_size){
+    if (strncmp(h->magic,"IDX1TRK",7)==0){ *slot_size=sizeof(Slot);   return TRK_FMT_V1; }
+    if (strncmp(h->magic,"IDX2TRK",7)==0){ *slot_size=sizeof(Slot2);  return TRK_FMT_V2; }
+    if (strncmp(h->magic,"IDX3SWT",7)==0){ *slot_size=sizeof(SwSlot); return TRK_FMT_SWISS; }
+    if (strncmp(h->magic,"IDX4MPH",7)==0){ *slot_size=sizeof(uint64_t); return TRK_FMT_MPH; }
+    return 0;
+}
+
+/* Posición de la tabla dentro del mapeo */
+static size_t table_base(int fmt){
+    return fmt == TRK_FMT_SWISS ? SW_CTRL_OFF : fmt == TRK_FMT_MPH ? MPH_DIR_OFF : sizeof(IdxHeader);
+}
+static size_t table_bytes(int fmt, uint64_t cap, size_t slot_size){
+    return (size_t)cap * slot_size + (fmt == TRK_FMT_SWISS ? (size_t)cap : 0);
+}
+/* IDX4MPH: palabras de bits y contadores de rango según el directorio */
+static uint64_t mph_total_words(const uint64_t *dir){
+    uint64_t w = 0;
+    for (uint64_t l=0; l<dir[0]; l++) w += dir[2 + l];
+    return w;
+}
+static uint64_t mph_rank_count(uint64_t words){ return words / MPH_RANK_WORDS + 1; }
+
+/* Tamaño que debe tener un IDX4MPH de cap claves (UINT64_MAX si el
+   directorio no es válido) */
+static uint64_t mph_bytes(const unsigned char *map, size_t sz, uint64_t cap){
+    if (sz < MPH_DIR_OFF + (2 + MPH_MAX_LEVELS) * sizeof(uint64_t)) return UINT64_MAX;
+    const uint64_t *dir = (const uint64_t*)(map + MPH_DIR_OFF);
+    if (dir[0] > MPH_MAX_LEVELS || dir[1] > cap) return UINT64_MAX;
+    for (uint64_t l=0; l<dir[0]; l++) if (dir[2 + l] > (sz >> 3)) return UINT64_MAX;
+    uint64_t w = mph_total_words(dir);
+    return MPH_DIR_OFF + (2 + MPH_MAX_LEVELS + w + mph_rank_count(w)) * sizeof(uint64_t)
+         + (cap - dir[1]) * sizeof(uint64_t) + dir[1] * 2 * sizeof(uint64_t);
+}
+
+static void set_layout(TrackIdx *ti){
+    unsigned char *t = ti->map + table_base(ti->format);
+    if (ti->format == TRK_FMT_MPH){
+        const uint64_t *dir = (const uint64_t*)t;
+        uint64_t w = mph_total_words(dir);
+        ti->mph_levels = (uint32_t)dir[0];
+        ti->mph_nfb    = dir[1];
+        ti->mph_words  = dir + 2;
+        ti->mph_bits   = dir + 2 + MPH_MAX_LEVELS;
+        ti->mph_rank   = ti->mph_bits + w;
+        ti->slots      = (unsigned char*)(ti->mph_rank + mph_rank_count(w));
+        ti->mph_fb     = (const uint64_t*)ti->slots + (ti->capacity - ti->mph_nfb);
+        ti->ctrl = NULL; ti->ngroups = 0;
+    } else if (ti->format == TRK_FMT_SWISS){
+        ti->ctrl    = t;
+        ti->slots   = t + ti->capacity;
+        ti->ngroups = ti->capacity / SW_GROUP;
+    } else {
+        ti->ctrl = NULL; ti->ngroups = 0;
+        ti->slots = t;
+    }
+}
+
+/* Campos reserved de la cabecera (ver track_idx.h) */
+static uint64_t *hdr_field(const TrackIdx *ti, int k){
+    /* cabecera al inicio del mapeo: reserved[] queda alineado a 8 (offset 24) */
+    return (uint64_t*)(ti->map + offsetof(IdxHeader, reserved) + (size_t)k * sizeof(uint64_t));
+}
+#define HDR_COUNT(ti)   (*hdr_field((ti), 0))
+#define HDR_LOAD(ti)    (*hdr_field((ti), 1))
+#define HDR_MIGRATE(ti) (*hdr_field((ti), 2))
+
+static int open_one(TrackIdx *ti, const char *path, int writable){
+    memset(ti, 0, sizeof(*ti)); ti->fd = -1;
+    int fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) return -1;
+    off_t sz = lseek(fd, 0, SEEK_END);
+    if (sz < (off_t)sizeof(IdxHeader)){ close(fd); errno = EINVAL; return -1; }
+    void *map = mmap(NULL, (size_t)sz, writable ? (PROT_READ|PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED){ int e=errno; close(fd); errno=e; return -1; }
+
+    const IdxHeader *h = (const IdxHeader*)map;
+    size_t slot_size = 0;
+    int fmt = format_from_magic(h, &slot_size);
+    uint64_t cap = h->capacity;
+    int bad;
+    if (fmt == TRK_FMT_MPH)     /* capacity = nº de claves (0 vale) */
+        bad = mph_bytes(map, (size_t)sz, cap) > (uint64_t)sz;
+    else {
+        int bad_cap = (fmt == TRK_FMT_SWISS) ? (cap % SW_GROUP) != 0 : (cap & (cap-1)) != 0;
+        bad = !fmt || cap==0 || bad_cap ||
+              (uint64_t)sz < table_base(fmt) + table_bytes(fmt, cap, slot_size);
+    }
+    if (bad){
+        munmap(map, (size_t)sz); close(fd); errno = EINVAL; return -1;
+    }
+    ti->fd = fd; ti->map = map; ti->size = (size_t)sz;
+    ti->format = fmt; ti->writable = writable;
+    ti->capacity = cap; ti->key_col = h->key_col;
+    ti->slot_size = slot_size;
+    set_layout(ti);
+    return 0;
+}
+
+static void close_one(TrackIdx *ti){
+    if (ti->map) munmap(ti->map, ti->size);
+    if (ti->fd >= 0) close(ti->fd);
+    ti->map = NULL; ti->fd = -1;
+}
+
+static void grow_path(char *out, size_t sz, const char *path){ snprintf(out, sz, "%s.grow", path); }
+
+int trackidx_open(TrackIdx *ti, const char *path, int writable){
+    /* Si la tabla está creciendo se abre también <idx>.grow. Si .grow ya no
+       existe es que otro proceso terminó la migración y lo renombró: el
+       archivo que tenemos es el viejo, así que se reabre 'path'. */
+    for (int tries=0; tries<8; tries++){
+        if (open_one(ti, path, writable) != 0) return -1;
+        uint64_t mig = HDR_MIGRATE(ti);
+        if (mig == 0) return 0;
+        if (mig <= ti->capacity){
+            char gp[600]; grow_path(gp, sizeof(gp), path);
+            TrackIdx *g = (TrackIdx*)malloc(sizeof(TrackIdx));
+            if (g && open_one(g, gp, writable) == 0){ ti->grow = g; return 0; }
+            free(g);
+        }
+        close_one(ti);
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+void trackidx_close(TrackIdx *ti){
+    if (ti->grow){ close_one(ti->grow); free(ti->grow); ti->grow = NULL; }
+    close_one(ti);
+}
+
+/* ============================================================
+   IDX3SWT: grupos de 16 bytes de control
+   ============================================================ */
+/* Máscara de bits de los bytes del grupo iguales a b */
+static inline uint32_t sw_match(const uint8_t *ctrl, uint8_t b){
+#ifdef __SSE2__
+    __m128i g = _mm_loadu_si128((const __m128i*)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)b)));
+#else
+    uint32_t m = 0;
+    for (int j=0; j<SW_GROUP; j++) if (ctrl[j] == b) m |= 1u << j;
+    return m;
+#endif
+}
+/* Grupo inicial: bits altos del hash reducidos a [0, ngroups) sin módulo */
+static inline uint64_t sw_group(uint64_t h, uint64_t ngroups){
+    return (uint64_t)(((unsigned __int128)(h >> 7) * ngroups) >> 57);
+}
+static inline uint8_t sw_tag(uint64_t h){ return (uint8_t)(h & 0x7F); }
+
+static inline SwSlot *sw_slot(const TrackIdx *ti, uint64_t i){
+    return (SwSlot*)(ti->slots + i * sizeof(SwSlot));
+}
+
+static int sw_find(const TrackIdx *ti, uint64_t hv, uint64_t kind, const uint8_t k[16],
+                   const char *key, FILE *csv, uint64_t *out_off){
+    uint64_t ng = ti->ngroups, g = sw_group(hv, ng);
+    uint8_t tag = sw_tag(hv);
+    for (uint64_t probe=0; probe<ng; probe++){
+        const uint8_t *c = ti->ctrl + g * SW_GROUP;
+        uint32_t m = sw_match(c, tag);
+        while (m){
+            int j = __builtin_ctz(m); m &= m - 1;
+            const SwSlot *s = sw_slot(ti, g * SW_GROUP + (uint64_t)j);
+            if ((s->offset & TRK_KEY_FLAGS) != kind) continue;
+            uint64_t off = s->offset & TRK_OFF_MASK;
+            int eq;
+            if (kind != TRK_KEY_NONE) eq = memcmp(s->key, k, 16) == 0;
+            else { uint64_t sh; memcpy(&sh, s->key, 8); eq = sh == hv && csv_key_equals(csv, ti->key_col, off, key); }
+            if (eq){ *out_off = off; return 1; }
+        }
+        if (sw_match(c, SW_EMPTY)) return 0;   // grupo con hueco: la clave no sigue
+        g = (g + 1 == ng) ? 0 : g + 1;
+    }
+    return 0;
+}
+
+/* Primer slot libre en el orden de sondeo de hv (o UINT64_MAX si está llena) */
+static uint64_t sw_free_slot(const TrackIdx *ti, uint64_t hv){
+    uint64_t ng = ti->ngroups, g = sw_group(hv, ng);
+    for (uint64_t probe=0; probe<ng; probe++){
+        uint32_t m = sw_match(ti->ctrl + g * SW_GROUP, SW_EMPTY);
+        if (m) return g * SW_GROUP + (uint64_t)__builtin_ctz(m);
+        g = (g + 1 == ng) ? 0 : g + 1;
+    }
+    return UINT64_MAX;
+}
+
+/* ============================================================
+   IDX4MPH: cascada de arreglos de bits + rango
+   ============================================================ */
+/* Posición del hash en el nivel 'level' (nbits bits): mezcla splitmix64
+   con semilla por nivel y reducción por multiplicación */
+static inline uint64_t mph_pos(uint64_t hv, uint32_t level, uint64_t nbits){
+    uint64_t x = hv + (uint64_t)(level + 1) * 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27; x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (uint64_t)(((unsigned __int128)x * nbits) >> 64);
+}
+/* Huella de 16 bits (bits altos de otra mezcla del hash) */
+static inline uint64_t mph_fp(uint64_t hv){ return (hv * 0xD6E8FEB86659FD93ULL) >> 48; }
+
+/* Nº de bits en 1 antes de la posición global g */
+static uint64_t mph_rank_at(const uint64_t *bits, const uint64_t *rank, uint64_t g){
+    uint64_t w = g >> 6, b = w / MPH_RANK_WORDS, r = rank[b];
+    for (uint64_t j = b * MPH_RANK_WORDS; j < w; j++) r += (uint64_t)__builtin_popcountll(bits[j]);
+    return r + (uint64_t)__builtin_popcountll(bits[w] & ((1ULL << (g & 63)) - 1));
+}
+
+static int mph_check(const TrackIdx *ti, uint64_t e, uint64_t hv, const char *key, FILE *csv, uint64_t *out_off){
+    if ((e >> MPH_OFF_BITS) != mph_fp(hv)) return 0;
+    uint64_t off = e & MPH_OFF_MASK;
+    if (csv && !csv_key_equals(csv, ti->key_col, off, key)) return 0;
+    *out_off = off;
+    return 1;
+}
+
+static int mph_find(const TrackIdx *ti, const char *key, FILE *csv, uint64_t *out_off){
+    uint64_t hv = trk_hash(key), base = 0;
+    /* La clave, si está, quedó en el primer nivel donde su bit sigue en 1 */
+    for (uint32_t l=0; l<ti->mph_levels; l++){
+        uint64_t nbits = ti->mph_words[l] * 64, g = base + mph_pos(hv, l, nbits);
+        if ((ti->mph_bits[g >> 6] >> (g & 63)) & 1){
+            uint64_t e = ((const uint64_t*)ti->slots)[mph_rank_at(ti->mph_bits, ti->mph_rank, g)];
+            return mph_check(ti, e, hv, key, csv, out_off);
+        }
+        base += nbits;
+    }
+    /* Resto: búsqueda binaria por hash */
+    uint64_t lo = 0, hi = ti->mph_nfb;
+    while (lo < hi){
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (ti->mph_fb[2*mid] < hv) lo = mid + 1; else hi = mid;
+    }
+    for (; lo < ti->mph_nfb && ti->mph_fb[2*lo] == hv; lo++)
+        if (mph_check(ti, ti->mph_fb[2*lo + 1], hv, key, csv, out_off)) return 1;
+    return 0;
+}
+
+static void sw_store(TrackIdx *ti, uint64_t i, uint64_t hv, uint64_t kind, const uint8_t k[16], uint64_t off){
+    SwSlot *s = sw_slot(ti, i);
+    s->offset = off | kind;
+    if (kind == TRK_KEY_NONE){ memset(s->key, 0, 16); memcpy(s->key, &hv, 8); }
+    else memcpy(s->key, k, 16);
+    ti->ctrl[i] = sw_tag(hv);
+    HDR_COUNT(ti)++;
+}
+
+/* ============================================================
+   Búsqueda
+   ============================================================ */
+int trackidx_find(const TrackIdx *ti, const char *key, FILE *csv, uint64_t *out_off){
+    /* Durante un crecimiento: primero la tabla nueva, luego la vieja */
+    if (ti->grow && trackidx_find(ti->grow, key, csv, out_off)) return 1;
+    if (ti->format == TRK_FMT_MPH) return mph_find(ti, key, csv, out_off);
+
+    uint64_t cap = ti->capacity, hv = trk_hash(key);
+    uint64_t i = hv & (cap-1), start = i;
+
+    if (ti->format == TRK_FMT_SWISS){
+        uint8_t k[16]; uint64_t kind = trk_pack_key(key, k);
+        return sw_find(ti, hv, kind, k, key, csv, out_off);
+    }
+
+    if (ti->format == TRK_FMT_V1){
+        const Slot *slots = (const Slot*)ti->slots;
+        for(;;){
+            const Slot *s = &slots[i];
+            if (s->hash == 0) return 0;
+            if (s->hash == hv && csv_key_equals(csv, ti->key_col, s->offset, key)){
+                *out_off = s->offset; return 1;
+            }
+            i = (i+1) & (cap-1);
+            if (i == start) return 0;
+        }
+    }
+
+    uint8_t k[16]; uint64_t kind = trk_pack_key(key, k);
+    const Slot2 *slots = (const Slot2*)ti->slots;
+    for(;;){
+        const Slot2 *s = &slots[i];
+        if (s->hash == 0) return 0;
+        if (s->hash == hv){
+            uint64_t sk = s->offset & TRK_KEY_FLAGS, off = s->offset & TRK_OFF_MASK;
+            if (sk == kind){
+                if (kind != TRK_KEY_NONE ? memcmp(s->key, k, 16)==0
+                                         : csv_key_equals(csv, ti->key_col, off, key)){
+                    *out_off = off; return 1;
+                }
+            }
+        }
+        i = (i+1) & (cap-1);
+        if (i == start) return 0;
+    }
+}
+
+/* ============================================================
+   Construcción
+   ============================================================ */
+int trackidx_create(TrackIdx *ti, const char *path, int format, uint64_t capacity, uint32_t key_col){
+    memset(ti, 0, sizeof(*ti)); ti->fd = -1;
+    if (format == TRK_FMT_MPH){ errno = EINVAL; return -1; }   /* ver trackidx_write_mph */
+    size_t slot_size = (format == TRK_FMT_V1) ? sizeof(Slot)
+                     : (format == TRK_FMT_V2) ? sizeof(Slot2) : sizeof(SwSlot);
+    if (format == TRK_FMT_SWISS) capacity = (capacity + SW_GROUP - 1) / SW_GROUP * SW_GROUP;
+    if (capacity == 0) capacity = (format == TRK_FMT_SWISS) ? SW_GROUP : 1;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    off_t total = (off_t)(table_base(format) + table_bytes(format, capacity, slot_size));
+    if (ftruncate(fd, total) != 0){ int e=errno; close(fd); errno=e; return -1; }
+    void *map = mmap(NULL, (size_t)total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED){ int e=errno; close(fd); errno=e; return -1; }
+    // ftruncate deja el archivo en ceros: todos los slots vacíos
+
+    IdxHeader *h = (IdxHeader*)map;
+    memcpy(h->magic, format == TRK_FMT_V1 ? "IDX1TRK" : format == TRK_FMT_V2 ? "IDX2TRK" : "IDX3SWT", 7);
+    h->capacity = capacity;
+    h->key_col  = key_col;
+    h->version  = (uint32_t)format;
+
+    ti->fd = fd; ti->map = map; ti->size = (size_t)total;
+    ti->format = format; ti->writable = 1;
+    ti->capacity = capacity; ti->key_col = key_col;
+    ti->slot_size = slot_size;
+    set_layout(ti);
+    if (format == TRK_FMT_SWISS) memset(ti->ctrl, SW_EMPTY, (size_t)capacity);
+    return 0;
+}
+
+int trackidx_put(TrackIdx *ti, uint64_t h, uint64_t kind, const uint8_t key[16], uint64_t off){
+    if (ti->format == TRK_FMT_MPH){ errno = EROFS; return -1; }
+    uint64_t cap = ti->capacity, i = h & (cap-1);
+    if (ti->format == TRK_FMT_SWISS){
+        /* Sin CSV a mano: repetidos con TRK_KEY_NONE no se detectan (como en v2) */
+        uint64_t ng = ti->ngroups, g = sw_group(h, ng);
+        uint8_t tag = sw_tag(h);
+        if (kind != TRK_KEY_NONE){
+            for (uint64_t probe=0; probe<ng; probe++){
+                const uint8_t *c = ti->ctrl + g * SW_GROUP;
+                uint32_t m = sw_match(c, tag);
+                while (m){
+                    int j = __builtin_ctz(m); m &= m - 1;
+                    SwSlot *s = sw_slot(ti, g * SW_GROUP + (uint64_t)j);
+                    if ((s->offset & TRK_KEY_FLAGS) == kind && memcmp(s->key, key, 16) == 0){
+                        if (off < (s->offset & TRK_OFF_MASK)) s->offset = off | kind;
+                        return 0;
+                    }
+                }
+                if (sw_match(c, SW_EMPTY)) break;
+                g = (g + 1 == ng) ? 0 : g + 1;
+            }
+        }
+        uint64_t free_i = sw_free_slot(ti, h);
+        if (free_i == UINT64_MAX){ errno = ENOSPC; return -1; }
+        sw_store(ti, free_i, h, kind, key, off);
+        return 1;
+    }
+    if (ti->format == TRK_FMT_V1){
+        Slot *slots = (Slot*)ti->slots;
+        while (slots[i].hash != 0) i = (i+1) & (cap-1);
+        slots[i].hash = h; slots[i].offset = off;
+        HDR_COUNT(ti)++;
+        return 1;
+    }
+    Slot2 *slots = (Slot2*)ti->slots;
+    for(;;){
+        Slot2 *s = &slots[i];
+        if (s->hash == 0){
+            s->hash = h; s->offset = off | kind; memcpy(s->key, key, 16);
+            HDR_COUNT(ti)++;
+            return 1;
+        }
+        if (s->hash == h && kind != TRK_KEY_NONE &&
+            (s->offset & TRK_KEY_FLAGS) == kind && memcmp(s->key, key, 16)==0){
+            if (off < (s->offset & TRK_OFF_MASK)) s->offset = off | kind;
+            return 0;
+        }
+        i = (i+1) & (cap-1);
+    }
+}
+
+/* Versión concurrente: el slot se reserva con CAS sobre 'hash'. En v2 el
+   dueño escribe la clave y publica 'offset' con release; offset 0 significa
+   "aún sin publicar" (una fila de datos nunca empieza en el byte 0: antes va
+   el encabezado). Quien encuentra el mismo hash espera la publicación,
+   compara la clave y, si es la misma, se queda con el menor offset.
+   Cabecera de 48 B y slots de 16/32 B: los campos de 64 bits están alineados. */
+int trackidx_put_concurrent(TrackIdx *ti, uint64_t h, uint64_t kind, const uint8_t key[16], uint64_t off){
+    if (ti->format == TRK_FMT_SWISS || ti->format == TRK_FMT_MPH){ errno = EINVAL; return -1; }
+    uint64_t cap = ti->capacity, i = h & (cap-1);
+    for(;;){
+        uint64_t *hp = (uint64_t*)(ti->slots + i * ti->slot_size);
+        uint64_t cur = __atomic_load_n(hp, __ATOMIC_ACQUIRE);
+        if (cur == 0){
+            uint64_t expected = 0;
+            if (__atomic_compare_exchange_n(hp, &expected, h, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+                __atomic_fetch_add(hdr_field(ti, 0), 1, __ATOMIC_RELAXED);
+                if (ti->format == TRK_FMT_V1){ hp[1] = off; return 1; }
+                memcpy(hp + 2, key, 16);
+                __atomic_store_n(hp + 1, off | kind, __ATOMIC_RELEASE);
+                return 1;
+            }
+            cur = expected;
+        }
+        if (ti->format == TRK_FMT_V2 && cur == h && kind != TRK_KEY_NONE){
+            uint64_t o;
+            while ((o = __atomic_load_n(hp + 1, __ATOMIC_ACQUIRE)) == 0) { /* espera publicación */ }
+            if ((o & TRK_KEY_FLAGS) == kind && memcmp(hp + 2, key, 16) == 0){
+                uint64_t want = off | kind;
+                while (want < o &&
+                       !__atomic_compare_exchange_n(hp + 1, &o, want, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {}
+                return 0;
+            }
+        }
+        i = (i+1) & (cap-1);
+    }
+}
+
+typedef struct { uint64_t h, seq; } ChainEnt;     // seq = posición desde el slot vacío inicial
+
+static int cmp_chain(const void *a, const void *b){
+    const ChainEnt *x = a, *y = b;
+    if (x->h != y->h) return x->h < y->h ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+static int cmp_u64(const void *a, const void *b){
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Una racha ent[0..n): cada grupo del mismo hash recibe sus offsets
+   ordenados en el orden de sondeo */
+static void sort_run(TrackIdx *ti, uint64_t base, ChainEnt *ent, size_t n, uint64_t *offs){
+    uint64_t mask = ti->capacity - 1;
+    qsort(ent, n, sizeof(*ent), cmp_chain);
+    for (size_t a=0, b; a<n; a=b){
+        for (b=a+1; b<n && ent[b].h == ent[a].h; b++) {}
+        if (b - a < 2) continue;
+        for (size_t j=a; j<b; j++) offs[j-a] = ((uint64_t*)(ti->slots + ((base + ent[j].seq) & mask) * ti->slot_size))[1];
+        qsort(offs, b - a, sizeof(*offs), cmp_u64);
+        for (size_t j=a; j<b; j++) ((uint64_t*)(ti->slots + ((base + ent[j].seq) & mask) * ti->slot_size))[1] = offs[j-a];
+    }
+}
+
+int trackidx_sort_chains(TrackIdx *ti){
+    if (ti->format != TRK_FMT_V1 && ti->format != TRK_FMT_V2) return 0;
+    uint64_t cap = ti->capacity, mask = cap - 1, e = 0;
+    while (e < cap && ((const uint64_t*)(ti->slots + e * ti->slot_size))[0] != 0) e++;
+    if (e == cap) return 0;                         // sin slot vacío no hay rachas que cortar
+    ChainEnt *ent = NULL; uint64_t *offs = NULL;
+    size_t n = 0, ncap = 0;
+    uint64_t base = e + 1;
+    for (uint64_t j=0; j<cap; j++){
+        const uint64_t *hp = (const uint64_t*)(ti->slots + ((base + j) & mask) * ti->slot_size);
+        if (hp[0] == 0){                            // fin de la racha
+            if (n > 1) sort_run(ti, base, ent, n, offs);
+            n = 0;
+            continue;
+        }
+        if (ti->format == TRK_FMT_V2 && (hp[1] & TRK_KEY_FLAGS) != TRK_KEY_NONE) continue;
+        if (n == ncap){
+            size_t nc = ncap ? ncap * 2 : 1024;
+            ChainEnt *ne = realloc(ent, nc * sizeof(*ne));
+            uint64_t *no = ne ? realloc(offs, nc * sizeof(*no)) : NULL;
+            if (ne) ent = ne;
+            if (no) offs = no;
+            if (!ne || !no){ free(ent); free(offs); errno = ENOMEM; return -1; }
+            ncap = nc;
+        }
+        ent[n++] = (ChainEnt){ hp[0], j };
+    }
+    free(ent); free(offs);
+    return 0;
+}
+
+int trackidx_finish(TrackIdx *ti){
+    int rc = 0;
+    if (ti->map && ti->writable && msync(ti->map, ti->size, MS_SYNC) != 0) rc = -1;
+    trackidx_close(ti);
+    return rc;
+}
+
+/* Reescritura v1/v2 -> IDX3SWT */
+int trackidx_write_swiss(const char *src_path, const char *csv_path, const char *dst_path, double lf){
+    if (!(lf > 0.0 && lf < 1.0)){ errno = EINVAL; return -1; }
+    TrackIdx src;
+    if (trackidx_open(&src, src_path, 0) != 0) return -1;
+    if (src.format == TRK_FMT_SWISS || src.format == TRK_FMT_MPH){ trackidx_close(&src); errno = EINVAL; return -1; }
+
+    /* v1 no guarda la clave: hay que leerla del CSV */
+    FILE *csv = NULL;
+    if (src.format == TRK_FMT_V1){
+        csv = fopen(csv_path, "r");
+        if (!csv){ int e=errno; trackidx_close(&src); errno=e; return -1; }
+    }
+
+    /* En v1 un mismo track_id puede ocupar muchos slots: se cuenta por
+       exceso y el repetido se descarta al insertar */
+    uint64_t n = 0;
+    for (uint64_t i=0; i<src.capacity; i++)
+        if (*(const uint64_t*)(src.slots + i * src.slot_size) != 0) n++;
+
+    TrackIdx dst;
+    uint64_t cap = (uint64_t)((double)n / lf) + 1;
+    if (trackidx_create(&dst, dst_path, TRK_FMT_SWISS, cap, src.key_col) != 0){
+        int e=errno; if (csv) fclose(csv); trackidx_close(&src); errno=e; return -1;
+    }
+    HDR_LOAD(&dst) = (uint64_t)(lf * 1000.0 + 0.5);   // carga de construcción (‰)
+
+    char *line = NULL; size_t bufcap = 0;
+    int rc = 0;
+    for (uint64_t i=0; i<src.capacity && rc==0; i++){
+        if (src.format == TRK_FMT_V2){
+            const Slot2 *s = (const Slot2*)(src.slots + i * src.slot_size);
+            if (s->hash == 0) continue;
+            if (trackidx_put(&dst, s->hash, s->offset & TRK_KEY_FLAGS, s->key, s->offset & TRK_OFF_MASK) < 0) rc = -1;
+        } else {
+            const Slot *s = (const Slot*)(src.slots + i * src.slot_size);
+            if (s->hash == 0) continue;
+            if (fseeko(csv, (off_t)s->offset, SEEK_SET) != 0 || getline(&line, &bufcap, csv) <= 0) continue;
+            char *f[256]={0}; size_t nf=parse_csv_line_min(line,f,256);
+            const char *field = (src.key_col < (uint32_t)nf) ? f[src.key_col] : (nf > 0 ? f[0] : NULL);
+            if (field && field[0]){
+                uint8_t k[16]; uint64_t kind = trk_pack_key(field, k);
+                if (trackidx_put(&dst, s->hash, kind, k, s->offset) < 0) rc = -1;
+            }
+            free_fields_min(f,nf);
+        }
+    }
+    free(line);
+    if (csv) fclose(csv);
+    trackidx_close(&src);
+    int e = errno;
+    if (trackidx_finish(&dst) != 0 && rc == 0){ rc = -1; e = errno; }
+    if (rc != 0){ unlink(dst_path); errno = e; }
+    return rc;
+}
+
+/* ============================================================
+   Alta incremental y crecimiento en línea
+   ============================================================ */
+/* Entrada del slot i (1 si está ocupado). En swiss el hash se recalcula
+   desde la clave (o se lee de key[0..7] si es TRK_KEY_NONE). */
+static int entry_at(const TrackIdx *ti, uint64_t i, uint64_t *h, uint64_t *kind, uint8_t key[16], uint64_t *off){
+    if (ti->format == TRK_FMT_V1){
+        const Slot *s = (const Slot*)(ti->slots + i * ti->slot_size);
+        if (s->hash == 0) return 0;
+        *h = s->hash; *kind = TRK_KEY_NONE; memset(key, 0, 16); *off = s->offset;
+        return 1;
+    }
+    if (ti->format == TRK_FMT_V2){
+        const Slot2 *s = (const Slot2*)(ti->slots + i * ti->slot_size);
+        if (s->hash == 0) return 0;
+        *h = s->hash; *kind = s->offset & TRK_KEY_FLAGS; memcpy(key, s->key, 16);
+        *off = s->offset & TRK_OFF_MASK;
+        return 1;
+    }
+    if (ti->ctrl[i] == SW_EMPTY) return 0;
+    const SwSlot *s = sw_slot(ti, i);
+    *kind = s->offset & TRK_KEY_FLAGS; *off = s->offset & TRK_OFF_MASK;
+    if (*kind == TRK_KEY_NONE){ memcpy(h, s->key, 8); memset(key, 0, 16); }
+    else { char str[24]; trk_unpack_key(*kind, s->key, str); *h = trk_hash(str); memcpy(key, s->key, 16); }
+    return 1;
+}
+
+/* Nº de entradas; los índices sin contador en la cabecera se cuentan una vez */
+static uint64_t entry_count(TrackIdx *ti){
+    if (HDR_COUNT(ti) == 0){
+        uint64_t n = 0, h, kind, off; uint8_t k[16];
+        for (uint64_t i=0; i<ti->capacity; i++) n += (uint64_t)entry_at(ti, i, &h, &kind, k, &off);
+        HDR_COUNT(ti) = n;
+    }
+    return HDR_COUNT(ti);
+}
+
+static double max_load(const TrackIdx *ti){
+    if (ti->format != TRK_FMT_SWISS) return TRK_MAX_LOAD;
+    double lf = HDR_LOAD(ti) ? (double)HDR_LOAD(ti) / 1000.0 : SW_DEFAULT_LF;
+    return lf + (1.0 - lf) / 2.0;
+}
+
+/* Crea <idx>.grow con el doble de slots y marca el inicio de la migración */
+static int grow_start(TrackIdx *ti, const char *path){
+    char gp[600]; grow_path(gp, sizeof(gp), path);
+    TrackIdx *g = (TrackIdx*)malloc(sizeof(TrackIdx));
+    if (!g) return -1;
+    if (trackidx_create(g, gp, ti->format, ti->capacity * 2, ti->key_col) != 0){ free(g); return -1; }
+    HDR_LOAD(g) = HDR_LOAD(ti);
+    ti->grow = g;
+    HDR_MIGRATE(ti) = 1;          // siguiente slot a copiar: 0
+    return 0;
+}
+
+/* Copia hasta TRK_MIGRATE_STEP slots viejos; al terminar publica .grow */
+static int grow_step(TrackIdx *ti, const char *path){
+    uint64_t i = HDR_MIGRATE(ti) - 1, end = i + TRK_MIGRATE_STEP;
+    if (end > ti->capacity) end = ti->capacity;
+    for (; i < end; i++){
+        uint64_t h, kind, off; uint8_t k[16];
+        if (entry_at(ti, i, &h, &kind, k, &off) && trackidx_put(ti->grow, h, kind, k, off) < 0) return -1;
+        HDR_MIGRATE(ti) = i + 2;
+    }
+    if (i < ti->capacity) return 0;
+
+    /* Migración completa: la tabla nueva reemplaza a la vieja */
+    char gp[600]; grow_path(gp, sizeof(gp), path);
+    if (msync(ti->grow->map, ti->grow->size, MS_SYNC) != 0) return -1;
+    if (rename(gp, path) != 0) return -1;
+    HDR_MIGRATE(ti) = ti->capacity + 1;     // este archivo ya es el viejo
+    return 0;
+}
+
+/* Inserta una clave que ya se sabe ausente en una sola tabla */
+static int insert_new(TrackIdx *ti, uint64_t hv, uint64_t kind, const uint8_t k[16], uint64_t offset){
+    if (ti->format == TRK_FMT_SWISS){
+        uint64_t i = sw_free_slot(ti, hv);
+        if (i == UINT64_MAX){ errno = ENOSPC; return -1; }   /* tabla llena */
+        sw_store(ti, i, hv, kind, k, offset);
+        return 0;
+    }
+    /* Primer slot vacío desde la posición del hash */
+    uint64_t cap = ti->capacity, i = hv & (cap-1), start = i;
+    for(;;){
+        uint64_t *hp = (uint64_t*)(ti->slots + i * ti->slot_size);
+        if (hp[0] == 0) break;
+        i = (i+1) & (cap-1);
+        if (i == start){ errno = ENOSPC; return -1; }        /* tabla llena */
+    }
+    if (ti->format == TRK_FMT_V1){
+        Slot *s = (Slot*)(ti->slots + i * ti->slot_size);
+        s->offset = offset; s->hash = hv;
+    } else {
+        Slot2 *s = (Slot2*)(ti->slots + i * ti->slot_size);
+        memcpy(s->key, k, 16); s->offset = offset | kind; s->hash = hv;
+    }
+    HDR_COUNT(ti)++;
+    return 0;
+}
+
+static int lock_fd(int fd, short type){
+    struct flock fl; memset(&fl, 0, sizeof(fl));
+    fl.l_type = type; fl.l_whence = SEEK_SET;    // l_len 0 = todo el archivo
+    while (fcntl(fd, F_SETLKW, &fl) != 0){ if (errno != EINTR) return -1; }
+    return 0;
+}
+
+int trackidx_insert(const char *idx_path, const char *csv_path, const char *key, uint64_t offset){
+    TrackIdx ti;
+    /* Abrir y bloquear; si mientras esperábamos otro escritor terminó un
+       crecimiento, el archivo bloqueado es el viejo: reabrir */
+    for (int tries=0;; tries++){
+        if (trackidx_open(&ti, idx_path, 1) != 0) return -1;
+        if (ti.format == TRK_FMT_MPH){ trackidx_close(&ti); errno = EROFS; return -1; }
+        if (lock_fd(ti.fd, F_WRLCK) != 0){ int e=errno; trackidx_close(&ti); errno=e; return -1; }
+        uint64_t mig = HDR_MIGRATE(&ti);
+        int stale = mig > ti.capacity || (mig != 0 && !ti.grow);
+        if (!stale) break;
+        trackidx_close(&ti);
+        if (tries == 8){ errno = EAGAIN; return -1; }
+    }
+
+    /* Solo v1 y claves que no caben necesitan el CSV para confirmar */
+    FILE *csv = NULL;
+    uint8_t k[16]; uint64_t kind = trk_pack_key(key, k);
+    if (ti.format == TRK_FMT_V1 || kind == TRK_KEY_NONE) csv = fopen(csv_path, "r");
+
+    uint64_t found_off;
+    if (trackidx_find(&ti, key, csv, &found_off)){
+        if (csv) fclose(csv);
+        trackidx_close(&ti);
+        errno = EEXIST;     /* duplicado */
+        return -1;
+    }
+    if (csv) fclose(csv);
+
+    /* ¿Hace falta crecer? (o la tabla nueva de un crecimiento en curso) */
+    int rc = 0;
+    if (!ti.grow && (double)(entry_count(&ti) + 1) > max_load(&ti) * (double)ti.capacity)
+        rc = grow_start(&ti, idx_path);
+
+    uint64_t hv = trk_hash(key);
+    if (rc == 0) rc = insert_new(ti.grow ? ti.grow : &ti, hv, kind, k, offset);
+    if (rc == 0 && ti.grow) rc = grow_step(&ti, idx_path);
+
+    int e = errno;
+    trackidx_close(&ti);   /* MAP_SHARED: los cambios quedan en el archivo; cerrar suelta el lock */
+    errno = e;
+    return rc;
+}
+
+/* ============================================================
+   Reescritura v2/swiss -> IDX4MPH
+   ============================================================ */
+static int cmp_fb(const void *a, const void *b){
+    uint64_t x = ((const uint64_t*)a)[0], y = ((const uint64_t*)b)[0];
+    return (x > y) - (x < y);
+}
+
+int trackidx_write_mph(const char *src_path, const char *dst_path){
+    TrackIdx src;
+    if (trackidx_open(&src, src_path, 0) != 0) return -1;
+    if (src.format == TRK_FMT_V1 || src.format == TRK_FMT_MPH || src.grow){
+        trackidx_close(&src); errno = EINVAL; return -1;
+    }
+
+    /* Claves del origen (v2/swiss ya tienen una entrada por track_id) */
+    uint64_t n = 0, cap = src.capacity, h, kind, off; uint8_t k[16];
+    for (uint64_t i=0; i<cap; i++) n += (uint64_t)entry_at(&src, i, &h, &kind, k, &off);
+    uint64_t *hv  = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));
+    uint64_t *ent = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));
+    uint64_t *pos = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));   // bit global asignado
+    uint64_t *cur = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));   // claves pendientes
+    uint64_t *bits = NULL, *rank = NULL, *entries = NULL, *fb = NULL;
+    uint64_t dir[2 + MPH_MAX_LEVELS] = {0};
+    int rc = -1, e = ENOMEM;
+    if (!hv || !ent || !pos || !cur) goto out;
+    uint64_t m = 0;
+    for (uint64_t i=0; i<cap; i++){
+        if (!entry_at(&src, i, &h, &kind, k, &off)) continue;
+        if (off > MPH_OFF_MASK){ e = EFBIG; goto out; }
+        hv[m] = h; ent[m] = off | (mph_fp(h) << MPH_OFF_BITS); pos[m] = UINT64_MAX; cur[m] = m; m++;
+    }
+
+    /* Cada nivel tiene MPH_GAMMA bits por clave pendiente: las claves que
+       caen solas en su bit quedan ubicadas, las que chocan pasan al siguiente */
+    uint64_t words = 0;
+    uint32_t l = 0;
+    for (; l < MPH_MAX_LEVELS && m > 0; l++){
+        uint64_t w = ((uint64_t)(MPH_GAMMA * (double)m) + 63) / 64;
+        uint64_t *nb = (uint64_t*)realloc(bits, (words + w) * sizeof(uint64_t));
+        uint64_t *coll = (uint64_t*)calloc(w, sizeof(uint64_t));
+        if (!nb || !coll){ free(coll); if (nb) bits = nb; goto out; }
+        bits = nb;
+        uint64_t *a = bits + words;
+        memset(a, 0, w * sizeof(uint64_t));
+        for (uint64_t j=0; j<m; j++){
+            uint64_t p = mph_pos(hv[cur[j]], l, w * 64), bit = 1ULL << (p & 63);
+            if (a[p >> 6] & bit) coll[p >> 6] |= bit; else a[p >> 6] |= bit;
+        }
+        for (uint64_t j=0; j<w; j++) a[j] &= ~coll[j];
+        free(coll);
+        uint64_t m2 = 0;
+        for (uint64_t j=0; j<m; j++){
+            uint64_t p = mph_pos(hv[cur[j]], l, w * 64);
+            if ((a[p >> 6] >> (p & 63)) & 1) pos[cur[j]] = words * 64 + p;
+            else cur[m2++] = cur[j];
+        }
+        dir[2 + l] = w; words += w; m = m2;
+    }
+    dir[0] = l; dir[1] = m;
+
+    /* Rango acumulado y entradas en el orden de sus bits */
+    uint64_t nr = mph_rank_count(words), placed = n - m;
+    rank = (uint64_t*)malloc(nr * sizeof(uint64_t));
+    entries = (uint64_t*)malloc((placed ? placed : 1) * sizeof(uint64_t));
+    fb = (uint64_t*)malloc((m ? m : 1) * 2 * sizeof(uint64_t));
+    if (!rank || !entries || !fb) goto out;
+    uint64_t acc = 0;
+    for (uint64_t b=0; b<nr; b++){
+        rank[b] = acc;
+        for (uint64_t j = b * MPH_RANK_WORDS; j < words && j < (b + 1) * MPH_RANK_WORDS; j++)
+            acc += (uint64_t)__builtin_popcountll(bits[j]);
+    }
+    for (uint64_t i=0; i<n; i++)
+        if (pos[i] != UINT64_MAX) entries[mph_rank_at(bits, rank, pos[i])] = ent[i];
+    for (uint64_t j=0; j<m; j++){ fb[2*j] = hv[cur[j]]; fb[2*j + 1] = ent[cur[j]]; }
+    qsort(fb, (size_t)m, 2 * sizeof(uint64_t), cmp_fb);
+
+    FILE *fo = fopen(dst_path, "wb");
+    if (!fo){ e = errno; goto out; }
+    unsigned char head[MPH_DIR_OFF] = {0};
+    IdxHeader *hd = (IdxHeader*)head;
+    memcpy(hd->magic, "IDX4MPH", 7);
+    hd->capacity = n;
+    hd->key_col  = src.key_col;
+    hd->version  = TRK_FMT_MPH;
+    uint64_t cnt = n; memcpy(head + offsetof(IdxHeader, reserved), &cnt, sizeof(cnt));
+    int ok = fwrite(head, 1, sizeof(head), fo) == sizeof(head)
+          && fwrite(dir, sizeof(uint64_t), 2 + MPH_MAX_LEVELS, fo) == 2 + MPH_MAX_LEVELS
+          && fwrite(bits, sizeof(uint64_t), (size_t)words, fo) == (size_t)words
+          && fwrite(rank, sizeof(uint64_t), (size_t)nr, fo) == (size_t)nr
+          && fwrite(entries, sizeof(uint64_t), (size_t)placed, fo) == (size_t)placed
+          && fwrite(fb, 2 * sizeof(uint64_t), (size_t)m, fo) == (size_t)m;
+    if (!ok) e = errno;
+    if (fclose(fo) != 0 && ok){ ok = 0; e = errno; }
+    if (!ok){ unlink(dst_path); goto out; }
+    rc = 0;
+out:
+    free(hv); free(ent); free(pos); free(cur);
+    free(bits); free(rank); free(entries); free(fb);
+    trackidx_close(&src);
+    if (rc != 0) errno = e;
+    return rc;
+}
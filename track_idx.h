@@ -0,0 +1,149 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+/* ============================================================
+   tracks.idx: índice hash en disco track_id -> offset de línea (CSV)
+   Cabecera común + tabla de slots con probing lineal (potencia de 2).
+
+   IDX1TRK (v1): Slot  {hash, offset}                16 B
+       El slot no guarda la clave: cada acierto de hash se confirma leyendo
+       la columna key_col del CSV en 'offset'.
+   IDX2TRK (v2): Slot2 {hash, offset|flags, key[16]} 32 B
+       La clave va en el slot. Un track_id de Spotify (22 caracteres base62)
+       es un entero de 128 bits y se guarda empaquetado; ids de hasta 16
+       bytes se guardan tal cual. Solo ids que no caben en ninguna de las dos
+       formas (TRK_KEY_NONE) se siguen confirmando contra el CSV.
+   IDX3SWT (swiss): grupos de 16 slots con bytes de control; ver abajo.
+   IDX4MPH: hash perfecto mínimo (estilo BBHash), solo lectura. Cada clave
+       ocupa una entrada de 8 B {offset:48, huella:16}; el hash la lleva a un
+       bit de una cascada de arreglos de bits y el rango de ese bit es el
+       índice de su entrada. Una clave ausente también cae en alguna entrada:
+       la huella descarta casi todas y el resto se confirma contra el CSV.
+   ============================================================ */
+
+typedef struct {
+    char     magic[8];
+    uint64_t capacity;   // número de slots (potencia de 2)
+    uint32_t key_col;    // columna de track_id en el CSV
+    uint32_t version;
+    uint64_t reserved[3];
+} __attribute__((packed)) IdxHeader;
+
+typedef struct { uint64_t hash, offset; } __attribute__((packed)) Slot;
+
+typedef struct {
+    uint64_t hash;       // 0 = vacío
+    uint64_t offset;     // bits 0..61 offset CSV; bits 62..63 = tipo de clave
+    uint8_t  key[16];
+} __attribute__((packed)) Slot2;
+
+typedef struct {
+    uint64_t offset;     // igual que en Slot2
+    uint8_t  key[16];
+} __attribute__((packed)) SwSlot;
+
+#define SW_GROUP      16
+#define SW_EMPTY      0x80
+#define SW_CTRL_OFF   64             // ctrl alineado a línea de caché
+#define SW_DEFAULT_LF 0.875
+
+#define TRK_OFF_MASK   ((1ULL<<62)-1)
+#define TRK_KEY_B62    0ULL           // key = entero de 128 bits (little endian)
+#define TRK_KEY_RAW    (1ULL<<62)     // key = bytes crudos (<=16), relleno con ceros
+#define TRK_KEY_NONE   (1ULL<<63)     // la clave no está en el slot: confirmar en CSV
+#define TRK_KEY_FLAGS  (~TRK_OFF_MASK)
+
+/* IDX4MPH: tras la cabecera (alineado a 64) va el directorio
+   {niveles, n_resto, palabras[MPH_MAX_LEVELS]}, luego los bits de todos los
+   niveles, un contador de rango cada MPH_RANK_WORDS palabras, las entradas
+   y al final el resto: pares {hash, entrada} ordenados por hash para las
+   claves que siguieron chocando tras MPH_MAX_LEVELS niveles. */
+#define MPH_GAMMA       2.0          // bits por clave pendiente en cada nivel
+#define MPH_MAX_LEVELS  32
+#define MPH_DIR_OFF     64
+#define MPH_RANK_WORDS  8            // rango cada 512 bits
+#define MPH_OFF_BITS    48
+#define MPH_OFF_MASK    ((1ULL<<MPH_OFF_BITS)-1)
+
+#define TRK_MAX_LOAD       0.75      // v1/v2: umbral de crecimiento
+#ifndef TRK_MIGRATE_STEP
+#define TRK_MIGRATE_STEP   4096      // slots viejos copiados por cada alta
+#endif
+
+enum { TRK_FMT_V1 = 1, TRK_FMT_V2 = 2, TRK_FMT_SWISS = 3, TRK_FMT_MPH = 4 };
+
+/* Hash FNV-1a 64 (0 reservado para "vacío") */
+uint64_t trk_hash(const char *s);
+/* Empaqueta un track_id en 16 bytes; devuelve el tipo (TRK_KEY_*) */
+uint64_t trk_pack_key(const char *id, uint8_t out[16]);
+/* Inverso de trk_pack_key (out >= 23 bytes). 0 si kind es TRK_KEY_NONE. */
+int      trk_unpack_key(uint64_t kind, const uint8_t key[16], char *out);
+
+/* Índice abierto (mmap). Si hay un crecimiento en curso, grow apunta a la
+   tabla nueva (<idx>.grow) y las búsquedas consultan ambas. */
+typedef struct TrackIdx {
+    int            fd;
+    unsigned char *map;
+    size_t         size;
+    int            format;     // TRK_FMT_*
+    int            writable;
+    uint64_t       capacity;
+    uint32_t       key_col;
+    size_t         slot_size;
+    unsigned char *slots;
+    uint8_t       *ctrl;       // solo IDX3SWT
+    uint64_t       ngroups;    // solo IDX3SWT
+    uint32_t       mph_levels; // solo IDX4MPH (slots = entradas)
+    uint64_t       mph_nfb;
+    const uint64_t *mph_words, *mph_bits, *mph_rank, *mph_fb;
+    struct TrackIdx *grow;     // tabla nueva durante un crecimiento (o NULL)
+} TrackIdx;
+
+/* Abre y valida el índice (solo lectura o lectura/escritura).
+   Devuelve 0 o -1 con errno (EINVAL = formato desconocido). */
+int  trackidx_open(TrackIdx *ti, const char *path, int writable);
+void trackidx_close(TrackIdx *ti);
+
+/* Busca 'key'. Devuelve 1 y *out_off si existe, 0 si no está.
+   csv solo se usa para confirmar aciertos sin clave en el slot (v1,
+   TRK_KEY_NONE o IDX4MPH); puede ser NULL si el índice es v2 y la clave
+   cabe. En IDX4MPH sin csv solo decide la huella de 16 bits. */
+int  trackidx_find(const TrackIdx *ti, const char *key, FILE *csv, uint64_t *out_off);
+
+/* ---- Construcción (build_idx / build_indexes) ---- */
+/* Crea un índice vacío mapeado en escritura (en IDX3SWT capacity se
+   redondea a múltiplo de SW_GROUP). */
+int  trackidx_create(TrackIdx *ti, const char *path, int format, uint64_t capacity, uint32_t key_col);
+/* Inserta (h, clave empaquetada, offset). En v2 un track_id repetido no
+   ocupa otro slot: se conserva el menor offset (primera aparición).
+   Devuelve 1 si ocupó un slot nuevo, 0 si era repetido. */
+int  trackidx_put(TrackIdx *ti, uint64_t h, uint64_t kind, const uint8_t key[16], uint64_t off);
+/* Igual que trackidx_put pero seguro con varios hilos insertando a la vez
+   (solo v1/v2; IDX3SWT se obtiene después con trackidx_write_swiss) */
+int  trackidx_put_concurrent(TrackIdx *ti, uint64_t h, uint64_t kind, const uint8_t key[16], uint64_t off);
+/* Después de los trackidx_put_concurrent (sin hilos insertando): las
+   entradas de un mismo hash que no se juntan en un slot (v1; en v2 las
+   TRK_KEY_NONE) quedan en el orden en que los hilos las tomaron. Las
+   reordena por offset dentro de su racha de slots, como quedan en la
+   construcción secuencial, para que trackidx_find dé la primera
+   aparición. 0 o -1 sin memoria. */
+int  trackidx_sort_chains(TrackIdx *ti);
+/* msync + cierre */
+int  trackidx_finish(TrackIdx *ti);
+/* Reescribe un índice v1/v2 como IDX3SWT con factor de carga lf (0 < lf < 1),
+   dimensionado por el número de track_id distintos. En v1 las claves se
+   leen del CSV (csv_path). Devuelve 0 o -1 con errno. */
+int  trackidx_write_swiss(const char *src_path, const char *csv_path, const char *dst_path, double lf);
+
+/* Reescribe un índice v2/swiss como IDX4MPH (solo lectura). Devuelve 0 o
+   -1 con errno (EINVAL si el origen es v1: sin claves no se deduplica). */
+int  trackidx_write_mph(const char *src_path, const char *dst_path);
+
+/* ---- Alta incremental (add_track) ----
+   Inserta key->offset en un índice existente, haciéndolo crecer si hace
+   falta (ver arriba). Serializa escritores con un lock fcntl sobre el índice.
+   Devuelve 0 o -1 con errno: EEXIST si el track_id ya está, EROFS si el
+   índice es IDX4MPH. */
+int  trackidx_insert(const char *idx_path, const char *csv_path, const char *key, uint64_t offset);
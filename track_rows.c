@@ -0,0 +1,372 @@
+/* track_rows.c
+   Historial por track_id (<tracks.idx>.rows): construcción y lectura.
+   Ver track_rows.h.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "track_rows.h"
+#include "track_idx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MAXF   256
+#define NPART  256
+#define RSLOTS 8192           // > 2 * TRK_ROWS_MAX_REGIONS
+
+/* Fila volcada durante la lectura (clave empaquetada como en IDX2TRK) */
+typedef struct {
+    uint64_t offset;          // offset | tipo de clave
+    uint8_t  key[16];
+    uint32_t date;
+    uint16_t region;
+    uint16_t pad;
+} RowSpill;
+
+/* Fila ya asociada a su track */
+typedef struct {
+    uint64_t first, offset;
+    uint32_t date;
+    uint16_t region, pad;
+} RowTuple;
+
+/* -------------------- util CSV -------------------- */
+static size_t parse_csv_line(const char *line, char **out, size_t max_fields){
+    size_t n=0, L=strlen(line), bi=0; int inq=0;
+    char *buf=(char*)malloc(L+1); if(!buf) return 0;
+    for(size_t i=0;i<L;i++){
+        char c=line[i];
+        if(c=='"'){
+            if(inq && i+1<L && line[i+1]=='"'){ buf[bi++]='"'; i++; }
+            else inq=!inq;
+        } else if(c==',' && !inq){
+            buf[bi]='\0'; if(n<max_fields) out[n++]=strdup(buf); bi=0;
+        } else if(c=='\r' || c=='\n'){
+            /* ignore */
+        } else {
+            buf[bi++]=c;
+        }
+    }
+    buf[bi]='\0'; if(n<max_fields) out[n++]=strdup(buf);
+    free(buf); return n;
+}
+static void free_fields(char **f, size_t n){ for(size_t i=0;i<n;i++) free(f[i]); }
+
+static int find_col(char **hdr, size_t n, const char *name){
+    for (size_t i=0;i<n;i++) if (hdr[i] && strcasecmp(hdr[i], name) == 0) return (int)i;
+    return -1;
+}
+
+/* ============================================================
+   Comunes
+   ============================================================ */
+uint32_t trackrows_parse_date(const char *s){
+    if (!s) return 0;
+    for (int i=0; i<10; i++){
+        if (i == 4 || i == 7){ if (s[i] != '-') return 0; }
+        else if (!isdigit((unsigned char)s[i])) return 0;
+    }
+    uint32_t y = (uint32_t)atoi(s), m = (uint32_t)atoi(s+5), d = (uint32_t)atoi(s+8);
+    return y * 10000u + m * 100u + d;
+}
+
+void trackrows_path(char *out, size_t sz, const char *idx_path){ snprintf(out, sz, "%s.rows", idx_path); }
+
+/* ============================================================
+   Lectura
+   ============================================================ */
+int trackrows_open(TrackRows *tr, const char *path){
+    memset(tr, 0, sizeof(*tr)); tr->fd = -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    off_t sz = lseek(fd, 0, SEEK_END);
+    if (sz < (off_t)sizeof(RowsHeader)){ close(fd); errno = EINVAL; return -1; }
+    void *map = mmap(NULL, (size_t)sz, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED){ int e=errno; close(fd); errno=e; return -1; }
+
+    const RowsHeader *h = (const RowsHeader*)map;
+    uint64_t rows_off = sizeof(RowsHeader) + (uint64_t)h->nregions * TRK_ROWS_REGION_LEN;
+    if (strncmp(h->magic, "IDXROWS", 7) != 0 || h->nregions > TRK_ROWS_MAX_REGIONS ||
+        h->nrows > ((uint64_t)sz >> 4) || h->ntracks > ((uint64_t)sz >> 4) ||
+        h->dir_off != rows_off + h->nrows * sizeof(RowEntry) ||
+        (uint64_t)sz < h->dir_off + h->ntracks * sizeof(RowsDir)){
+        munmap(map, (size_t)sz); close(fd); errno = EINVAL; return -1;
+    }
+    tr->fd = fd; tr->map = map; tr->size = (size_t)sz;
+    tr->ntracks  = h->ntracks;
+    tr->nrows    = h->nrows;
+    tr->nregions = h->nregions;
+    tr->regions  = (const char*)map + sizeof(RowsHeader);
+    tr->rows     = (const RowEntry*)((const unsigned char*)map + rows_off);
+    tr->dir      = (const RowsDir*)((const unsigned char*)map + h->dir_off);
+    return 0;
+}
+
+void trackrows_close(TrackRows *tr){
+    if (tr->map) munmap(tr->map, tr->size);
+    if (tr->fd >= 0) close(tr->fd);
+    tr->map = NULL; tr->fd = -1;
+}
+
+int trackrows_region(const TrackRows *tr, const char *name){
+    for (uint32_t i=0; i<tr->nregions; i++)
+        if (strncasecmp(tr->regions + (size_t)i * TRK_ROWS_REGION_LEN, name, TRK_ROWS_REGION_LEN - 1) == 0)
+            return (int)i;
+    return -1;
+}
+
+const RowEntry *trackrows_get(const TrackRows *tr, uint64_t first_off, uint64_t *n){
+    uint64_t lo = 0, hi = tr->ntracks;
+    while (lo < hi){
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (tr->dir[mid].first_off < first_off) lo = mid + 1; else hi = mid;
+    }
+    if (lo == tr->ntracks || tr->dir[lo].first_off != first_off){ *n = 0; return NULL; }
+    const RowsDir *d = &tr->dir[lo];
+    if (d->start > tr->nrows || d->count > tr->nrows - d->start){ *n = 0; return NULL; }
+    *n = d->count;
+    return tr->rows + d->start;
+}
+
+uint64_t trackrows_lower_date(const RowEntry *e, uint64_t n, uint32_t date){
+    uint64_t lo = 0, hi = n;
+    while (lo < hi){
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (e[mid].date < date) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/* ============================================================
+   Construcción
+   ============================================================ */
+static uint64_t name_hash(const char *s){
+    uint64_t h = 1469598103934665603ULL;
+    for (; *s; s++){ h ^= (unsigned char)*s; h *= 1099511628211ULL; }
+    return h;
+}
+
+/* Temporal junto al destino (no en /tmp: ocupa ~32 B por fila); se borra
+   al abrirlo y desaparece al cerrarlo */
+static FILE *open_tmp(const char *base, const char *suffix){
+    char tmp[700]; snprintf(tmp, sizeof(tmp), "%s.%s", base, suffix);
+    FILE *f = fopen(tmp, "w+b");
+    if (f) unlink(tmp);
+    return f;
+}
+
+int trackrows_begin(RowsBuilder *b, const char *rows_path){
+    memset(b, 0, sizeof(*b));
+    snprintf(b->path, sizeof(b->path), "%s", rows_path);
+    b->regions = (char*)calloc(TRK_ROWS_MAX_REGIONS, TRK_ROWS_REGION_LEN);
+    b->rslot   = (uint16_t*)calloc(RSLOTS, sizeof(uint16_t));
+    b->spill   = open_tmp(rows_path, "tmp");
+    if (!b->regions || !b->rslot || !b->spill){
+        int e = b->spill ? ENOMEM : errno;
+        trackrows_abort(b); errno = e; return -1;
+    }
+    setvbuf(b->spill, NULL, _IOFBF, 4*1024*1024);
+    return 0;
+}
+
+/* Id de la región (la agrega si es nueva) */
+static uint16_t region_id(RowsBuilder *b, const char *name){
+    if (!name || !name[0]) return TRK_ROWS_NO_REGION;
+    uint64_t i = name_hash(name) & (RSLOTS - 1);
+    for (;;){
+        uint16_t v = b->rslot[i];
+        if (v == 0) break;
+        if (strncmp(b->regions + (size_t)(v-1) * TRK_ROWS_REGION_LEN, name, TRK_ROWS_REGION_LEN - 1) == 0)
+            return (uint16_t)(v - 1);
+        i = (i + 1) & (RSLOTS - 1);
+    }
+    if (b->nregions == TRK_ROWS_MAX_REGIONS) return TRK_ROWS_NO_REGION;
+    snprintf(b->regions + (size_t)b->nregions * TRK_ROWS_REGION_LEN, TRK_ROWS_REGION_LEN, "%s", name);
+    b->rslot[i] = (uint16_t)(++b->nregions);
+    return (uint16_t)(b->nregions - 1);
+}
+
+int trackrows_add(RowsBuilder *b, const char *key, uint64_t off, const char *date, const char *region){
+    RowSpill r;
+    memset(&r, 0, sizeof(r));
+    r.offset = off | trk_pack_key(key, r.key);
+    r.date   = trackrows_parse_date(date);
+    r.region = region_id(b, region);
+    if (fwrite(&r, sizeof(r), 1, b->spill) != 1) return -1;
+    b->nrows++;
+    return 0;
+}
+
+void trackrows_abort(RowsBuilder *b){
+    if (b->spill) fclose(b->spill);
+    free(b->regions); free(b->rslot);
+    b->spill = NULL; b->regions = NULL; b->rslot = NULL;
+}
+
+/* Primera fila del track de r (la de tracks.idx) */
+static uint64_t resolve_first(const TrackIdx *ti, FILE *csv, const RowSpill *r){
+    uint64_t kind = r->offset & TRK_KEY_FLAGS, off = r->offset & TRK_OFF_MASK, first;
+    char key[24];
+    if (kind != TRK_KEY_NONE){
+        trk_unpack_key(kind, r->key, key);
+        /* El CSV solo hace falta para confirmar en v1 */
+        if (trackidx_find(ti, key, ti->format == TRK_FMT_V1 ? csv : NULL, &first)) return first;
+        return off;
+    }
+    /* Clave que no cabe en 16 bytes: leerla de la fila */
+    first = off;
+    char *line = NULL; size_t cap = 0;
+    if (fseeko(csv, (off_t)off, SEEK_SET) == 0 && getline(&line, &cap, csv) > 0){
+        char *f[MAXF] = {0}; size_t nf = parse_csv_line(line, f, MAXF);
+        if (ti->key_col < (uint32_t)nf && f[ti->key_col][0]) (void)trackidx_find(ti, f[ti->key_col], csv, &first);
+        free_fields(f, nf);
+    }
+    free(line);
+    return first;
+}
+
+static int cmp_tuple(const void *a, const void *b){
+    const RowTuple *x = (const RowTuple*)a, *y = (const RowTuple*)b;
+    if (x->first  != y->first)  return x->first  < y->first  ? -1 : 1;
+    if (x->date   != y->date)   return x->date   < y->date   ? -1 : 1;
+    if (x->region != y->region) return x->region < y->region ? -1 : 1;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+int trackrows_finish(RowsBuilder *b, const char *idx_path, const char *csv_path){
+    TrackIdx ti;
+    FILE *csv = NULL, *out = NULL, *part[NPART] = {0};
+    RowsDir *dir = NULL; size_t ndir = 0, dcap = 0;
+    RowTuple *buf = NULL;
+    int rc = -1;
+
+    if (fflush(b->spill) != 0 || fseeko(b->spill, 0, SEEK_SET) != 0){ trackrows_abort(b); return -1; }
+    if (trackidx_open(&ti, idx_path, 0) != 0){ trackrows_abort(b); return -1; }
+    csv = fopen(csv_path, "r");
+    struct stat st;
+    if (!csv || fstat(fileno(csv), &st) != 0) goto done;
+    uint64_t span = ((uint64_t)st.st_size >> 8) + 1;   // tramos por rango de first_off
+
+    for (int p=0; p<NPART; p++){
+        char sfx[8]; snprintf(sfx, sizeof(sfx), "b%02x", p);
+        if (!(part[p] = open_tmp(b->path, sfx))) goto done;
+    }
+
+    /* 1) Asociar cada fila a la primera de su track y repartir por tramos */
+    RowSpill r;
+    while (fread(&r, sizeof(r), 1, b->spill) == 1){
+        RowTuple t = { resolve_first(&ti, csv, &r), r.offset & TRK_OFF_MASK, r.date, r.region, 0 };
+        if (fwrite(&t, sizeof(t), 1, part[t.first / span < NPART ? t.first / span : NPART - 1]) != 1) goto done;
+    }
+
+    /* 2) Cabecera provisional y regiones */
+    out = fopen(b->path, "wb");
+    if (!out) goto done;
+    setvbuf(out, NULL, _IOFBF, 4*1024*1024);
+    RowsHeader h; memset(&h, 0, sizeof(h));
+    if (fwrite(&h, sizeof(h), 1, out) != 1) goto done;
+    if (b->nregions && fwrite(b->regions, TRK_ROWS_REGION_LEN, b->nregions, out) != b->nregions) goto done;
+
+    /* 3) Cada tramo ordenado en memoria: entradas y directorio */
+    uint64_t nrows = 0;
+    for (int p=0; p<NPART; p++){
+        off_t bytes = ftello(part[p]);
+        size_t n = (size_t)bytes / sizeof(RowTuple);
+        if (n == 0) continue;
+        RowTuple *nb = (RowTuple*)realloc(buf, n * sizeof(RowTuple));
+        if (!nb) goto done;
+        buf = nb;
+        if (fseeko(part[p], 0, SEEK_SET) != 0 || fread(buf, sizeof(RowTuple), n, part[p]) != n) goto done;
+        qsort(buf, n, sizeof(RowTuple), cmp_tuple);
+        for (size_t i=0; i<n; i++){
+            if (ndir == 0 || dir[ndir-1].first_off != buf[i].first){
+                if (ndir == dcap){
+                    size_t nc = dcap ? dcap * 2 : 4096;
+                    RowsDir *nd = (RowsDir*)realloc(dir, nc * sizeof(RowsDir));
+                    if (!nd) goto done;
+                    dir = nd; dcap = nc;
+                }
+                dir[ndir].first_off = buf[i].first; dir[ndir].start = nrows; dir[ndir].count = 0;
+                ndir++;
+            }
+            RowEntry e = { buf[i].offset, buf[i].date, buf[i].region, 0 };
+            if (fwrite(&e, sizeof(e), 1, out) != 1) goto done;
+            dir[ndir-1].count++;
+            nrows++;
+        }
+        fclose(part[p]); part[p] = NULL;
+    }
+
+    /* 4) Directorio y cabecera definitiva */
+    memcpy(h.magic, "IDXROWS", 7);
+    h.ntracks  = ndir;
+    h.nrows    = nrows;
+    h.dir_off  = sizeof(RowsHeader) + (uint64_t)b->nregions * TRK_ROWS_REGION_LEN + nrows * sizeof(RowEntry);
+    h.nregions = b->nregions;
+    h.version  = 1;
+    if (ndir && fwrite(dir, sizeof(RowsDir), ndir, out) != ndir) goto done;
+    if (fseeko(out, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, out) != 1) goto done;
+    rc = 0;
+
+done:;
+    int e = errno;
+    if (out && fclose(out) != 0 && rc == 0){ rc = -1; e = errno; }
+    if (rc != 0 && out) unlink(b->path);
+    for (int p=0; p<NPART; p++) if (part[p]) fclose(part[p]);
+    if (csv) fclose(csv);
+    free(buf); free(dir);
+    trackidx_close(&ti);
+    trackrows_abort(b);
+    errno = e;
+    return rc;
+}
+
+int trackrows_build(const char *csv_path, const char *idx_path){
+    FILE *fp = fopen(csv_path, "r");
+    if (!fp) return -1;
+    setvbuf(fp, NULL, _IOFBF, 4*1024*1024);
+
+    char *line = NULL; size_t bufcap = 0;
+    if (getline(&line, &bufcap, fp) <= 0){ free(line); fclose(fp); errno = EINVAL; return -1; }
+    char *hdr[MAXF] = {0};
+    size_t nf = parse_csv_line(line, hdr, MAXF);
+    int col_id = find_col(hdr, nf, "track_id");
+    int col_date = find_col(hdr, nf, "date");
+    int col_region = find_col(hdr, nf, "region");
+    free_fields(hdr, nf);
+    if (col_id < 0){ free(line); fclose(fp); errno = EINVAL; return -1; }
+    if (col_date < 0) col_date = 3;
+    if (col_region < 0) col_region = 6;
+
+    char rows_path[600]; trackrows_path(rows_path, sizeof(rows_path), idx_path);
+    RowsBuilder b;
+    if (trackrows_begin(&b, rows_path) != 0){ int e=errno; free(line); fclose(fp); errno=e; return -1; }
+
+    for (;;){
+        off_t off = ftello(fp);
+        if (getline(&line, &bufcap, fp) <= 0) break;
+        char *f[MAXF] = {0};
+        size_t nx = parse_csv_line(line, f, MAXF);
+        if (nx > (size_t)col_id && f[col_id][0]){
+            const char *date   = (size_t)col_date   < nx ? f[col_date]   : NULL;
+            const char *region = (size_t)col_region < nx ? f[col_region] : NULL;
+            if (trackrows_add(&b, f[col_id], (uint64_t)off, date, region) != 0){
+                int e=errno; free_fields(f, nx); free(line); fclose(fp); trackrows_abort(&b); errno=e; return -1;
+            }
+        }
+        free_fields(f, nx);
+    }
+    free(line); fclose(fp);
+    return trackrows_finish(&b, idx_path, csv_path);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+/* ============================================================
+   <tracks.idx>.rows: historial de cada track_id en los charts.
+   tracks.idx guarda una sola fila por track_id (la primera); aquí están
+   todas sus filas, agrupadas por track y ordenadas por (fecha, región,
+   offset), así que un rango de fechas es un tramo contiguo.
+
+   Cabecera (48 B) | regiones[nregions][TRK_ROWS_REGION_LEN]
+                   | entradas RowEntry[nrows] | directorio RowsDir[ntracks]
+   El directorio va ordenado por first_off (el offset que devuelve
+   tracks.idx) y se busca por búsqueda binaria.
+   ============================================================ */
+
+#define TRK_ROWS_REGION_LEN  48
+#define TRK_ROWS_MAX_REGIONS 4096
+#define TRK_ROWS_NO_REGION   0xFFFF
+
+typedef struct {
+    char     magic[8];      // "IDXROWS"
+    uint64_t ntracks;
+    uint64_t nrows;
+    uint64_t dir_off;       // posición del directorio en el archivo
+    uint32_t nregions;
+    uint32_t version;
+    uint64_t reserved;
+} __attribute__((packed)) RowsHeader;
+
+typedef struct {
+    uint64_t offset;        // fila en el CSV
+    uint32_t date;          // AAAAMMDD (0 = sin fecha)
+    uint16_t region;        // índice en la tabla de regiones (o TRK_ROWS_NO_REGION)
+    uint16_t pad;
+} RowEntry;
+
+typedef struct {
+    uint64_t first_off;     // offset de la primera fila (= tracks.idx)
+    uint64_t start;         // primera entrada
+    uint64_t count;
+} RowsDir;
+
+/* "AAAA-MM-DD" -> AAAAMMDD (0 si no tiene ese formato) */
+uint32_t trackrows_parse_date(const char *s);
+/* <idx>.rows */
+void     trackrows_path(char *out, size_t sz, const char *idx_path);
+
+/* ---- Lectura ---- */
+typedef struct {
+    int             fd;
+    unsigned char  *map;
+    size_t          size;
+    uint64_t        ntracks, nrows;
+    uint32_t        nregions;
+    const char     *regions;    // nregions * TRK_ROWS_REGION_LEN
+    const RowEntry *rows;
+    const RowsDir  *dir;
+} TrackRows;
+
+/* 0 o -1 con errno (EINVAL = formato desconocido) */
+int  trackrows_open(TrackRows *tr, const char *path);
+void trackrows_close(TrackRows *tr);
+/* Id de la región (comparación sin distinguir mayúsculas) o -1 */
+int  trackrows_region(const TrackRows *tr, const char *name);
+/* Filas del track cuya primera fila está en first_off (NULL y *n=0 si no
+   figura: por ejemplo, un track agregado con ADD después del build) */
+const RowEntry *trackrows_get(const TrackRows *tr, uint64_t first_off, uint64_t *n);
+/* Primera entrada con fecha >= date (e ordenado como en el archivo) */
+uint64_t trackrows_lower_date(const RowEntry *e, uint64_t n, uint32_t date);
+
+/* ---- Construcción ----
+   Las filas se vuelcan a <rows>.tmp durante la lectura del CSV; al final
+   cada una se asocia a la primera fila de su track (buscándola en
+   tracks.idx), se reparten por rango de first_off en 256 tramos y cada
+   tramo se ordena en memoria. */
+typedef struct {
+    char      path[600];
+    FILE     *spill;
+    uint64_t  nrows;
+    uint32_t  nregions;
+    char     *regions;           // TRK_ROWS_MAX_REGIONS * TRK_ROWS_REGION_LEN
+    uint16_t *rslot;             // tabla hash nombre -> id+1
+} RowsBuilder;
+
+int  trackrows_begin(RowsBuilder *b, const char *rows_path);
+int  trackrows_add(RowsBuilder *b, const char *key, uint64_t off, const char *date, const char *region);
+/* Escribe el archivo; tracks.idx ya debe estar construido. 0 o -1. */
+int  trackrows_finish(RowsBuilder *b, const char *idx_path, const char *csv_path);
+void trackrows_abort(RowsBuilder *b);
+
+/* Construcción completa con una lectura propia del CSV (build_idx -r) */
+int  trackrows_build(const char *csv_path, const char *idx_path);
@@ -1,10 +1,21 @@
 /* track_server.c
    Servidor TCP:
      - ADD|track_id|name|artist|album|duration_ms -> inserta en CSV e indices
-     - SEARCH|w1[|w2][|w3] -> busca por palabras (name/artist), base+delta, recientes primero
+     - SEARCH|consulta[|...][|DATE=d][|REGION=r][|LIMIT=n][|CURSOR=c] -> busca por
+       palabras (name/artist), base+delta, recientes primero, de a páginas; los campos
+       forman una consulta con AND implícito, OR, NOT / -palabra y paréntesis
+       (name_query.h). DATE (AAAA, AAAA-MM, AAAA-MM-DD o desde..hasta) y REGION
+       filtran las filas; las zonas de nameidx/zones.map saltan tramos enteros.
+     - TOP|region|desde|hasta|n -> los n tracks con más streams en la región
+       (o * = todas) entre dos fechas AAAA-MM-DD, sobre el snapshot columnar
+       (build_cols, cols_top.h)
    Respuestas:
      - ADD:    OK <offset>\n  | ERR <mensaje>\n
-     - SEARCH: OK <N>\n <linea_compacta>... END\n | ERR <mensaje>\n
+     - SEARCH: OK <N>\n <linea_compacta>... [NEXT <cursor>\n] END\n | ERR <mensaje>\n
+       (NEXT si quedan más: se pide la página siguiente con CURSOR=<cursor>)
+     - TOP:    OK <N>\n <track_id | nombre | artista | streams>... END\n | ERR <mensaje>\n
+   Las líneas de SEARCH salen de nameidx/docs.seg (docstore.h); el CSV solo
+   se lee para las filas agregadas con ADD después del build.
 */
 
 #define _FILE_OFFSET_BITS 64
@@ -27,6 +38,14 @@
 #include <fcntl.h>
 #include <stdarg.h>   // <-- NECESARIO para va_list, va_start, va_end
 #include "add_track.h"
+#include "radix_sort.h"
+#include "nameidx_dir.h"
+#include "name_query.h"
+#include "docstore.h"
+#include "zonemap.h"
+#include "colstore.h"
+#include "cols_top.h"
+#include "track_rows.h"
 
 #ifndef SERVER_PORT
 #define SERVER_PORT 5555
@@ -34,7 +53,8 @@
 
 #define RECV_BUF 8192
 #define NBKT 256
-#define MAX_SHOW 20
+#define MAX_SHOW 20            // página por defecto de SEARCH
+#define MAX_PAGE 1000          // LIMIT máximo
 
 /* ----------------- Utils ------------------ */
 static void trim_crlf(char *s) {
@@ -113,7 +133,7 @@ static void ensure_dir(const char *path){
     struct stat st; if (stat(path,&st)==0 && S_ISDIR(st.st_mode)) return;
     mkdir(path, 0775);
 }
-static int append_nameidx_delta(const char *namedir, const char *token, uint64_t offset){
+static int append_nameidx_delta(const char *namedir, const char *token, uint32_t row){
     if(!token || !*token) return 0;
     uint64_t h = fnv1a64(token);
     char updir[512];
@@ -125,16 +145,16 @@ static int append_nameidx_delta(const char *namedir, const char *token, uint64_t
     int nw = snprintf(path, sizeof path, "%s/b%02x.log", updir, b & 0xFF);
     if (nw < 0 || (size_t)nw >= sizeof path) { errno = ENAMETOOLONG; return -1; }
     FILE *f = fopen(path, "ab"); if (!f) return -1;
-    fprintf(f, "%016" PRIx64 " %" PRIu64 "\n", h, offset);
+    fprintf(f, "%016" PRIx64 " %" PRIu32 "\n", h, row);
     fclose(f);
     return 0;
 }
-static void record_nameidx_updates(const char *namedir, const char *name, const char *artist, uint64_t offset){
+static void record_nameidx_updates(const char *namedir, const char *name, const char *artist, uint32_t row){
     char *n1 = normalize_utf8_basic(name);
     char *n2 = normalize_utf8_basic(artist);
     char **t1=NULL, **t2=NULL; size_t k1=tokenize_simple(n1,&t1), k2=tokenize_simple(n2,&t2);
-    for(size_t i=0;i<k1;i++){ append_nameidx_delta(namedir, t1[i], offset); free(t1[i]); }
-    for(size_t i=0;i<k2;i++){ append_nameidx_delta(namedir, t2[i], offset); free(t2[i]); }
+    for(size_t i=0;i<k1;i++){ append_nameidx_delta(namedir, t1[i], row); free(t1[i]); }
+    for(size_t i=0;i<k2;i++){ append_nameidx_delta(namedir, t2[i], row); free(t2[i]); }
     free(t1); free(t2); free(n1); free(n2);
 }
 
@@ -188,40 +208,27 @@ static void print_compact_line_to_fd(int fd, const char *line){
     send_fmt(fd, "%s | %s | %s | %s | %s\n", id, name, art, date, reg);
     free_fields(f,nx);
 }
+/* La misma línea desde docs.seg (sin copiar los campos) */
+static void send_doc(int fd, const DocView *v){
+    send_fmt(fd, "%.*s | %.*s | %.*s | %.*s | %.*s\n", v->id.len, v->id.s, v->name.len, v->name.s,
+             v->artist.len, v->artist.s, v->date.len, v->date.s, v->region.len, v->region.s);
+}
 
 /* ----------------- Postings base + delta + merge + AND ------------------ */
-static int cmp_u64(const void *a, const void *b){
-    const uint64_t A = *(const uint64_t*)a;
-    const uint64_t B = *(const uint64_t*)b;
-    if (A < B) return -1;
-    else if (A > B) return 1;
-    else return 0;
-}
-static uint64_t *load_postings_base(const char *dir, uint64_t h, size_t *out_n){
-    int b=(int)(h & (NBKT-1));
-    char path[512]; snprintf(path,sizeof(path),"%s/b%02x.idx",dir,b);
-    FILE *f=fopen(path,"rb"); if(!f){ *out_n=0; return NULL; }
-    for(;;){
-        uint64_t hh; uint32_t df, pad;
-        if (fread(&hh,8,1,f)!=1) break;
-        if (fread(&df,4,1,f)!=1) break;
-        if (fread(&pad,4,1,f)!=1) break;
-        if (hh==h){
-            uint64_t *arr=malloc((size_t)df*sizeof(uint64_t));
-            if (!arr){ fclose(f); *out_n=0; return NULL; }
-            if (fread(arr,8,df,f)!=(size_t)df){ free(arr); fclose(f); *out_n=0; return NULL; }
-            fclose(f); *out_n=df; return arr;
-        } else {
-            if (fseeko(f,(off_t)df*8,SEEK_CUR)!=0) break;
-        }
-    }
-    fclose(f); *out_n=0; return NULL;
-}
-static uint64_t *load_postings_delta(const char *dir, uint64_t h, size_t *out_n){
+/* Buckets de nameidx abiertos (directorio mapeado) durante toda la vida del servidor */
+static NameIdxReader g_names;
+/* docs.seg mapeado (columnas de cada fila del build) */
+static DocStore g_docs;
+/* Snapshot columnar (TOP); cols_open falló si nrows = 0 */
+static ColStore g_cols;
+/* zones.map mapeado (filtros DATE / REGION de SEARCH); vacío si no está */
+static ZoneMap g_zones;
+
+static uint32_t *load_postings_delta(const char *dir, uint64_t h, size_t *out_n){
     int b=(int)(h & (NBKT-1));
     char path[512]; snprintf(path,sizeof(path),"%s/updates/b%02x.log",dir,b);
     FILE *f=fopen(path,"rb"); if(!f){ *out_n=0; return NULL; }
-    size_t cap=128,n=0; uint64_t *arr=malloc(cap*sizeof(uint64_t));
+    size_t cap=128,n=0; uint32_t *arr=malloc(cap*sizeof(uint32_t));
     char *line=NULL; size_t L=0; ssize_t len;
     while ((len=getline(&line,&L,f))>0){
         if (len<18) continue;
@@ -229,35 +236,18 @@ static uint64_t *load_postings_delta(const char *dir, uint64_t h, size_t *out_n)
         uint64_t hh=0; if (sscanf(hex,"%16" SCNx64, &hh)!=1) continue;
         if (hh!=h) continue;
         char *sp=strchr(line,' '); if (!sp) continue;
-        uint64_t off=0; if (sscanf(sp+1,"%" SCNu64, &off)!=1) continue;
-        if (n==cap){ cap*=2; arr=realloc(arr,cap*sizeof(uint64_t)); }
-        arr[n++]=off;
+        uint32_t row=0; if (sscanf(sp+1,"%" SCNu32, &row)!=1) continue;
+        if (n==cap){ cap*=2; arr=realloc(arr,cap*sizeof(uint32_t)); }
+        arr[n++]=row;
     }
     free(line); fclose(f);
     if (n>1){
-        qsort(arr,n,sizeof(uint64_t),cmp_u64);
+        radix_sort_u32(arr,n,NULL);
         size_t m=0; for(size_t i=0;i<n;i++){ if (m==0 || arr[i]!=arr[m-1]) arr[m++]=arr[i]; }
         n=m;
     }
     *out_n=n; return arr;
 }
-static uint64_t *merge_base_delta(const uint64_t *base,size_t nb,const uint64_t *del,size_t nd,size_t *nout){
-    uint64_t *r=malloc(((nb+nd)?(nb+nd):1)*sizeof(uint64_t));
-    size_t i=0,j=0,k=0;
-    while(i<nb && j<nd){
-        if (base[i] < del[j]) r[k++]=base[i++];
-        else if (del[j] < base[i]) r[k++]=del[j++];
-        else { r[k++]=base[i]; i++; j++; }
-    }
-    while(i<nb) r[k++]=base[i++];
-    while(j<nd) r[k++]=del[j++];
-    *nout=k; return r;
-}
-static uint64_t *intersect(const uint64_t *a,size_t na,const uint64_t *b,size_t nb,size_t *nc){
-    size_t i=0,j=0,cap=(na<nb?na:nb),n=0; uint64_t *c=malloc((cap?cap:1)*sizeof(uint64_t));
-    while(i<na && j<nb){ if(a[i]==b[j]){ c[n++]=a[i]; i++; j++; } else if(a[i]<b[j]) i++; else j++; }
-    *nc=n; return c;
-}
 
 /* ----------------- Manejo de comandos ------------------ */
 static void handle_ADD(int cfd, const char *csv_path, const char *idx_path, const char *namedir,
@@ -266,68 +256,193 @@ static void handle_ADD(int cfd, const char *csv_path, const char *idx_path, cons
     TrackRecord rec = { .track_id=f[1], .name=f[2], .artist=f[3], .album=f[4], .duration_ms=f[5] };
     long ofs=-1; char err[256];
     if (add_track_and_index(csv_path, idx_path, &rec, &ofs, err, sizeof err)) {
-        record_nameidx_updates(namedir, rec.name, rec.artist, (uint64_t)ofs);
+        /* Número de fila nuevo en rows.off; el delta guarda la fila */
+        uint32_t row;
+        ensure_dir(namedir);
+        if (nameidx_rows_append(namedir, (uint64_t)ofs, &row) == 0)
+            record_nameidx_updates(namedir, rec.name, rec.artist, row);
+        else
+            fprintf(stderr, "Aviso: alta en offset %ld sin indexar por nombre (%s)\n", ofs, strerror(errno));
         send_fmt(cfd, "OK %ld\n", ofs);
     } else {
         if (errno==EEXIST) send_str(cfd, "ERR track_id ya existe\n");
         else send_fmt(cfd, "ERR %s\n", err);
     }
 }
-static void handle_SEARCH(int cfd, const char *csv_path, const char *namedir, char *f[], int k){
-    if (k < 2){ send_str(cfd, "ERR uso: SEARCH|palabra1[|palabra2][|palabra3]\n"); return; }
-
-    /* preparar lista de postings fusionados (base+delta) para cada palabra y hacer AND */
-    uint64_t *post=NULL; size_t pn=0;
-
-    for (int qi=1; qi<k && qi<=3; ++qi){
-        char *norm = normalize_utf8_basic(f[qi]);
-        char **toks=NULL; size_t ntok=tokenize_simple(norm,&toks); free(norm);
-        if (ntok==0){ free(toks); continue; }
-
-        uint64_t h = fnv1a64(toks[0]);               /* usamos el primer token */
-        for(size_t t=0;t<ntok;t++) free(toks[t]);
-        free(toks);
-
-        size_t nb=0, nd=0, nn=0;
-        uint64_t *base = load_postings_base(namedir, h, &nb);
-        uint64_t *delt = load_postings_delta(namedir, h, &nd);
-        uint64_t *tp = NULL;
-
-        if (base && delt){ tp = merge_base_delta(base,nb,delt,nd,&nn); free(base); free(delt); }
-        else if (base){ tp=base; nn=nb; }
-        else if (delt){ tp=delt; nn=nd; }
-        else { tp=NULL; nn=0; }
-
-        if (qi==1){ post=tp; pn=nn; }
-        else {
-            size_t cn=0; uint64_t *cp=intersect(post,pn,tp,nn,&cn);
-            free(post); free(tp); post=cp; pn=cn;
-        }
-        if (pn==0) break;
-    }
-
-    if (!post || pn==0){ send_str(cfd, "OK 0\nEND\n"); free(post); return; }
+/* Cursor de SEARCH: la última fila entregada, en hex (el cliente no lo
+   interpreta). Las filas nuevas (ADD) quedan por encima, así que las
+   páginas siguientes no cambian. */
+static int parse_cursor(const char *s, uint32_t *row){
+    char *end;
+    size_t len = strlen(s);
+    if (len == 0 || len > 8) return -1;
+    errno = 0;
+    unsigned long v = strtoul(s, &end, 16);
+    if (errno || *end || !isxdigit((unsigned char)s[0])) return -1;
+    *row = (uint32_t)v;
+    return 0;
+}
 
-    /* abrir CSV y emitir últimos MAX_SHOW (recientes primero) */
-    FILE *fp=fopen(csv_path,"r");
-    if (!fp){ send_fmt(cfd,"ERR CSV: %s\n", strerror(errno)); free(post); return; }
+/* Términos de la consulta: todos los tokens de cada palabra, base + delta */
+static size_t word_terms(void *ctx, const char *word, uint64_t *h, size_t max){
+    (void)ctx;
+    char *norm = normalize_utf8_basic(word);
+    char **toks=NULL; size_t ntok=tokenize_simple(norm,&toks); free(norm);
+    for(size_t t=0;t<ntok;t++){
+        if (t<max) h[t] = fnv1a64(toks[t]);
+        free(toks[t]);
+    }
+    free(toks);
+    return ntok;
+}
+static void word_postings(void *ctx, uint64_t h, NamePostings *p){
+    const char *namedir = ctx;
+    size_t nd=0;
+    nameidx_postings(&g_names, h, p);
+    uint32_t *delt = load_postings_delta(namedir, h, &nd);
+    if (nameidx_postings_merge(p, delt, nd) != 0) p->n = 0;
+    free(delt);
+}
 
-    /* cargar header para columnas */
-    load_cols_once(csv_path);
+/* Filtro DATE / REGION de SEARCH: zonas y docs.seg; el CSV solo para las
+   filas de ADD (queda abierto para mostrar la página) */
+typedef struct {
+    ZoneFilter  zf;
+    const char *csv_path;
+    FILE       *fp;
+} SearchFilter;
 
-    size_t start = (pn>MAX_SHOW)?(pn-MAX_SHOW):0;
-    size_t count = (pn-start);
-    send_fmt(cfd, "OK %zu\n", count>MAX_SHOW?MAX_SHOW:count);
+static int filter_prev(void *ctx, uint32_t x, uint32_t *out){
+    return zones_prev(&((SearchFilter*)ctx)->zf, x, out);
+}
+static int filter_keep(void *ctx, uint32_t row){
+    SearchFilter *sf = ctx;
+    int r = zones_row(&sf->zf, row);
+    if (r >= 0) return r;
+    uint64_t off;
+    if (!sf->fp && !(sf->fp=fopen(sf->csv_path,"r"))) return 0;
+    if (nameidx_row_offset(&g_names,row,&off)!=0 || fseeko(sf->fp,(off_t)off,SEEK_SET)!=0) return 0;
+    char *line=NULL; size_t cap=0;
+    if (getline(&line,&cap,sf->fp)<=0){ free(line); return 0; }
+    char *fl[256]={0}; size_t nx=parse_csv_line(line,fl,256);
+    free(line);
+    int ok = 0;
+    if (nx != 5 && gcols.date < (int)nx && gcols.region < (int)nx && fl[gcols.date] && fl[gcols.region])
+        ok = zones_match(&sf->zf, fl[gcols.date], strlen(fl[gcols.date]), fl[gcols.region], strlen(fl[gcols.region]));
+    free_fields(fl,nx);
+    return ok;
+}
 
-    size_t emitted=0;
-    for (ssize_t idx=(ssize_t)pn-1; idx>=(ssize_t)start && emitted<MAX_SHOW; --idx){
-        if (fseeko(fp,(off_t)post[idx],SEEK_SET)!=0) continue;
+static void handle_SEARCH(int cfd, const char *csv_path, const char *namedir, char *f[], int k){
+    if (k < 2){ send_str(cfd, "ERR uso: SEARCH|consulta[|...][|DATE=d][|REGION=r][|LIMIT=n][|CURSOR=c]\n"); return; }
+
+    /* opciones (DATE=, REGION=, LIMIT=, CURSOR=) y el resto de los campos como consulta */
+    size_t limit = MAX_SHOW;
+    uint32_t max = UINT32_MAX;             // filas <= max (página siguiente a CURSOR)
+    uint32_t from = 0, to = UINT32_MAX;
+    const char *region = NULL;
+    char text[RECV_BUF]; size_t L=0;
+    text[0] = 0;
+    for (int i=1; i<k; ++i){
+        if (!strncasecmp(f[i], "DATE=", 5)){
+            if (zones_parse_dates(f[i]+5, &from, &to) != 0){ send_str(cfd, "ERR DATE: AAAA, AAAA-MM, AAAA-MM-DD o desde..hasta\n"); return; }
+        } else if (!strncasecmp(f[i], "REGION=", 7)){
+            if (!f[i][7]){ send_str(cfd, "ERR REGION vacía\n"); return; }
+            region = f[i]+7;
+        } else if (!strncasecmp(f[i], "LIMIT=", 6)){
+            char *end; long v = strtol(f[i]+6, &end, 10);
+            if (end == f[i]+6 || *end || v < 1 || v > MAX_PAGE){ send_fmt(cfd, "ERR LIMIT entre 1 y %d\n", MAX_PAGE); return; }
+            limit = (size_t)v;
+        } else if (!strncasecmp(f[i], "CURSOR=", 7)){
+            uint32_t row;
+            if (parse_cursor(f[i]+7, &row) != 0){ send_str(cfd, "ERR cursor inválido\n"); return; }
+            if (row == 0){ send_str(cfd, "OK 0\nEND\n"); return; }
+            max = row - 1;
+        } else
+            L += (size_t)snprintf(text+L, sizeof(text)-L, "%s%s", L?" ":"", f[i]);
+    }
+    if (L == 0){ send_str(cfd, "ERR uso: SEARCH|consulta[|...][|DATE=d][|REGION=r][|LIMIT=n][|CURSOR=c]\n"); return; }
+
+    /* filtro: una región que ninguna fila del build tiene no puede salir
+       (las filas de ADD no llevan región) */
+    SearchFilter sf = { .csv_path = csv_path };
+    int filtered = region || from > 0 || to < UINT32_MAX;
+    if (filtered && zones_filter_init(&sf.zf, &g_zones, &g_docs, from, to, region) != 0){
+        zones_filter_free(&sf.zf);
+        if (errno == ENOENT) send_str(cfd, "OK 0\nEND\n");
+        else send_str(cfd, "ERR memoria\n");
+        return;
+    }
+    NameQueryFilter nf = { &sf, filter_prev, filter_keep };
+
+    /* postings de cada término (base de names.seg + delta) y el plan; las
+       listas largas de la base quedan como Roaring o con saltos */
+    NameQuerySource src = { (void*)namedir, word_terms, word_postings };
+    char err[128];
+    NameQuery *q = name_query_parse(text, &src, err, sizeof(err));
+    if (!q){ send_fmt(cfd, "ERR consulta: %s\n", err); zones_filter_free(&sf.zf); return; }
+    if (filtered) name_query_filter(q, &nf);
+
+    /* una página desde el cursor: AND desde el final, ya en orden; una
+       fila de más dice si hay página siguiente */
+    uint32_t *post = malloc((limit + 1) * sizeof(uint32_t));
+    size_t pn = post ? name_query_last(q, max, limit + 1, post) : 0;
+    name_query_free(q);
+    zones_filter_free(&sf.zf);
+    FILE *fp=sf.fp;
+    if (!post){ send_str(cfd, "ERR memoria\n"); if (fp) fclose(fp); return; }
+
+    if (pn==0){ send_str(cfd, "OK 0\nEND\n"); free(post); if (fp) fclose(fp); return; }
+    int more = pn > limit;
+    if (more) pn = limit;
+
+    send_fmt(cfd, "OK %zu\n", pn);
+
+    /* docs.seg; el CSV (abierto al primer uso) solo para filas de ADD */
+    for (size_t idx=0; idx<pn; ++idx){
+        DocView v;
+        if (docs_get(&g_docs, post[idx], &v)){ send_doc(cfd, &v); continue; }
+        if (!fp && !(fp=fopen(csv_path,"r"))) continue;
+        uint64_t off;
+        if (nameidx_row_offset(&g_names,post[idx],&off)!=0 || fseeko(fp,(off_t)off,SEEK_SET)!=0) continue;
         char *line=NULL; size_t cap=0; ssize_t len=getline(&line,&cap,fp);
-        if (len>0){ print_compact_line_to_fd(cfd, line); emitted++; }
+        if (len>0) print_compact_line_to_fd(cfd, line);
         free(line);
     }
+    if (more) send_fmt(cfd, "NEXT %08" PRIx32 "\n", post[pn-1]);
+    send_str(cfd, "END\n");
+    if (fp) fclose(fp);
+    free(post);
+}
+
+/* TOP|region|desde|hasta|n: agregación sobre el snapshot, en varios hilos */
+static void handle_TOP(int cfd, char *f[], int k){
+    if (k < 5){ send_str(cfd, "ERR uso: TOP|region|desde|hasta|n\n"); return; }
+    if (!g_cols.nrows){ send_str(cfd, "ERR sin snapshot columnar (make cols)\n"); return; }
+    int64_t rg = -1;
+    if (strcmp(f[1], "*") != 0 && (rg = cols_dict_find(&g_cols.regions, f[1])) < 0){
+        send_fmt(cfd, "ERR región desconocida: %s\n", f[1]); return;
+    }
+    int32_t from = (int32_t)trackrows_parse_date(f[2]), to = (int32_t)trackrows_parse_date(f[3]);
+    if (!from || !to || from > to){ send_str(cfd, "ERR fechas AAAA-MM-DD (desde <= hasta)\n"); return; }
+    char *end; long n = strtol(f[4], &end, 10);
+    if (end == f[4] || *end || n < 1 || n > COLS_TOP_MAX){ send_fmt(cfd, "ERR n entre 1 y %d\n", COLS_TOP_MAX); return; }
+
+    ColsTopEntry *top = malloc((size_t)n * sizeof(*top));
+    long got = top ? cols_top(&g_cols, rg, from, to, (size_t)n, 0, top) : -1;
+    if (got < 0){ send_str(cfd, "ERR memoria\n"); free(top); return; }
+
+    send_fmt(cfd, "OK %ld\n", got);
+    for (long i=0; i<got; i++){
+        char id[24];
+        int ln, la, lt;
+        const char *name = cols_str(&g_cols.names, g_cols.name[top[i].row], &ln);
+        const char *art  = cols_str(&g_cols.artists, g_cols.artist[top[i].row], &la);
+        const char *tid  = cols_track_id(&g_cols, top[i].row, id, &lt);
+        send_fmt(cfd, "%.*s | %.*s | %.*s | %" PRIu64 "\n", lt, tid, ln, name, la, art, top[i].streams);
+    }
     send_str(cfd, "END\n");
-    fclose(fp); free(post);
+    free(top);
 }
 
 /* ----------------- Handler conexión ------------------ */
@@ -337,12 +452,13 @@ static void handle_client(int cfd, const char *csv_path, const char *idx_path, c
     if (n <= 0) return;
     buf[n] = '\0'; trim_crlf(buf);
 
-    char *f[8]={0};
-    int k = split_fields(buf, f, 8);
+    char *f[16]={0};
+    int k = split_fields(buf, f, 16);
     if (k < 1 || !f[0]) { send_str(cfd, "ERR comando\n"); return; }
 
     if      (!strcasecmp(f[0],"ADD"))    handle_ADD(cfd, csv_path, idx_path, namedir, f, k);
     else if (!strcasecmp(f[0],"SEARCH")) handle_SEARCH(cfd, csv_path, namedir, f, k);
+    else if (!strcasecmp(f[0],"TOP"))    handle_TOP(cfd, f, k);
     else                                 send_str(cfd, "ERR comando no soportado\n");
 }
 
@@ -352,8 +468,18 @@ int main(int argc, char **argv) {
     const char *idx_path = (argc > 2 ? argv[2] : "tracks.idx");
     const char *namedir  = (argc > 3 ? argv[3] : "nameidx");
     int port             = (argc > 4 ? atoi(argv[4]) : SERVER_PORT);
+    const char *colsdir  = (argc > 5 ? argv[5] : "cols");
 
     signal(SIGPIPE, SIG_IGN);
+    load_cols_once(csv_path);      /* columnas del header, una vez (el header no cambia con ADD) */
+    nameidx_reader_init(&g_names, namedir);
+    if (docs_open(&g_docs, namedir) != 0 && errno == ENOENT)
+        fprintf(stderr, "Aviso: falta %s/" DOCS_NAME "; SEARCH lee los resultados del CSV (reconstruye el índice)\n", namedir);
+    if (zones_open(&g_zones, namedir) != 0 && errno == ENOENT)
+        fprintf(stderr, "Aviso: falta %s/" ZONES_NAME "; DATE y REGION prueban fila a fila (reconstruye el índice)\n", namedir);
+    if (cols_open(&g_cols, colsdir) != 0)
+        fprintf(stderr, "Aviso: sin snapshot columnar en %s/ (%s); TOP no está disponible (make cols)\n",
+                colsdir, strerror(errno));
 
     int sfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sfd < 0) { perror("socket"); return 1; }
@@ -366,8 +492,8 @@ int main(int argc, char **argv) {
     if (bind(sfd, (struct sockaddr*)&a, sizeof a) < 0) { perror("bind"); close(sfd); return 1; }
     if (listen(sfd, 16) < 0) { perror("listen"); close(sfd); return 1; }
 
-    fprintf(stderr,"track_server escuchando en puerto %d (CSV=%s IDX=%s NAMEIDX=%s)\n",
-            port, csv_path, idx_path, namedir);
+    fprintf(stderr,"track_server escuchando en puerto %d (CSV=%s IDX=%s NAMEIDX=%s COLS=%s)\n",
+            port, csv_path, idx_path, namedir, colsdir);
 
     for (;;) {
         int cfd = accept(sfd, NULL, NULL);
@@ -0,0 +1,327 @@
+// zonemap.c
+// nameidx/zones.map: fecha mínima/máxima y regiones por tramo de filas
+// (formato en zonemap.h)
+
+#define _POSIX_C_SOURCE 200809L
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "zonemap.h"
+
+/* "AAAA-MM-DD" de exactamente n = 10 bytes -> AAAAMMDD (0 si no) */
+static uint32_t ymd(const char *s, size_t n){
+    if (n != 10) return 0;
+    uint32_t v = 0;
+    for (int i=0; i<10; i++){
+        if (i == 4 || i == 7){ if (s[i] != '-') return 0; continue; }
+        if (!isdigit((unsigned char)s[i])) return 0;
+        v = v * 10 + (uint32_t)(s[i] - '0');
+    }
+    return v;
+}
+
+static inline void mask_set(uint64_t m[2], uint64_t id){
+    uint64_t b = id < ZONES_MASK_BITS - 1 ? id : ZONES_MASK_BITS - 1;
+    m[b >> 6] |= 1ULL << (b & 63);
+}
+
+static void zone_reset(ZoneEntry *e){
+    memset(e, 0, sizeof(*e));
+    e->dmin = UINT32_MAX;
+}
+
+/* ---------- Construcción ---------- */
+static uint64_t name_hash(const char *s){
+    uint64_t h = 1469598103934665603ULL;
+    for (; *s; s++){ h ^= (unsigned char)tolower((unsigned char)*s); h *= 1099511628211ULL; }
+    return h;
+}
+
+static int slots_rehash(ZonesBuilder *b){
+    size_t nn = b->nslot ? b->nslot * 2 : 256;
+    uint32_t *ns = (uint32_t*)calloc(nn, sizeof(uint32_t));
+    if (!ns) return -1;
+    for (size_t i=0; i<b->nnames; i++){
+        size_t j = (size_t)name_hash(b->names[i]) & (nn - 1);
+        while (ns[j]) j = (j + 1) & (nn - 1);
+        ns[j] = (uint32_t)i + 1;
+    }
+    free(b->slot);
+    b->slot = ns; b->nslot = nn;
+    return 0;
+}
+
+/* Id de la región (exacta), nueva si no estaba; -1 si no cabe */
+static int64_t region_id(ZonesBuilder *b, const char *s){
+    size_t j = (size_t)name_hash(s) & (b->nslot - 1);
+    for (; b->slot[j]; j = (j + 1) & (b->nslot - 1))
+        if (strcmp(b->names[b->slot[j] - 1], s) == 0) return (int64_t)b->slot[j] - 1;
+    if (b->nnames == ZONES_MAX_REGIONS){ errno = ERANGE; return -1; }
+    if (b->nnames == b->ncap){
+        size_t nc = b->ncap ? b->ncap * 2 : 64;
+        char **nv = (char**)realloc(b->names, nc * sizeof(*nv));
+        if (!nv) return -1;
+        b->names = nv; b->ncap = nc;
+    }
+    char *copy = strdup(s);
+    if (!copy) return -1;
+    b->names[b->nnames++] = copy;
+    b->slot[j] = (uint32_t)b->nnames;
+    if (b->nnames * 2 > b->nslot && slots_rehash(b) != 0) return -1;
+    return (int64_t)b->nnames - 1;
+}
+
+int zones_begin(ZonesBuilder *b, const char *dir){
+    memset(b, 0, sizeof(*b));
+    snprintf(b->path, sizeof(b->path), "%s/" ZONES_NAME, dir);
+    snprintf(b->tmp, sizeof(b->tmp), "%s.tmp", b->path);
+    unlink(b->path);                       // no dejar uno viejo junto a un rows.off nuevo
+    zone_reset(&b->cur);
+    if (slots_rehash(b) != 0) return -1;
+    b->f = fopen(b->tmp, "wb");
+    if (!b->f){ zones_abort(b); return -1; }
+    ZonesHeader hd; memset(&hd, 0, sizeof(hd));
+    if (fwrite(&hd, sizeof(hd), 1, b->f) != 1){ zones_abort(b); return -1; }
+    return 0;
+}
+
+static void zone_flush(ZonesBuilder *b){
+    if (fwrite(&b->cur, sizeof(b->cur), 1, b->f) != 1) b->err = errno;
+    b->nzones++;
+    zone_reset(&b->cur);
+}
+
+void zones_add(ZonesBuilder *b, const char *date, const char *region){
+    if (b->err) return;
+    uint32_t d = date ? ymd(date, strlen(date)) : 0;
+    int64_t rg = region && *region ? region_id(b, region) : -2;
+    if (rg == -1){ b->err = errno ? errno : ENOMEM; return; }
+    if (d){
+        if (d < b->cur.dmin) b->cur.dmin = d;
+        if (d > b->cur.dmax) b->cur.dmax = d;
+    }
+    if (rg >= 0) mask_set(b->cur.rmask, (uint64_t)rg);
+    if (!d || rg < 0) b->cur.flags |= ZONE_PARTIAL;
+    if (++b->nrows % ZONES_BLOCK == 0) zone_flush(b);
+}
+
+static void builder_free(ZonesBuilder *b){
+    for (size_t i=0; i<b->nnames; i++) free(b->names[i]);
+    free(b->names); free(b->slot);
+    b->names = NULL; b->slot = NULL; b->nnames = b->ncap = b->nslot = 0;
+}
+
+int zones_finish(ZonesBuilder *b){
+    if (!b->err && b->nrows % ZONES_BLOCK) zone_flush(b);
+    if (b->err){
+        fprintf(stderr, "Aviso: sin %s (%s)\n", b->path,
+                b->err == ERANGE ? "más de 65535 regiones distintas" : strerror(b->err));
+        zones_abort(b);
+        return -1;
+    }
+    ZonesHeader hd; memset(&hd, 0, sizeof(hd));
+    memcpy(hd.magic, "NIDXZON", 7);
+    hd.version   = ZONES_VERSION;
+    hd.block     = ZONES_BLOCK;
+    hd.nrows     = b->nrows;
+    hd.nzones    = b->nzones;
+    hd.nregions  = b->nnames;
+    hd.names_off = sizeof(hd) + b->nzones * sizeof(ZoneEntry);
+    hd.text_off  = hd.names_off + (b->nnames + 1) * sizeof(uint32_t);
+    int ok = 1;
+    uint32_t off = 0;
+    for (size_t i=0; i<=b->nnames && ok; i++){
+        ok = fwrite(&off, sizeof(off), 1, b->f) == 1;
+        if (i < b->nnames) off += (uint32_t)strlen(b->names[i]);
+    }
+    for (size_t i=0; i<b->nnames && ok; i++)
+        ok = fwrite(b->names[i], 1, strlen(b->names[i]), b->f) == strlen(b->names[i]);
+    ok = ok && fseeko(b->f, 0, SEEK_SET) == 0 && fwrite(&hd, sizeof(hd), 1, b->f) == 1;
+    ok = (fclose(b->f) == 0) && ok;
+    b->f = NULL;
+    if (!ok || rename(b->tmp, b->path) != 0){
+        fprintf(stderr, "Escritura %s: %s\n", b->tmp, strerror(errno));
+        zones_abort(b);
+        return -1;
+    }
+    builder_free(b);
+    return 0;
+}
+
+void zones_abort(ZonesBuilder *b){
+    if (b->f) fclose(b->f);
+    b->f = NULL;
+    unlink(b->tmp);
+    builder_free(b);
+}
+
+/* ---------- Lectura ---------- */
+int zones_open(ZoneMap *z, const char *dir){
+    memset(z, 0, sizeof(*z));
+    char path[600];
+    snprintf(path, sizeof(path), "%s/" ZONES_NAME, dir);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    off_t sz = lseek(fd, 0, SEEK_END);
+    void *map = sz >= (off_t)sizeof(ZonesHeader) ? mmap(NULL, (size_t)sz, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED){ errno = EINVAL; return -1; }
+
+    const ZonesHeader *hd = (const ZonesHeader*)map;
+    const unsigned char *m = (const unsigned char*)map;
+    uint64_t size = (uint64_t)sz;
+    int ok = strncmp(hd->magic, "NIDXZON", 7) == 0 && hd->version == ZONES_VERSION && hd->block > 0 &&
+             hd->nrows <= UINT32_MAX && hd->nregions <= ZONES_MAX_REGIONS &&
+             hd->nzones == (hd->nrows + hd->block - 1) / hd->block &&
+             hd->names_off == sizeof(ZonesHeader) + hd->nzones * sizeof(ZoneEntry) &&
+             hd->text_off == hd->names_off + (hd->nregions + 1) * sizeof(uint32_t) && hd->text_off <= size;
+    if (ok){
+        const uint32_t *names = (const uint32_t*)(m + hd->names_off);
+        ok = hd->text_off + names[hd->nregions] <= size;
+        for (uint64_t i=0; ok && i<hd->nregions; i++) ok = names[i] <= names[i+1];
+    }
+    if (!ok){
+        fprintf(stderr, "Aviso: %s no es un zones.map válido\n", path);
+        munmap(map, (size_t)sz);
+        errno = EINVAL;
+        return -1;
+    }
+    z->map      = (unsigned char*)map;
+    z->size     = (size_t)sz;
+    z->block    = hd->block;
+    z->nrows    = hd->nrows;
+    z->nzones   = hd->nzones;
+    z->nregions = hd->nregions;
+    z->zones    = (const ZoneEntry*)(m + sizeof(ZonesHeader));
+    z->names    = (const uint32_t*)(m + hd->names_off);
+    z->text     = (const char*)(m + hd->text_off);
+    return 0;
+}
+
+void zones_close(ZoneMap *z){
+    if (z->map) munmap(z->map, z->size);
+    memset(z, 0, sizeof(*z));
+}
+
+/* ---------- Filtro ---------- */
+/* Un extremo del rango: AAAA, AAAA-MM o AAAA-MM-DD; hi = completar hacia el final */
+static uint32_t date_end(const char *s, size_t n, int hi){
+    char buf[11];
+    if (n == 4)      snprintf(buf, sizeof(buf), "%.4s-%s", s, hi ? "12-31" : "01-01");
+    else if (n == 7) snprintf(buf, sizeof(buf), "%.7s-%s", s, hi ? "31" : "01");
+    else if (n == 10) memcpy(buf, s, 10);
+    else return 0;
+    uint32_t v = ymd(buf, 10);
+    uint32_t mo = v / 100 % 100, d = v % 100;
+    return (mo >= 1 && mo <= 12 && d >= 1 && d <= 31) ? v : 0;
+}
+
+int zones_parse_dates(const char *s, uint32_t *from, uint32_t *to){
+    const char *dots = strstr(s, "..");
+    size_t n1 = dots ? (size_t)(dots - s) : strlen(s);
+    const char *s2 = dots ? dots + 2 : s;
+    *from = date_end(s, n1, 0);
+    *to   = date_end(s2, strlen(s2), 1);
+    return (*from && *to && *from <= *to) ? 0 : -1;
+}
+
+int zones_filter_init(ZoneFilter *f, const ZoneMap *z, const DocStore *docs,
+                      uint32_t from, uint32_t to, const char *region){
+    memset(f, 0, sizeof(*f));
+    f->z = z; f->docs = docs;
+    f->from = from; f->to = to;
+    f->has_date = from > 0 || to < UINT32_MAX;
+    if (region){
+        size_t len = strlen(region);
+        uint64_t i = 0;
+        for (; i<z->nregions; i++){
+            uint32_t a = z->names[i], b = z->names[i+1];
+            if (b - a == len && strncasecmp(z->text + a, region, len) == 0) break;
+        }
+        if (z->map && i == z->nregions){ errno = ENOENT; return -1; }
+        if (len >= sizeof(f->region)){ errno = ENOENT; return -1; }
+        if (z->map) memcpy(f->region, z->text + z->names[i], len);
+        else memcpy(f->region, region, len);          // sin zonas: se compara fila a fila
+        f->region[len] = 0;
+        f->has_region = 1;
+        mask_set(f->rmask, i);
+    }
+    if (docs && docs->nvals && !(f->val_ok = (uint8_t*)calloc(docs->nvals, 1))){ errno = ENOMEM; return -1; }
+    return 0;
+}
+
+void zones_filter_free(ZoneFilter *f){
+    free(f->val_ok);
+    f->val_ok = NULL;
+}
+
+/* La zona puede tener alguna fila que cumple */
+static inline int zone_may(const ZoneFilter *f, const ZoneEntry *e){
+    if (e->dmax < f->from || e->dmin > f->to) return 0;
+    return !f->has_region || (e->rmask[0] & f->rmask[0]) || (e->rmask[1] & f->rmask[1]);
+}
+
+/* Todas las filas de la zona cumplen */
+static inline int zone_all(const ZoneFilter *f, const ZoneEntry *e){
+    if (e->flags & ZONE_PARTIAL) return 0;
+    if (f->has_date && (e->dmin < f->from || e->dmax > f->to)) return 0;
+    if (!f->has_region) return 1;
+    int last = f->rmask[1] >> 63;                     // bit compartido: no alcanza
+    return !last && e->rmask[0] == f->rmask[0] && e->rmask[1] == f->rmask[1];
+}
+
+int zones_prev(const ZoneFilter *f, uint32_t x, uint32_t *out){
+    const ZoneMap *z = f->z;
+    if (!z || !z->map || (uint64_t)x >= z->nrows){ *out = x; return 1; }
+    for (uint64_t b = x / z->block; ; b--){
+        if (zone_may(f, &z->zones[b])){
+            *out = b == x / z->block ? x : (uint32_t)((b + 1) * z->block - 1);
+            return 1;
+        }
+        if (b == 0) return 0;
+    }
+}
+
+int zones_match(const ZoneFilter *f, const char *date, size_t dlen,
+                const char *region, size_t rlen){
+    uint32_t d = ymd(date, dlen);
+    if (f->has_date && (!d || d < f->from || d > f->to)) return 0;
+    return !f->has_region || (rlen == strlen(f->region) && strncasecmp(region, f->region, rlen) == 0);
+}
+
+int zones_row(ZoneFilter *f, uint32_t row){
+    const ZoneMap *z = f->z;
+    if (z && z->map && row < z->nrows && zone_all(f, &z->zones[row / z->block])) return 1;
+    const DocStore *d = f->docs;
+    if (!d || row >= d->nrows) return -1;
+    DocRow r = d->rows[row];
+    if (r.date >= d->nvals || r.region >= d->nvals) return -1;
+    uint64_t ntext = (uint64_t)(d->map + d->size - (const unsigned char*)d->text);
+    const DocVal *dv = &d->vals[r.date], *rv = &d->vals[r.region];
+    if ((uint64_t)dv->off + dv->len > ntext || (uint64_t)rv->off + rv->len > ntext) return -1;
+    /* cada valor de docs.seg se prueba una vez por consulta: bits 0-1 como
+       fecha, 2-3 como región */
+    uint8_t *vd = &f->val_ok[r.date], *vr = &f->val_ok[r.region];
+    if (!(*vd & 3)){
+        uint32_t x = ymd(d->text + dv->off, dv->len);
+        *vd |= (!f->has_date || (x && x >= f->from && x <= f->to)) ? 1 : 2;
+    }
+    if ((*vd & 3) != 1) return 0;
+    if (!f->has_region) return 1;
+    if (!(*vr & 12))
+        *vr |= (rv->len == strlen(f->region) && strncasecmp(d->text + rv->off, f->region, rv->len) == 0) ? 4 : 8;
+    return (*vr & 12) == 4;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "docstore.h"
+
+/* ============================================================
+   Zonas por tramo de filas: nameidx/zones.map
+   Las filas del chart se agregan más o menos en orden de fecha, así que
+   el número de fila (el de los postings) sigue a la fecha. Por cada
+   tramo de ZONES_BLOCK filas se guarda la menor y la mayor fecha y el
+   conjunto de regiones que aparecen (zone map): con un filtro de fecha
+   o región, SEARCH descarta tramos enteros sin mirar sus filas y solo
+   prueba fila a fila (en docs.seg) las de los tramos que pueden tener
+   alguna.
+
+     Cabecera (64 B) | ZoneEntry[nzones] | off u32[nregions + 1] | textos
+
+   Las regiones se numeran en el orden en que aparecen; el conjunto de
+   cada tramo es un mapa de 128 bits (las regiones 127 en adelante
+   comparten el último bit: el tramo "puede" tenerlas). Lo escribe el
+   build de nameidx junto con docs.seg; las filas de ADD posteriores no
+   tienen zona y se prueban una a una.
+   ============================================================ */
+
+#define ZONES_NAME        "zones.map"
+#define ZONES_VERSION     1
+#define ZONES_BLOCK       1024      // filas por zona
+#define ZONES_MAX_REGIONS 0xFFFF
+#define ZONES_MASK_BITS   128
+
+#define ZONE_PARTIAL 1u             // alguna fila sin fecha o sin región
+
+typedef struct {
+    char     magic[8];      // "NIDXZON"
+    uint32_t version;
+    uint32_t block;         // filas por zona
+    uint64_t nrows;
+    uint64_t nzones;
+    uint64_t nregions;
+    uint64_t names_off;     // off u32[nregions + 1]
+    uint64_t text_off;
+    uint64_t reserved;
+} __attribute__((packed)) ZonesHeader;
+
+typedef struct {
+    uint32_t dmin, dmax;    // AAAAMMDD de las filas con fecha (dmin > dmax: ninguna)
+    uint32_t flags;         // ZONE_*
+    uint32_t pad;
+    uint64_t rmask[2];      // bit min(región, 127)
+} ZoneEntry;
+
+/* ---- Construcción: una fila por llamada, en el orden de rows.off ---- */
+typedef struct {
+    char      path[600], tmp[610];
+    FILE     *f;
+    uint64_t  nrows, nzones;
+    ZoneEntry cur;
+    char    **names;   size_t nnames, ncap;
+    uint32_t *slot;    size_t nslot;        // tabla hash nombre -> id+1
+    int       err;
+} ZonesBuilder;
+
+/* Borra el zones.map anterior de dir y empieza zones.map.tmp. 0 o -1. */
+int  zones_begin(ZonesBuilder *b, const char *dir);
+/* Fecha (AAAA-MM-DD) y región de la fila siguiente; NULL si no tiene */
+void zones_add(ZonesBuilder *b, const char *date, const char *region);
+/* Escribe el archivo. 0 o -1 (mensaje en stderr, sin zones.map). */
+int  zones_finish(ZonesBuilder *b);
+void zones_abort(ZonesBuilder *b);
+
+/* ---- Lectura ---- */
+typedef struct {
+    unsigned char   *map;
+    size_t           size;
+    uint32_t         block;
+    uint64_t         nrows, nzones, nregions;
+    const ZoneEntry *zones;
+    const uint32_t  *names;
+    const char      *text;
+} ZoneMap;
+
+/* Mapea dir/zones.map; -1 si no está o no es válido (z queda vacío: sin
+   zonas todas las filas se prueban una a una) */
+int  zones_open(ZoneMap *z, const char *dir);
+void zones_close(ZoneMap *z);
+
+/* "AAAA", "AAAA-MM", "AAAA-MM-DD" o "desde..hasta" (con cualquiera de
+   esas formas) -> rango AAAAMMDD inclusivo. 0 o -1. */
+int  zones_parse_dates(const char *s, uint32_t *from, uint32_t *to);
+
+/* Filtro de una consulta: fechas [from, to] (0, UINT32_MAX = todas) y
+   región (o todas) */
+typedef struct {
+    const ZoneMap  *z;
+    uint32_t        from, to;
+    int             has_date, has_region;
+    char            region[128];        // nombre tal como está en el mapa
+    uint64_t        rmask[2];
+    const DocStore *docs;
+    uint8_t        *val_ok;             // por valor de docs.seg: ya probado como fecha / región
+} ZoneFilter;
+
+/* region = NULL para todas. -1 con errno = ENOENT si la región no está
+   en el mapa (ninguna fila del build la tiene), ENOMEM sin memoria. */
+int  zones_filter_init(ZoneFilter *f, const ZoneMap *z, const DocStore *docs,
+                       uint32_t from, uint32_t to, const char *region);
+void zones_filter_free(ZoneFilter *f);
+/* Mayor fila <= x de una zona que puede cumplir el filtro (x mismo si
+   su zona puede o si es posterior al build); 0 si no queda ninguna */
+int  zones_prev(const ZoneFilter *f, uint32_t x, uint32_t *out);
+/* La fila cumple el filtro: por su zona si la cumple entera, si no por
+   docs.seg. 1 / 0, o -1 si la fila no está en docs.seg (probar con
+   zones_match sobre el CSV). */
+int  zones_row(ZoneFilter *f, uint32_t row);
+/* Fecha y región de una fila (textos sin terminar en 0) contra el filtro */
+int  zones_match(const ZoneFilter *f, const char *date, size_t dlen,
+                 const char *region, size_t rlen);